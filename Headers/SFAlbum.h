@@ -24,6 +24,34 @@
  */
 typedef struct _SFAlbum *SFAlbumRef;
 
+/**
+ * Structure describing where the fields of exported glyph records are written.
+ *
+ * Each field is described by a pointer to its first element and the number of bytes between two of
+ * its consecutive elements. Separate arrays are described by setting the stride to the size of the
+ * field, whereas interleaved records are described by pointing each field inside the first record
+ * and setting the stride to the size of the record. A field is skipped if its pointer is NULL.
+ */
+typedef struct _SFGlyphRecordLayout {
+    SFGlyphID *glyphIDs;            /**< Destination of glyph IDs. */
+    SFUInteger glyphIDStride;       /**< Number of bytes between two glyph IDs. */
+    SFPoint *offsets;               /**< Destination of glyph offsets. */
+    SFUInteger offsetStride;        /**< Number of bytes between two glyph offsets. */
+    SFAdvance *advances;            /**< Destination of glyph advances. */
+    SFUInteger advanceStride;       /**< Number of bytes between two glyph advances. */
+    SFUInt32 *clusters;             /**< Destination of code unit indexes to which glyphs belong. */
+    SFUInteger clusterStride;       /**< Number of bytes between two code unit indexes. */
+} SFGlyphRecordLayout;
+
+/**
+ * Structure identifying the input from which an album was shaped, so that serialized albums can be
+ * matched against it.
+ */
+typedef struct _SFShapeKey {
+    SFUInt32 patternHash;           /**< Hash of the font tables, script, language and features. */
+    SFUInt64 textHash;              /**< Hash of the input text and the shaping options. */
+} SFShapeKey;
+
 /**
  * Creates an instance of an open type album.
  *
@@ -69,7 +97,8 @@ const SFGlyphID *SFAlbumGetGlyphIDsPtr(SFAlbumRef album);
  * @param album
  *      The album from which to access the glyph offsets.
  * @return
- *      A valid pointer to an array of SFPoint structures.
+ *      A valid pointer to an array of SFPoint structures, or NULL if the glyphs were not
+ *      positioned.
  */
 const SFPoint *SFAlbumGetGlyphOffsetsPtr(SFAlbumRef album);
 
@@ -79,7 +108,7 @@ const SFPoint *SFAlbumGetGlyphOffsetsPtr(SFAlbumRef album);
  * @param album
  *      The album from which to access the glyph advances.
  * @return
- *      A valid pointer to an array of glyph advances.
+ *      A valid pointer to an array of glyph advances, or NULL if the glyphs were not positioned.
  */
 const SFAdvance *SFAlbumGetGlyphAdvancesPtr(SFAlbumRef album);
 
@@ -98,10 +127,198 @@ const SFAdvance *SFAlbumGetGlyphAdvancesPtr(SFAlbumRef album);
  * @param album
  *      The album from which to access the glyph map.
  * @return
- *      A valid pointer to an array of glyph map.
+ *      A valid pointer to an array of glyph map, or NULL if the album was only measured.
+ * @note
+ *      The album keeps the map internally in 32-bit indexes, so this function makes a machine word
+ *      copy of it on first access. SFAlbumGetCodeunitToGlyphMap32Ptr should be preferred to avoid
+ *      the extra memory.
+ * @note
+ *      Building the map modifies the album, so this function must not be called concurrently with
+ *      any other function on the same album, even though it only reads the results.
  */
 const SFUInteger *SFAlbumGetCodeunitToGlyphMapPtr(SFAlbumRef album);
 
+/**
+ * Returns a direct pointer to an array of 32-bit indexes, mapping each code unit in the source
+ * string to corresponding glyph.
+ *
+ * The map follows the same rules as described in SFAlbumGetCodeunitToGlyphMapPtr.
+ *
+ * @param album
+ *      The album from which to access the glyph map.
+ * @return
+ *      A valid pointer to an array of glyph map, or NULL if the album was only measured.
+ * @note
+ *      The map is built on first access after shaping, so clients which never request it do not
+ *      pay for it. As building the map modifies the album, the threads sharing a shaped album must
+ *      either request the map once before sharing it or serialize the calls to this function.
+ */
+const SFUInt32 *SFAlbumGetCodeunitToGlyphMap32Ptr(SFAlbumRef album);
+
+/**
+ * Writes the glyphs produced by the shaping engine directly into caller-provided memory, in a
+ * single pass.
+ *
+ * @param album
+ *      The album from which to export the glyphs.
+ * @param layout
+ *      The layout describing the destination of each field.
+ * @param index
+ *      The index of the first glyph to export.
+ * @param count
+ *      The number of glyphs to export. The range must lie within the glyph count of the album.
+ * @note
+ *      The destination of each field must be suitably aligned for its type. The offsets and
+ *      advances are written as zero if the album was not positioned.
+ */
+void SFAlbumExportGlyphRecords(SFAlbumRef album, const SFGlyphRecordLayout *layout, SFUInteger index, SFUInteger count);
+
+/**
+ * Returns whether breaking the text right before a glyph would change the shaping results.
+ *
+ * A glyph is unsafe to break if a contextual lookup, ligature, cursive connection or kerning pair
+ * has involved both of it and a glyph before it, or if its character joins a character before it so
+ * that the joining forms of both depend on each other. Otherwise, the text can be split at the code
+ * unit of the glyph, and both parts can be shaped separately and joined to get the same results,
+ * which lets line breaking reuse the glyphs of a paragraph instead of shaping each line again.
+ *
+ * The glyph before is always the previous one in the album, so the flag refers to the boundary on
+ * the logical start side of the glyph in forward mode and on its logical end side in backward mode.
+ *
+ * @param album
+ *      The album containing the glyph.
+ * @param index
+ *      The index of the glyph, which must be less than the glyph count of the album.
+ * @return
+ *      SFTrue if the glyph is shaped together with a previous glyph, SFFalse otherwise.
+ * @note
+ *      The flag is only meaningful for the first glyph of a cluster, as breaking inside a cluster
+ *      is never safe.
+ */
+SFBoolean SFAlbumIsUnsafeToBreak(SFAlbumRef album, SFUInteger index);
+
+/**
+ * Returns the index of the font which produced a glyph, when the album is filled with fallback
+ * fonts by SFArtistFillAlbumWithFallbacks.
+ *
+ * @param album
+ *      The album containing the glyph.
+ * @param index
+ *      The index of the glyph, which must be less than the glyph count of the album.
+ * @return
+ *      Zero if the glyph was produced by the pattern of the artist, or one more than the index of
+ *      the fallback pattern which produced it.
+ */
+SFUInteger SFAlbumGetFontIndex(SFAlbumRef album, SFUInteger index);
+
+/**
+ * Returns the number of memory allocations made by the album while shaping the last text.
+ *
+ * The album keeps its storage between the shaping calls, so the count drops to zero once the
+ * album has grown to fit the text being shaped.
+ *
+ * @param album
+ *      The album for which to return the number of allocations.
+ * @return
+ *      The number of allocations made by the album since it was last filled.
+ */
+SFUInteger SFAlbumGetAllocationCount(SFAlbumRef album);
+
+/**
+ * Returns the number of bytes of heap memory currently held by the album.
+ *
+ * @param album
+ *      The album for which to return the memory usage.
+ * @return
+ *      The number of heap bytes held by the album, excluding its own structure.
+ */
+SFUInteger SFAlbumGetMemoryUsage(SFAlbumRef album);
+
+/**
+ * Returns the highest number of bytes of heap memory ever held by the album.
+ *
+ * @param album
+ *      The album for which to return the peak memory usage.
+ * @return
+ *      The high-water mark of the heap bytes held by the album.
+ */
+SFUInteger SFAlbumGetPeakMemoryUsage(SFAlbumRef album);
+
+/**
+ * Sets the number of bytes of heap memory which the album may keep between the shaping calls.
+ *
+ * When the album is reused for a new text while holding more memory than the limit, it shrinks its
+ * storage to what fits in the limit, assuming one glyph per code unit. The storage is never shrunk
+ * below what the new text is expected to need though, so that it is not allocated again right away.
+ *
+ * @param album
+ *      The album whose limit is to be set.
+ * @param limit
+ *      The number of heap bytes to retain. By default, the limit is the maximum value of
+ *      SFUInteger, so the storage is always kept.
+ */
+void SFAlbumSetRetainedCapacityLimit(SFAlbumRef album, SFUInteger limit);
+
+/**
+ * Writes the shaping results of an album into a buffer, so that they can be stored and loaded later
+ * without shaping the text again.
+ *
+ * The buffer holds a fixed header followed by the code unit to glyph map, clusters, glyph flags,
+ * offsets, advances and glyph IDs as plain arrays in native byte order. Its size is always a multiple of
+ * four bytes, so multiple albums can be written one after another.
+ *
+ * @param album
+ *      The album to serialize.
+ * @param key
+ *      The key of the input from which the album was shaped, or NULL to store an empty key.
+ * @param buffer
+ *      The buffer to write into, aligned to four bytes. Nothing is written if it is NULL or
+ *      smaller than the required size.
+ * @param capacity
+ *      The number of bytes available in the buffer.
+ * @return
+ *      The number of bytes required to serialize the album, or zero if the album was only
+ *      measured, in which case nothing is written.
+ */
+SFUInteger SFAlbumSerialize(SFAlbumRef album, const SFShapeKey *key, void *buffer, SFUInteger capacity);
+
+/**
+ * Creates an album from a buffer previously written by SFAlbumSerialize.
+ *
+ * The header is validated along with the map and the clusters, which must only refer to the glyphs
+ * and code units of the album. The arrays are then copied in bulk, so the buffer can be mapped
+ * directly from a file. The returned album can be reused for shaping like any other album.
+ *
+ * @param buffer
+ *      The buffer holding the serialized album, aligned to four bytes.
+ * @param size
+ *      The number of bytes available in the buffer.
+ * @param key
+ *      The key which the serialized album must match, or NULL to accept any key.
+ * @return
+ *      A reference to an album object, or NULL if the buffer is not a valid serialized album of
+ *      this version and byte order, or if its key does not match.
+ */
+SFAlbumRef SFAlbumCreateFromBuffer(const void *buffer, SFUInteger size, const SFShapeKey *key);
+
+/**
+ * Creates a copy of an album which shares the shaping results with it.
+ *
+ * The glyph stream is not copied. Instead, both albums refer to the same buffers until either of
+ * them is filled again, at which point it lets go of the shared buffers and continues with its own
+ * storage. The last album holding the shared buffers takes them back as its own storage, so
+ * discarding a copy does not cost the original album its capacity.
+ *
+ * @param album
+ *      The album to copy. It must not be in the middle of shaping.
+ * @return
+ *      A reference to an album object holding the same results as the given album, or NULL if the
+ *      album was only measured.
+ * @note
+ *      The shared buffers are not counted in the memory usage of any album.
+ */
+SFAlbumRef SFAlbumCreateCopy(SFAlbumRef album);
+
 SFAlbumRef SFAlbumRetain(SFAlbumRef album);
 void SFAlbumRelease(SFAlbumRef album);
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_PUBLIC_ALBUM_POOL_H
+#define _SF_PUBLIC_ALBUM_POOL_H
+
+#include "SFAlbum.h"
+#include "SFBase.h"
+
+/**
+ * The type used to represent a pool of albums.
+ */
+typedef struct _SFAlbumPool *SFAlbumPoolRef;
+
+/**
+ * The function used to lock a pool before it is accessed.
+ *
+ * @param object
+ *      The object associated with the pool.
+ */
+typedef void (*SFAlbumPoolProtocolLockFunc)(void *object);
+
+/**
+ * The function used to unlock a pool after it has been accessed.
+ *
+ * @param object
+ *      The object associated with the pool.
+ */
+typedef void (*SFAlbumPoolProtocolUnlockFunc)(void *object);
+
+/**
+ * Structure containing the functions of a SFAlbumPool.
+ */
+typedef struct _SFAlbumPoolProtocol {
+    /**
+     * The function used to lock the pool, typically by acquiring a mutex.
+     */
+    SFAlbumPoolProtocolLockFunc lock;
+    /**
+     * The function used to unlock the pool, typically by releasing a mutex.
+     */
+    SFAlbumPoolProtocolUnlockFunc unlock;
+} SFAlbumPoolProtocol;
+
+/**
+ * Creates a pool which hands out reusable albums.
+ *
+ * The albums are kept in separate capacity classes, so that the albums grown for long texts are not
+ * handed out for short ones and vice versa.
+ *
+ * @param protocol
+ *      A structure holding pointers to the locking functions of the pool, or NULL if the pool will
+ *      only be accessed by a single thread.
+ * @param object
+ *      An object associated with the pool, passed back to the locking functions.
+ * @param albumsPerClass
+ *      The maximum number of idle albums kept in each capacity class. The albums returned beyond
+ *      this limit are released.
+ * @return
+ *      A reference to an album pool object.
+ */
+SFAlbumPoolRef SFAlbumPoolCreate(const SFAlbumPoolProtocol *protocol, void *object, SFUInteger albumsPerClass);
+
+/**
+ * Takes an album out of the pool, creating a new one if the pool has no suitable album.
+ *
+ * A new album is grown upfront for the expected text, so that shaping it does not allocate while
+ * the text produces no more glyphs than code units. An album handed back is put in the class of the
+ * largest text its glyphs have been grown for.
+ *
+ * @param pool
+ *      The pool from which to take the album.
+ * @param codeunitCount
+ *      The expected number of code units of the text to be shaped with the album.
+ * @return
+ *      A reference to an album object, which should be handed back with SFAlbumPoolGiveBack.
+ */
+SFAlbumRef SFAlbumPoolTake(SFAlbumPoolRef pool, SFUInteger codeunitCount);
+
+/**
+ * Hands an album back to the pool for reuse.
+ *
+ * @param pool
+ *      The pool to which to give back the album.
+ * @param album
+ *      The album to give back. The caller must not use it afterwards.
+ */
+void SFAlbumPoolGiveBack(SFAlbumPoolRef pool, SFAlbumRef album);
+
+SFAlbumPoolRef SFAlbumPoolRetain(SFAlbumPoolRef pool);
+void SFAlbumPoolRelease(SFAlbumPoolRef pool);
+
+#endif
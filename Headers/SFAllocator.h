@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_PUBLIC_ALLOCATOR_H
+#define _SF_PUBLIC_ALLOCATOR_H
+
+#include "SFBase.h"
+
+/**
+ * The function used to allocate a block of memory.
+ *
+ * @param object
+ *      The object associated with the allocator.
+ * @param size
+ *      The number of bytes to allocate.
+ * @return
+ *      A pointer to the allocated block of memory.
+ */
+typedef void *(*SFAllocatorProtocolAllocateFunc)(void *object, SFUInteger size);
+
+/**
+ * The function used to resize a block of memory, keeping its existing contents.
+ *
+ * @param object
+ *      The object associated with the allocator.
+ * @param pointer
+ *      The block of memory to resize. This parameter may be NULL, in which case the function must
+ *      behave like allocate.
+ * @param size
+ *      The new number of bytes of the block.
+ * @return
+ *      A pointer to the resized block of memory.
+ */
+typedef void *(*SFAllocatorProtocolReallocateFunc)(void *object, void *pointer, SFUInteger size);
+
+/**
+ * The function used to release a block of memory.
+ *
+ * @param object
+ *      The object associated with the allocator.
+ * @param pointer
+ *      The block of memory to release. This parameter may be NULL.
+ */
+typedef void (*SFAllocatorProtocolDeallocateFunc)(void *object, void *pointer);
+
+/**
+ * Structure containing the functions of an allocator.
+ */
+typedef struct _SFAllocatorProtocol {
+    /**
+     * The function used to allocate a block of memory.
+     */
+    SFAllocatorProtocolAllocateFunc allocate;
+    /**
+     * The function used to resize a block of memory.
+     */
+    SFAllocatorProtocolReallocateFunc reallocate;
+    /**
+     * The function used to release a block of memory. This function may be NULL, which is useful
+     * for arenas that release all of their memory at once.
+     */
+    SFAllocatorProtocolDeallocateFunc deallocate;
+} SFAllocatorProtocol;
+
+/**
+ * Sets the allocator used by the library for all of its objects and their internal storage.
+ *
+ * @param protocol
+ *      A structure holding pointers to the implemented functions of the allocator, or NULL to
+ *      restore the standard C allocator.
+ * @param object
+ *      An object associated with the allocator, passed back to each of its functions.
+ * @note
+ *      The allocator must be set before creating any object, and must not be changed while any
+ *      object of the library is alive since the memory of an object is always released with the
+ *      allocator that was current at the time of releasing it.
+ */
+void SFAllocatorSetProtocol(const SFAllocatorProtocol *protocol, void *object);
+
+/**
+ * Returns the number of blocks the library has allocated or resized so far, whichever allocator
+ * was current at the time.
+ *
+ * Comparing the count before and after a call, such as SFArtistFillAlbum, tells how many times that
+ * call went to the allocator, including the scratch memory of the artist, the tasks of concurrent
+ * filling, the building of patterns and the entries of shape caches.
+ *
+ * @return
+ *      The number of allocations made by the library.
+ * @note
+ *      The count is not synchronized, so it is exact only while a single thread uses the library.
+ */
+SFUInteger SFAllocatorGetAllocationCount(void);
+
+#endif
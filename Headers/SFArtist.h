@@ -20,12 +20,57 @@
 #include "SFAlbum.h"
 #include "SFBase.h"
 #include "SFPattern.h"
+#include "SFShapeCache.h"
+
+/**
+ * The modes deciding how far an artist carries out the shaping.
+ */
+enum {
+    SFShapingModeComplete = 0,          /**< Substitutes and positions the glyphs. */
+    SFShapingModeSubstitutionOnly = 1   /**< Only substitutes the glyphs, skipping positioning. */
+};
+typedef SFUInt32 SFShapingMode;
+
+/**
+ * The modes deciding whether an artist splits a source string into segments shaped independently.
+ */
+enum {
+    SFSegmentationModeNone = 0,         /**< Shapes the whole string at once. */
+    SFSegmentationModeWords = 1         /**< Shapes each word along with its trailing spaces apart. */
+};
+typedef SFUInt32 SFSegmentationMode;
 
 /**
  * The type used to represent an open type artist.
  */
 typedef struct _SFArtist *SFArtistRef;
 
+/**
+ * The function shaping a single chunk of a source string.
+ *
+ * @param task
+ *      The chunk to shape.
+ */
+typedef void (*SFArtistTaskFunc)(void *task);
+
+/**
+ * The function used to run the tasks of an artist, possibly on multiple threads.
+ *
+ * Each task must be passed to the task function exactly once, and the function must return only
+ * after all of the tasks have finished. The tasks do not depend on each other, so they may run in
+ * any order.
+ *
+ * @param object
+ *      The object passed along with the function.
+ * @param function
+ *      The function to call with each task.
+ * @param tasks
+ *      The array of tasks.
+ * @param taskCount
+ *      The number of tasks in the array.
+ */
+typedef void (*SFArtistRunTasksFunc)(void *object, SFArtistTaskFunc function, void **tasks, SFUInteger taskCount);
+
 SFArtistRef SFArtistCreate(void);
 
 /**
@@ -52,6 +97,63 @@ void SFArtistSetPattern(SFArtistRef artist, SFPatternRef pattern);
  */
 void SFArtistSetString(SFArtistRef artist, SFStringEncoding stringEncoding, void *stringBuffer, SFUInteger stringLength);
 
+/**
+ * Sets a range of a larger string as the source string which an artist will shape.
+ *
+ * Only the code units within the range produce glyphs, and the album reports them from zero as if
+ * the range were the whole string. The code units around the range are kept as context, so that
+ * the characters at its edges take the same joining forms as if the whole string were shaped. The
+ * lookups reaching across its edges apply in the same way too, as far as the context length of the
+ * pattern counted in characters, with the combining marks not counted. This allows a paragraph to
+ * be shaped in separate runs, such as for style changes, without breaking the text at their edges.
+ *
+ * @param artist
+ *      The artist for which to set the string.
+ * @param stringEncoding
+ *      The encoding of the string.
+ * @param stringBuffer
+ *      A buffer that contains the code units of the whole string.
+ * @param stringLength
+ *      The length of the whole string in terms of code units.
+ * @param rangeIndex
+ *      The index of the first code unit to shape.
+ * @param rangeLength
+ *      The number of code units to shape. The range must lie within the string.
+ * @note
+ *      A lookup which would merge the glyphs of the range with the glyphs of its context is not
+ *      applied across the edge, so that each run keeps the glyphs of its own code units.
+ * @note
+ *      The context is measured in characters rather than glyphs, so a lookup can still see other
+ *      glyphs than in the whole string if the context forms ligatures, or if the lookup skips base
+ *      glyphs or ligatures.
+ */
+void SFArtistSetStringRange(SFArtistRef artist, SFStringEncoding stringEncoding, void *stringBuffer, SFUInteger stringLength,
+    SFUInteger rangeIndex, SFUInteger rangeLength);
+
+/**
+ * Sets the glyphs which an artist will shape in place of a source string.
+ *
+ * This is useful when the glyph IDs are already known, for example from an existing document or a
+ * cached character map. The glyphs are substituted and positioned as if they were produced from a
+ * string, but no code points are decoded and the character map of the font is not consulted. The
+ * glyphs are expected to be in their final joining forms, if any.
+ *
+ * @param artist
+ *      The artist for which to set the glyphs.
+ * @param glyphIDs
+ *      An array of glyph IDs to shape. The array must remain valid until the album is filled.
+ * @param clusters
+ *      An array holding the code unit index of each glyph, or NULL if each glyph belongs to the code
+ *      unit at its own index.
+ * @param glyphCount
+ *      The number of glyphs in the array.
+ * @param codeunitCount
+ *      The number of code units to which the glyphs belong, used for the code unit to glyph map.
+ * @note
+ *      Setting the glyphs replaces the source string, and vice versa.
+ */
+void SFArtistSetGlyphs(SFArtistRef artist, const SFGlyphID *glyphIDs, const SFUInt32 *clusters, SFUInteger glyphCount, SFUInteger codeunitCount);
+
 /**
  * Sets the text direction which an artist will use while shaping.
  *
@@ -82,6 +184,50 @@ void SFArtistSetTextDirection(SFArtistRef artist, SFTextDirection textDirection)
  */
 void SFArtistSetTextMode(SFArtistRef artist, SFTextMode textMode);
 
+/**
+ * Sets the shaping mode which an artist will use while shaping.
+ *
+ * The substitution only mode is useful when only the glyphs and their clusters are needed, for
+ * example while indexing or subsetting. In this mode, the advances of the glyphs are not fetched and
+ * no offsets or advances are produced in the album.
+ *
+ * @param artist
+ *      The artist for which to set the shaping mode.
+ * @param shapingMode
+ *      A value of SFShapingMode.
+ */
+void SFArtistSetShapingMode(SFArtistRef artist, SFShapingMode shapingMode);
+
+/**
+ * Sets the segmentation mode which an artist will use while shaping a source string.
+ *
+ * In words mode, the string is split after each run of spaces, and the words are shaped one by one
+ * and stitched into the album, so that a shape cache set on the artist keeps the results of single
+ * words which recur far more often than whole strings. The words are only shaped apart if the
+ * pattern is space separable, so the results are the same as shaping the whole string.
+ *
+ * @param artist
+ *      The artist for which to set the segmentation mode.
+ * @param segmentationMode
+ *      A value of SFSegmentationMode.
+ * @note
+ *      The glyphs set with SFArtistSetGlyphs and the strings being measured are never segmented.
+ */
+void SFArtistSetSegmentationMode(SFArtistRef artist, SFSegmentationMode segmentationMode);
+
+/**
+ * Sets the cache which an artist will consult before shaping a source string, and fill with the
+ * results of the strings it had to shape.
+ *
+ * @param artist
+ *      The artist for which to set the cache.
+ * @param shapeCache
+ *      The cache to use, or NULL to shape every string. The artist retains the cache.
+ * @note
+ *      The results of measurement and of the glyphs set with SFArtistSetGlyphs are not cached.
+ */
+void SFArtistSetShapeCache(SFArtistRef artist, SFShapeCacheRef shapeCache);
+
 /**
  * Shapes the source string with an appropriate shaping engine, filling the album with shaping
  * results. The album is cleared first, if not empty.
@@ -98,6 +244,179 @@ void SFArtistSetTextMode(SFArtistRef artist, SFTextMode textMode);
  */
 void SFArtistFillAlbum(SFArtistRef artist, SFAlbumRef album);
 
+/**
+ * Shapes many strings one after another with the same settings, filling an album for each of them.
+ *
+ * The shaping engine is picked once for the whole batch, and each string is then shaped as if it
+ * was set as the source string of the artist and passed to SFArtistFillAlbum. The source string of
+ * the artist itself is left untouched.
+ *
+ * @param artist
+ *      The artist to use for shaping.
+ * @param stringEncoding
+ *      The encoding of all strings.
+ * @param stringBuffers
+ *      The array of strings to shape.
+ * @param stringLengths
+ *      The array holding the number of code units in each string.
+ * @param count
+ *      The number of strings to shape.
+ * @param albums
+ *      The array of distinct albums that should be filled with the results of respective strings.
+ * @note
+ *      The strings are shaped without any context, and are never split into segments, which suits
+ *      short strings such as labels.
+ */
+void SFArtistFillAlbums(SFArtistRef artist, SFStringEncoding stringEncoding,
+    void * const *stringBuffers, const SFUInteger *stringLengths, SFUInteger count, SFAlbumRef *albums);
+
+/**
+ * Shapes the source string with many patterns, filling an album for each of them.
+ *
+ * The string is decoded and its code points are classified only once, after which each pattern
+ * runs its own glyph discovery, substitution and positioning as a separate task, so that the
+ * patterns can be evaluated concurrently, for example while picking a fallback font. The results
+ * are the same as setting each pattern on the artist and calling SFArtistFillAlbum.
+ *
+ * @param artist
+ *      The artist holding the source string and the shaping options.
+ * @param patterns
+ *      The array of patterns to shape with.
+ * @param count
+ *      The number of patterns.
+ * @param albums
+ *      The array of distinct albums that should be filled with the results of respective patterns.
+ * @param runTasks
+ *      The function running the tasks, or NULL to run them one after another.
+ * @param object
+ *      The object passed to the function running the tasks.
+ * @note
+ *      The same requirements as of SFArtistFillAlbumConcurrently apply to running the tasks on
+ *      multiple threads.
+ */
+void SFArtistFillAlbumsWithPatterns(SFArtistRef artist, SFPatternRef *patterns, SFUInteger count,
+    SFAlbumRef *albums, SFArtistRunTasksFunc runTasks, void *object);
+
+/**
+ * Fills the album like SFArtistFillAlbum, and then replaces the missing glyphs with the glyphs of
+ * fallback fonts.
+ *
+ * The source string is shaped once with the pattern of the artist. Each fallback pattern then
+ * shapes only the clusters which are still left with a .notdef glyph, along with the rest of the
+ * string as context, and its results are put in place of those clusters if it has any glyph for
+ * them. SFAlbumGetFontIndex tells which font produced each glyph of the album.
+ *
+ * @param artist
+ *      The artist to use for shaping, holding the primary pattern.
+ * @param album
+ *      The album that should be filled with shaping results.
+ * @param fallbacks
+ *      The array of fallback patterns, in the order of preference.
+ * @param fallbackCount
+ *      The number of fallback patterns.
+ * @note
+ *      The missing glyphs are kept if a lookup has reordered the clusters of the text.
+ */
+void SFArtistFillAlbumWithFallbacks(SFArtistRef artist, SFAlbumRef album,
+    SFPatternRef *fallbacks, SFUInteger fallbackCount);
+
+/**
+ * Updates an album after an edit to its text, by shaping again only the part of the text which the
+ * edit can affect.
+ *
+ * The source string of the artist must hold the edited text, while the album must hold the results
+ * of the text before the edit, shaped by the same artist. The window to shape again extends from
+ * the edit by the context length of the pattern on both sides, not counting the marks, and further
+ * until a glyph which is safe to break. The window is shaped along with the text around it, and the
+ * whole text is shaped instead if a lookup merges the glyphs across an edge of the window. The
+ * glyphs outside of the window are kept, with their clusters moved by the change in length.
+ *
+ * @param artist
+ *      The artist to use for shaping, holding the edited text.
+ * @param album
+ *      The album holding the results of the text before the edit.
+ * @param editIndex
+ *      The index of the first code unit replaced by the edit.
+ * @param editLength
+ *      The number of code units replaced by the edit, in the text before the edit.
+ * @param newLength
+ *      The number of code units which replaced them.
+ * @note
+ *      The whole text is shaped again if the album does not hold wrapped up results of a source
+ *      string, or if the edit does not fit its text.
+ * @note
+ *      The window only covers the reach of a single lookup. A lookup skipping base glyphs or
+ *      ligatures, or a chain of lookups whose substitutions carry an edit further than the context
+ *      length of the pattern without merging any glyphs, is not followed beyond the window.
+ */
+void SFArtistUpdateAlbum(SFArtistRef artist, SFAlbumRef album,
+    SFUInteger editIndex, SFUInteger editLength, SFUInteger newLength);
+
+/**
+ * Fills the album like SFArtistFillAlbum, but splits a long source string into chunks which are
+ * shaped as separate tasks, so that they can run concurrently.
+ *
+ * Each chunk ends after the spaces following its preferred length, and is shaped independently.
+ * The results of the chunks are then joined into the album with their clusters moved to their
+ * place in the string. If the pattern has a lookup involving the space, the glyphs could be merged
+ * across the edges of the chunks, so the whole string is shaped at once as a single task instead.
+ *
+ * The tasks and the albums of the chunks are kept by the artist, so that the next call reuses their
+ * storage instead of allocating it again.
+ *
+ * @param artist
+ *      The artist to use for shaping.
+ * @param album
+ *      The album that should be filled with shaping results.
+ * @param chunkLength
+ *      The preferred number of code units in each chunk.
+ * @param runTasks
+ *      The function running the tasks, or NULL to run them one after another.
+ * @param object
+ *      The object passed to the function running the tasks.
+ * @note
+ *      The tasks share the pattern and the font of the artist, so the font protocol and the memory
+ *      allocator must be safe to call from multiple threads. The shape cache of the artist is
+ *      consulted only if it has locking functions.
+ */
+void SFArtistFillAlbumConcurrently(SFArtistRef artist, SFAlbumRef album, SFUInteger chunkLength,
+    SFArtistRunTasksFunc runTasks, void *object);
+
+/**
+ * Shapes the source string only as far as needed to measure it, and returns its total advance.
+ *
+ * The substitutions and the positioning that can affect the advances are applied, while mark
+ * attachments are skipped and the album is not wrapped up.
+ *
+ * @param artist
+ *      The artist to use for shaping.
+ * @param album
+ *      The album to use as scratch memory. Its contents are unspecified afterwards, so it should be
+ *      filled again before accessing any of its results. Until then, the album has no glyph map,
+ *      offsets or advances, and can neither be copied nor serialized.
+ * @return
+ *      The sum of the advances of all glyphs.
+ */
+SFInteger SFArtistMeasure(SFArtistRef artist, SFAlbumRef album);
+
+/**
+ * Calculates the key of the input which the artist will shape, for storing or looking up the
+ * results with SFAlbumSerialize and SFAlbumCreateFromBuffer.
+ *
+ * The pattern part of the key covers the checksums of the layout tables of the font, the script,
+ * the language and the features. The text part covers the source string or glyphs, the text
+ * direction, the text mode and the shaping mode. Only fixed-width values are hashed, so the key of
+ * an input is the same on every platform of the same byte order.
+ *
+ * @param artist
+ *      The artist whose input is to be identified.
+ * @param key
+ *      The key to be filled.
+ * @note
+ *      The key is a hash, so a cache should also compare the text itself if collisions matter.
+ */
+void SFArtistGetShapeKey(SFArtistRef artist, SFShapeKey *key);
+
 SFArtistRef SFArtistRetain(SFArtistRef artist);
 void SFArtistRelease(SFArtistRef artists);
 
@@ -49,6 +49,11 @@ typedef uint16_t        SFUInt16;
  */
 typedef uint32_t        SFUInt32;
 
+/**
+ * A type to represent a 64-bit unsigned integer.
+ */
+typedef uint64_t        SFUInt64;
+
 /**
  * A signed integer type whose width is equal to the width of the machine word.
  */
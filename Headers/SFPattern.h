@@ -76,6 +76,37 @@ SFUInteger SFPatternGetFeatureCount(SFPatternRef pattern);
  */
 void SFPatternGetFeatureTags(SFPatternRef pattern, SFTag *buffer);
 
+/**
+ * Tells whether the words of a text can be shaped independently with the pattern.
+ *
+ * The lookups of the pattern are analyzed when it is built. A pattern is space separable if none of
+ * them can match the space glyph, whether through a coverage, a context, a ligature component or a
+ * pair, so that no substitution or positioning reaches across a space.
+ *
+ * @param pattern
+ *      The pattern to query.
+ * @return
+ *      SFTrue if the words can be shaped independently, SFFalse otherwise.
+ * @note
+ *      Only the glyphs listed explicitly in the lookups are considered, so a context matching the
+ *      default class of a class definition is assumed not to match the space.
+ */
+SFBoolean SFPatternIsSpaceSeparable(SFPatternRef pattern);
+
+/**
+ * Returns the highest number of glyphs which any lookup of the pattern can match at once.
+ *
+ * The length covers the backtrack, input and lookahead glyphs of contextual lookups, the components
+ * of ligatures and the two glyphs of pairs, cursive connections and mark attachments. An edit to a
+ * text can only change the shaping of the glyphs lying within this many glyphs of it.
+ *
+ * @param pattern
+ *      The pattern to query.
+ * @return
+ *      The maximum context length of the pattern, or zero if it has no lookups.
+ */
+SFUInteger SFPatternGetContextLength(SFPatternRef pattern);
+
 SFPatternRef SFPatternRetain(SFPatternRef pattern);
 void SFPatternRelease(SFPatternRef pattern);
 
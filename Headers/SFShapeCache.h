@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_PUBLIC_SHAPE_CACHE_H
+#define _SF_PUBLIC_SHAPE_CACHE_H
+
+#include "SFBase.h"
+#include "SFPattern.h"
+
+/**
+ * The type used to represent a cache of shaping results.
+ */
+typedef struct _SFShapeCache *SFShapeCacheRef;
+
+/**
+ * The function used to lock a shard of a cache before it is accessed.
+ *
+ * @param object
+ *      The object associated with the cache.
+ * @param shard
+ *      The index of the shard to lock.
+ */
+typedef void (*SFShapeCacheProtocolLockFunc)(void *object, SFUInteger shard);
+
+/**
+ * The function used to unlock a shard of a cache after it has been accessed.
+ *
+ * @param object
+ *      The object associated with the cache.
+ * @param shard
+ *      The index of the shard to unlock.
+ */
+typedef void (*SFShapeCacheProtocolUnlockFunc)(void *object, SFUInteger shard);
+
+/**
+ * Structure containing the functions of a SFShapeCache.
+ */
+typedef struct _SFShapeCacheProtocol {
+    /**
+     * The function used to lock a shard, typically by acquiring a mutex kept for that shard.
+     */
+    SFShapeCacheProtocolLockFunc lock;
+    /**
+     * The function used to unlock a shard, typically by releasing a mutex kept for that shard.
+     */
+    SFShapeCacheProtocolUnlockFunc unlock;
+} SFShapeCacheProtocol;
+
+/**
+ * Creates a cache which keeps the shaping results of recently shaped texts, such as words of a
+ * paragraph, so that repeated texts are not shaped again.
+ *
+ * The results are looked up by the pattern, the text direction, the text mode, the shaping mode and
+ * the bytes of the text. The cache is split into shards, each holding its own share of the budget
+ * and discarding its least recently used results first, so that threads shaping different texts
+ * rarely wait for each other.
+ *
+ * The patterns are not retained by the cache, so that threads sharing a cache never update the
+ * reference counts of the patterns. Each pattern is identified by a number which is never given to
+ * another pattern, so the results of a released pattern are never returned for a new pattern
+ * created at the same address. Such results stay in the cache until they are evicted, or until
+ * they are discarded with SFShapeCachePurgePattern.
+ *
+ * @param protocol
+ *      A structure holding pointers to the locking functions of the shards, or NULL if the cache
+ *      will only be accessed by a single thread.
+ * @param object
+ *      An object associated with the cache, passed back to the locking functions.
+ * @param shardCount
+ *      The number of shards in which to split the cache. It must be at least one.
+ * @param byteBudget
+ *      The maximum number of bytes which the cached results may occupy.
+ * @return
+ *      A reference to a shape cache object.
+ */
+SFShapeCacheRef SFShapeCacheCreate(const SFShapeCacheProtocol *protocol, void *object, SFUInteger shardCount, SFUInteger byteBudget);
+
+/**
+ * Returns the number of lookups which found the results in the cache.
+ *
+ * @param cache
+ *      The cache for which to return the number of hits.
+ * @return
+ *      The number of hits since the cache was created.
+ */
+SFUInteger SFShapeCacheGetHitCount(SFShapeCacheRef cache);
+
+/**
+ * Returns the number of lookups which did not find the results in the cache.
+ *
+ * @param cache
+ *      The cache for which to return the number of misses.
+ * @return
+ *      The number of misses since the cache was created.
+ */
+SFUInteger SFShapeCacheGetMissCount(SFShapeCacheRef cache);
+
+/**
+ * Returns the number of bytes currently occupied by the cached results.
+ *
+ * @param cache
+ *      The cache for which to return the memory usage.
+ * @return
+ *      The number of bytes occupied by the cached results, never more than the budget.
+ */
+SFUInteger SFShapeCacheGetMemoryUsage(SFShapeCacheRef cache);
+
+/**
+ * Discards all results kept by the cache.
+ *
+ * @param cache
+ *      The cache to clear.
+ */
+void SFShapeCacheClear(SFShapeCacheRef cache);
+
+/**
+ * Discards all results which were shaped with a pattern.
+ *
+ * @param cache
+ *      The cache from which to discard the results.
+ * @param pattern
+ *      The pattern whose results are to be discarded.
+ */
+void SFShapeCachePurgePattern(SFShapeCacheRef cache, SFPatternRef pattern);
+
+SFShapeCacheRef SFShapeCacheRetain(SFShapeCacheRef cache);
+void SFShapeCacheRelease(SFShapeCacheRef cache);
+
+#endif
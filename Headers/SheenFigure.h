@@ -18,10 +18,13 @@
 #define _SHEEN_FIGURE_H
 
 #include <SFAlbum.h>
+#include <SFAlbumPool.h>
+#include <SFAllocator.h>
 #include <SFArtist.h>
 #include <SFBase.h>
 #include <SFFont.h>
 #include <SFPattern.h>
 #include <SFScheme.h>
+#include <SFShapeCache.h>
 
 #endif
@@ -16,9 +16,9 @@
 
 #include <SFConfig.h>
 #include <stddef.h>
-#include <stdlib.h>
 #include <string.h>
 
+#include "SFAllocator.h"
 #include "SFAssert.h"
 #include "SFBase.h"
 #include "SFCodepoints.h"
@@ -26,6 +26,69 @@
 
 static const SFGlyphMask _SFGlyphMaskEmpty = { { SFUInt16Max, 0 } };
 
+static void _SFAlbumBuildCodeunitToGlyphMap(SFAlbumRef album);
+
+/**
+ * Converts the index of a glyph into the index of filling lists by skipping the gap.
+ */
+#define _SFAlbumFillingIndex(album, index)  \
+(                                           \
+    (index) < (album)->_gapIndex            \
+  ? (index)                                 \
+  : (index) + (album)->_gapCount            \
+)
+
+/**
+ * Returns the number of heap bytes held by a list, ignoring its inline buffer.
+ */
+static SFUInteger _SFAlbumGetListMemory(_SFListRef list)
+{
+    if (list->_data != list->_inlineData) {
+        return list->capacity * list->_itemSize;
+    }
+
+    return 0;
+}
+
+static SFUInteger _SFAlbumGetMemory(SFAlbumRef album)
+{
+    return _SFAlbumGetListMemory((_SFListRef)&album->_indexMap)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_wideMap)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_glyphs)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_masks)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_associations)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_details)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_offsets)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_advances)
+         + _SFAlbumGetListMemory((_SFListRef)&album->_records);
+}
+
+static void _SFAlbumCountAllocation(SFAlbumRef album)
+{
+    SFUInteger memory = _SFAlbumGetMemory(album);
+
+    if (memory > album->_peakMemory) {
+        album->_peakMemory = memory;
+    }
+
+    album->_allocationCount++;
+}
+
+/**
+ * Reserves a range in one of the lists of the album, counting the allocation if the list had to
+ * grow for it.
+ */
+static void _SFAlbumReserveList(SFAlbumRef album, _SFListRef list, SFUInteger index, SFUInteger count)
+{
+    SFUInteger capacity = list->capacity;
+
+    _SFListReserveRange(list, index, count);
+
+    if (list->capacity != capacity) {
+        _SFAlbumCountAllocation(album);
+    }
+}
+
 SF_PRIVATE SFUInt16 _SFAlbumGetAntiFeatureMask(SFUInt16 featureMask)
 {
     /* The assumtion must NOT break that the feature mask will never be equal to default mask. */
@@ -36,7 +99,7 @@ SF_PRIVATE SFUInt16 _SFAlbumGetAntiFeatureMask(SFUInt16 featureMask)
 
 SFAlbumRef SFAlbumCreate(void)
 {
-    SFAlbumRef album = malloc(sizeof(SFAlbum));
+    SFAlbumRef album = SFAllocatorAllocate(sizeof(SFAlbum));
     SFAlbumInitialize(album);
 
     return album;
@@ -59,19 +122,701 @@ const SFGlyphID *SFAlbumGetGlyphIDsPtr(SFAlbumRef album)
 
 const SFPoint *SFAlbumGetGlyphOffsetsPtr(SFAlbumRef album)
 {
+    if (album->_state != _SFAlbumStateArranged) {
+        return NULL;
+    }
+
     return album->_offsets.items;
 }
 
 const SFAdvance *SFAlbumGetGlyphAdvancesPtr(SFAlbumRef album)
 {
+    if (album->_state != _SFAlbumStateArranged) {
+        return NULL;
+    }
+
     return album->_advances.items;
 }
 
+#define _SFRecordField(base, stride, index, type)   \
+    (*(type *)((SFUInt8 *)(base) + (index) * (stride)))
+
+void SFAlbumExportGlyphRecords(SFAlbumRef album, const SFGlyphRecordLayout *layout, SFUInteger index, SFUInteger count)
+{
+    SFBoolean isArranged = (album->_state == _SFAlbumStateArranged);
+    SFUInteger limit = index + count;
+    SFUInteger record;
+
+    /* The range must be valid and there should be no integer overflow. */
+    SFAssert(limit <= album->glyphCount && index <= limit);
+
+    for (record = 0; index < limit; index++, record++) {
+        if (layout->glyphIDs) {
+            _SFRecordField(layout->glyphIDs, layout->glyphIDStride, record, SFGlyphID) = album->_glyphs.items[index];
+        }
+        if (layout->offsets) {
+            SFPoint *offset = &_SFRecordField(layout->offsets, layout->offsetStride, record, SFPoint);
+
+            if (isArranged) {
+                *offset = album->_offsets.items[index];
+            } else {
+                offset->x = 0;
+                offset->y = 0;
+            }
+        }
+        if (layout->advances) {
+            _SFRecordField(layout->advances, layout->advanceStride, record, SFAdvance) = (isArranged ? album->_advances.items[index] : 0);
+        }
+        if (layout->clusters) {
+            _SFRecordField(layout->clusters, layout->clusterStride, record, SFUInt32) = album->_associations.items[index];
+        }
+    }
+}
+
+SFBoolean SFAlbumIsUnsafeToBreak(SFAlbumRef album, SFUInteger index)
+{
+    /* The album must be wrapped up. */
+    SFAssert(album->_state == _SFAlbumStateFilled || album->_state == _SFAlbumStateArranged);
+    /* The index must be valid. */
+    SFAssert(index < album->glyphCount);
+
+    return (album->_masks.items[index].section.traits & SFGlyphTraitUnsafeToBreak) != 0;
+}
+
+SFUInteger SFAlbumGetFontIndex(SFAlbumRef album, SFUInteger index)
+{
+    /* The album must be wrapped up. */
+    SFAssert(album->_state == _SFAlbumStateFilled || album->_state == _SFAlbumStateArranged);
+    /* The index must be valid. */
+    SFAssert(index < album->glyphCount);
+
+    /*
+     * The feature masks are no longer needed once wrapped up, so they hold the font index instead.
+     * Every path producing a wrapped up album must therefore either clear them as SFAlbumWrapUp
+     * does, or carry over the font indexes of another wrapped up album.
+     */
+    return album->_masks.items[index].section.feature;
+}
+
+SFUInteger SFAlbumGetAllocationCount(SFAlbumRef album)
+{
+    return album->_allocationCount;
+}
+
+SFUInteger SFAlbumGetMemoryUsage(SFAlbumRef album)
+{
+    return _SFAlbumGetMemory(album);
+}
+
+SFUInteger SFAlbumGetPeakMemoryUsage(SFAlbumRef album)
+{
+    return album->_peakMemory;
+}
+
+void SFAlbumSetRetainedCapacityLimit(SFAlbumRef album, SFUInteger limit)
+{
+    album->_retainedLimit = limit;
+}
+
 const SFUInteger *SFAlbumGetCodeunitToGlyphMapPtr(SFAlbumRef album)
 {
+    const SFUInt32 *indexMap = SFAlbumGetCodeunitToGlyphMap32Ptr(album);
+    SFUInteger codeunitCount = album->codeunitCount;
+
+    if (!indexMap) {
+        return NULL;
+    }
+
+    /* Widen the compact map on first request. */
+    if (album->_wideMap.count != codeunitCount) {
+        SFUInteger index;
+
+        SFListClear(&album->_wideMap);
+        _SFAlbumReserveList(album, (_SFListRef)&album->_wideMap, 0, codeunitCount);
+
+        for (index = 0; index < codeunitCount; index++) {
+            SFListSetVal(&album->_wideMap, index, indexMap[index]);
+        }
+    }
+
+    return album->_wideMap.items;
+}
+
+const SFUInt32 *SFAlbumGetCodeunitToGlyphMap32Ptr(SFAlbumRef album)
+{
+    /* A measured album never gets a map. */
+    if (album->_state == _SFAlbumStateMeasured) {
+        return NULL;
+    }
+
+    if (album->_isMapPending) {
+        _SFAlbumBuildCodeunitToGlyphMap(album);
+    }
+
     return album->_indexMap.items;
 }
 
+/**
+ * The identifier of a serialized album, read back in native byte order.
+ */
+#define _SFAlbumArchiveMagic        SFTagMake('S', 'F', 'A', 'L')
+
+/**
+ * The version of the serialization format, to be incremented whenever the layout changes.
+ */
+#define _SFAlbumArchiveVersion      3
+
+enum {
+    _SFAlbumArchiveFlagArranged = 1 << 0    /**< The archive contains offsets and advances. */
+};
+
+/**
+ * The fixed header of a serialized album, followed by its arrays. It holds 32-bit fields only, so
+ * that its layout is the same on every platform and the buffer needs four-byte alignment only.
+ */
+typedef struct _SFAlbumArchiveHeader {
+    SFUInt32 magic;
+    SFUInt32 version;
+    SFUInt32 patternHash;
+    SFUInt32 textHashLow;
+    SFUInt32 textHashHigh;
+    SFUInt32 codeunitCount;
+    SFUInt32 glyphCount;
+    SFUInt32 flags;
+} _SFAlbumArchiveHeader;
+
+/**
+ * Returns the size of the arrays of a serialized album, padded to four bytes.
+ */
+static SFUInteger _SFAlbumGetArchiveSize(SFUInteger codeunitCount, SFUInteger glyphCount, SFBoolean isArranged)
+{
+    SFUInteger size = sizeof(_SFAlbumArchiveHeader)
+                    + sizeof(SFUInt32) * codeunitCount      /* Index map */
+                    + sizeof(SFUInt32) * glyphCount         /* Clusters */
+                    + sizeof(SFGlyphMask) * glyphCount      /* Masks */
+                    + sizeof(SFGlyphID) * glyphCount;       /* Glyphs */
+
+    if (isArranged) {
+        size += (sizeof(SFPoint) + sizeof(SFAdvance)) * glyphCount;
+    }
+
+    return (size + 3) & ~(SFUInteger)3;
+}
+
+SFUInteger SFAlbumSerialize(SFAlbumRef album, const SFShapeKey *key, void *buffer, SFUInteger capacity)
+{
+    SFBoolean isArranged = (album->_state == _SFAlbumStateArranged);
+    SFUInteger codeunitCount = album->codeunitCount;
+    SFUInteger glyphCount = album->glyphCount;
+    SFUInteger size = _SFAlbumGetArchiveSize(codeunitCount, glyphCount, isArranged);
+
+    /* The buffer must be aligned for the arrays. */
+    SFAssert(((SFUInteger)buffer & 3) == 0);
+
+    /* A measured album has no complete results to store. */
+    if (album->_state == _SFAlbumStateMeasured) {
+        return 0;
+    }
+
+    if (buffer && capacity >= size) {
+        _SFAlbumArchiveHeader *header = buffer;
+        SFUInt8 *data = (SFUInt8 *)(header + 1);
+
+        header->magic = _SFAlbumArchiveMagic;
+        header->version = _SFAlbumArchiveVersion;
+        header->patternHash = (key ? key->patternHash : 0);
+        header->textHashLow = (key ? (SFUInt32)key->textHash : 0);
+        header->textHashHigh = (key ? (SFUInt32)(key->textHash >> 32) : 0);
+        header->codeunitCount = (SFUInt32)codeunitCount;
+        header->glyphCount = (SFUInt32)glyphCount;
+        header->flags = (isArranged ? _SFAlbumArchiveFlagArranged : 0);
+
+        /* Copy the arrays in order of their alignment, keeping each one aligned. */
+        memcpy(data, SFAlbumGetCodeunitToGlyphMap32Ptr(album), sizeof(SFUInt32) * codeunitCount);
+        data += sizeof(SFUInt32) * codeunitCount;
+        memcpy(data, album->_associations.items, sizeof(SFUInt32) * glyphCount);
+        data += sizeof(SFUInt32) * glyphCount;
+        memcpy(data, album->_masks.items, sizeof(SFGlyphMask) * glyphCount);
+        data += sizeof(SFGlyphMask) * glyphCount;
+
+        if (isArranged) {
+            memcpy(data, album->_offsets.items, sizeof(SFPoint) * glyphCount);
+            data += sizeof(SFPoint) * glyphCount;
+            memcpy(data, album->_advances.items, sizeof(SFAdvance) * glyphCount);
+            data += sizeof(SFAdvance) * glyphCount;
+        }
+
+        memcpy(data, album->_glyphs.items, sizeof(SFGlyphID) * glyphCount);
+        data += sizeof(SFGlyphID) * glyphCount;
+
+        /* Clear the padding so that the output is deterministic. */
+        memset(data, 0, size - (SFUInteger)(data - (SFUInt8 *)buffer));
+    }
+
+    return size;
+}
+
+/**
+ * Copies an array of a serialized album into one of its lists.
+ */
+static const SFUInt8 *_SFAlbumLoadList(SFAlbumRef album, _SFListRef list, const SFUInt8 *data, SFUInteger count)
+{
+    SFUInteger length = list->_itemSize * count;
+
+    _SFAlbumReserveList(album, list, 0, count);
+    memcpy(list->_data, data, length);
+
+    return data + length;
+}
+
+/**
+ * Checks that the map and the clusters of a serialized album only refer to its own glyphs and code
+ * units, so that a corrupt buffer cannot make the album read or write out of its lists.
+ */
+static SFBoolean _SFAlbumHasValidIndexes(const _SFAlbumArchiveHeader *header)
+{
+    const SFUInt32 *indexMap = (const SFUInt32 *)(header + 1);
+    const SFUInt32 *associations = indexMap + header->codeunitCount;
+    SFUInteger index;
+
+    for (index = 0; index < header->codeunitCount; index++) {
+        /* A text without glyphs maps all of its code units to the first glyph. */
+        if (indexMap[index] >= header->glyphCount && indexMap[index] != 0) {
+            return SFFalse;
+        }
+    }
+
+    for (index = 0; index < header->glyphCount; index++) {
+        if (associations[index] >= header->codeunitCount) {
+            return SFFalse;
+        }
+    }
+
+    return SFTrue;
+}
+
+static SFBoolean _SFAlbumIsValidArchive(const void *buffer, SFUInteger size, const SFShapeKey *key)
+{
+    const _SFAlbumArchiveHeader *header = buffer;
+    SFBoolean isArranged;
+    SFUInteger glyphSize;
+
+    /* The buffer must be aligned for the arrays. */
+    SFAssert(((SFUInteger)buffer & 3) == 0);
+
+    if (!buffer || size < sizeof(_SFAlbumArchiveHeader)
+        || header->magic != _SFAlbumArchiveMagic || header->version != _SFAlbumArchiveVersion) {
+        return SFFalse;
+    }
+
+    if (key && (header->patternHash != key->patternHash
+                || header->textHashLow != (SFUInt32)key->textHash
+                || header->textHashHigh != (SFUInt32)(key->textHash >> 32))) {
+        return SFFalse;
+    }
+
+    isArranged = (header->flags & _SFAlbumArchiveFlagArranged) != 0;
+    glyphSize = sizeof(SFUInt32) + sizeof(SFGlyphMask) + sizeof(SFGlyphID);
+    if (isArranged) {
+        glyphSize += sizeof(SFPoint) + sizeof(SFAdvance);
+    }
+
+    /* Bound each count by the buffer first so that the total size cannot overflow. */
+    if (header->codeunitCount > size / sizeof(SFUInt32) || header->glyphCount > size / glyphSize
+        || _SFAlbumGetArchiveSize(header->codeunitCount, header->glyphCount, isArranged) > size) {
+        return SFFalse;
+    }
+
+    return _SFAlbumHasValidIndexes(header);
+}
+
+static void _SFAlbumLoadArchive(SFAlbumRef album, const _SFAlbumArchiveHeader *header)
+{
+    SFBoolean isArranged = (header->flags & _SFAlbumArchiveFlagArranged) != 0;
+    const SFUInt8 *data = (const SFUInt8 *)(header + 1);
+
+    /* Resetting reserves the map, so it is copied in place. */
+    SFAlbumReset(album, NULL, header->codeunitCount);
+    memcpy(album->_indexMap.items, data, sizeof(SFUInt32) * header->codeunitCount);
+    data += sizeof(SFUInt32) * header->codeunitCount;
+
+    album->glyphCount = header->glyphCount;
+    data = _SFAlbumLoadList(album, (_SFListRef)&album->_associations, data, album->glyphCount);
+    data = _SFAlbumLoadList(album, (_SFListRef)&album->_masks, data, album->glyphCount);
+
+    if (isArranged) {
+        data = _SFAlbumLoadList(album, (_SFListRef)&album->_offsets, data, album->glyphCount);
+        data = _SFAlbumLoadList(album, (_SFListRef)&album->_advances, data, album->glyphCount);
+    }
+
+    _SFAlbumLoadList(album, (_SFListRef)&album->_glyphs, data, album->glyphCount);
+
+    album->_state = (isArranged ? _SFAlbumStateArranged : _SFAlbumStateFilled);
+}
+
+SFAlbumRef SFAlbumCreateFromBuffer(const void *buffer, SFUInteger size, const SFShapeKey *key)
+{
+    SFAlbumRef album = NULL;
+
+    if (_SFAlbumIsValidArchive(buffer, size, key)) {
+        album = SFAlbumCreate();
+        _SFAlbumLoadArchive(album, buffer);
+    }
+
+    return album;
+}
+
+SF_INTERNAL SFBoolean SFAlbumLoadBuffer(SFAlbumRef album, const void *buffer, SFUInteger size)
+{
+    if (_SFAlbumIsValidArchive(buffer, size, NULL)) {
+        _SFAlbumLoadArchive(album, buffer);
+        return SFTrue;
+    }
+
+    return SFFalse;
+}
+
+/**
+ * Appends the items of a list of a segment at the end of the same list of the album.
+ */
+static void _SFAlbumAppendList(SFAlbumRef album, _SFListRef list, _SFListRef segmentList, SFUInteger count)
+{
+    SFUInteger index = list->count;
+
+    _SFAlbumReserveList(album, list, index, count);
+    memcpy(list->_data + (list->_itemSize * index), segmentList->_data, list->_itemSize * count);
+}
+
+SF_INTERNAL void SFAlbumAppendSegment(SFAlbumRef album, SFAlbumRef segment, SFUInteger codeunitOffset)
+{
+    SFBoolean isArranged = (segment->_state == _SFAlbumStateArranged);
+    SFUInteger glyphIndex = album->glyphCount;
+    SFUInteger glyphCount = segment->glyphCount;
+    SFUInt32 *associations;
+    SFUInteger index;
+
+    /* The segment must be wrapped up. */
+    SFAssert(segment->_state == _SFAlbumStateFilled || segment->_state == _SFAlbumStateArranged);
+    /* The segment must lie within the text of the album. */
+    SFAssert(codeunitOffset + segment->codeunitCount <= album->codeunitCount);
+
+    _SFAlbumAppendList(album, (_SFListRef)&album->_glyphs, (_SFListRef)&segment->_glyphs, glyphCount);
+    _SFAlbumAppendList(album, (_SFListRef)&album->_associations, (_SFListRef)&segment->_associations, glyphCount);
+    _SFAlbumAppendList(album, (_SFListRef)&album->_masks, (_SFListRef)&segment->_masks, glyphCount);
+
+    if (isArranged) {
+        _SFAlbumAppendList(album, (_SFListRef)&album->_offsets, (_SFListRef)&segment->_offsets, glyphCount);
+        _SFAlbumAppendList(album, (_SFListRef)&album->_advances, (_SFListRef)&segment->_advances, glyphCount);
+    }
+
+    /* Move the associations of the segment to its position in the whole text. */
+    associations = album->_associations.items;
+    for (index = glyphIndex; index < glyphIndex + glyphCount; index++) {
+        associations[index] += (SFUInt32)codeunitOffset;
+    }
+
+    album->glyphCount += glyphCount;
+    album->_isMapPending = SFTrue;
+    album->_state = (isArranged ? _SFAlbumStateArranged : _SFAlbumStateFilled);
+}
+
+/**
+ * Makes a list of a copy refer to the same items as the list of the source album. The heap buffer
+ * of the source is lent to both lists by treating it as their inline buffer, so that neither of
+ * them frees it.
+ *
+ * @return
+ *      SFTrue if a heap buffer was lent, SFFalse if the items were copied.
+ */
+static SFBoolean _SFAlbumShareList(_SFListRef source, _SFListRef copy, void *sourceInline)
+{
+    /* A list without items has nothing to share, and may not even have a buffer. */
+    if (source->count == 0) {
+        return SFFalse;
+    }
+
+    if (source->_data == sourceInline || source->count <= SF_ALBUM_INLINE_CAPACITY) {
+        /* Inline buffers and short lists hold only a few items, so they are copied. */
+        SFListReserveRange(copy, 0, source->count);
+        memcpy(copy->_data, source->_data, source->_itemSize * source->count);
+
+        return SFFalse;
+    }
+
+    source->_inlineData = source->_data;
+    source->_inlineCapacity = source->capacity;
+
+    copy->_data = source->_data;
+    copy->count = source->count;
+    copy->capacity = source->capacity;
+    copy->_inlineData = source->_data;
+    copy->_inlineCapacity = source->capacity;
+
+    return SFTrue;
+}
+
+/**
+ * Makes a list stop referring to a shared buffer, either by taking the buffer back as its own heap
+ * storage or by returning to the inline buffer of the album, if the list has any.
+ */
+static void _SFAlbumDetachList(_SFListRef list, void *inlineBuffer, SFBoolean reclaims)
+{
+    SFUInteger inlineCapacity = (inlineBuffer ? SF_ALBUM_INLINE_CAPACITY : 0);
+
+    if (list->_data != inlineBuffer) {
+        if (reclaims) {
+            list->_inlineData = inlineBuffer;
+            list->_inlineCapacity = inlineCapacity;
+        } else if (inlineBuffer) {
+            _SFListInitializeInline(list, list->_itemSize, inlineBuffer, inlineCapacity);
+        } else {
+            _SFListInitialize(list, list->_itemSize);
+        }
+    }
+}
+
+static void _SFAlbumDetachShare(SFAlbumRef album)
+{
+    _SFAlbumShareRef share = album->_share;
+
+    if (share) {
+        SFBoolean reclaims = (--share->_retainCount == 0);
+
+        _SFAlbumDetachList((_SFListRef)&album->_indexMap, album->_inline.indexMap, reclaims);
+        _SFAlbumDetachList((_SFListRef)&album->_glyphs, album->_inline.glyphs, reclaims);
+        _SFAlbumDetachList((_SFListRef)&album->_associations, album->_inline.associations, reclaims);
+        _SFAlbumDetachList((_SFListRef)&album->_masks, NULL, reclaims);
+        _SFAlbumDetachList((_SFListRef)&album->_offsets, NULL, reclaims);
+        _SFAlbumDetachList((_SFListRef)&album->_advances, album->_inline.advances, reclaims);
+
+        if (reclaims) {
+            SFAllocatorDeallocate(share);
+        }
+
+        album->_share = NULL;
+    }
+}
+
+SFAlbumRef SFAlbumCreateCopy(SFAlbumRef album)
+{
+    SFAlbumRef copy;
+    SFBoolean isShared;
+
+    /* The album must not be in the middle of shaping. */
+    SFAssert(album->codepoints == NULL && album->glyphInput == NULL);
+
+    /* A measured album has no complete results to share. */
+    if (album->_state == _SFAlbumStateMeasured) {
+        return NULL;
+    }
+
+    /* Build the map beforehand so that neither album writes into the shared buffer. */
+    if (album->_isMapPending) {
+        _SFAlbumBuildCodeunitToGlyphMap(album);
+    }
+
+    copy = SFAlbumCreate();
+    copy->codeunitCount = album->codeunitCount;
+    copy->glyphCount = album->glyphCount;
+    copy->_state = album->_state;
+
+    isShared = _SFAlbumShareList((_SFListRef)&album->_indexMap, (_SFListRef)&copy->_indexMap, album->_inline.indexMap);
+    isShared |= _SFAlbumShareList((_SFListRef)&album->_glyphs, (_SFListRef)&copy->_glyphs, album->_inline.glyphs);
+    isShared |= _SFAlbumShareList((_SFListRef)&album->_associations, (_SFListRef)&copy->_associations, album->_inline.associations);
+    isShared |= _SFAlbumShareList((_SFListRef)&album->_masks, (_SFListRef)&copy->_masks, NULL);
+    isShared |= _SFAlbumShareList((_SFListRef)&album->_offsets, (_SFListRef)&copy->_offsets, NULL);
+    isShared |= _SFAlbumShareList((_SFListRef)&album->_advances, (_SFListRef)&copy->_advances, album->_inline.advances);
+
+    if (isShared) {
+        if (!album->_share) {
+            album->_share = SFAllocatorAllocate(sizeof(_SFAlbumShare));
+            album->_share->_retainCount = 1;
+        }
+
+        album->_share->_retainCount++;
+        copy->_share = album->_share;
+    }
+
+    return copy;
+}
+
+/**
+ * Replaces a range of items in a list of the album with all items of the same list of a segment.
+ */
+static void _SFAlbumSpliceList(SFAlbumRef album, _SFListRef list, _SFListRef segmentList,
+    SFUInteger index, SFUInteger removeCount, SFUInteger insertCount)
+{
+    if (insertCount > removeCount) {
+        _SFAlbumReserveList(album, list, index + removeCount, insertCount - removeCount);
+    } else if (removeCount > insertCount) {
+        _SFListRemoveRange(list, index + insertCount, removeCount - insertCount);
+    }
+
+    memcpy(list->_data + (list->_itemSize * index), segmentList->_data, list->_itemSize * insertCount);
+}
+
+/**
+ * Copies the items back into a list if it has let go of the shared buffer holding them.
+ */
+static void _SFAlbumRestoreList(SFAlbumRef album, _SFListRef list, void *items, SFUInteger count)
+{
+    if (list->_data != items) {
+        _SFAlbumReserveList(album, list, 0, count);
+        memcpy(list->_data, items, list->_itemSize * count);
+    }
+}
+
+/**
+ * Makes the album write into its own storage, leaving the results of its copies intact.
+ */
+static void _SFAlbumUnshare(SFAlbumRef album)
+{
+    if (album->_share) {
+        /* The shared buffers outlive the detachment as long as a copy still refers to them. */
+        void *glyphs = album->_glyphs.items;
+        void *masks = album->_masks.items;
+        void *associations = album->_associations.items;
+        void *offsets = album->_offsets.items;
+        void *advances = album->_advances.items;
+
+        _SFAlbumDetachShare(album);
+
+        _SFAlbumRestoreList(album, (_SFListRef)&album->_glyphs, glyphs, album->glyphCount);
+        _SFAlbumRestoreList(album, (_SFListRef)&album->_masks, masks, album->glyphCount);
+        _SFAlbumRestoreList(album, (_SFListRef)&album->_associations, associations, album->glyphCount);
+
+        if (album->_state == _SFAlbumStateArranged) {
+            _SFAlbumRestoreList(album, (_SFListRef)&album->_offsets, offsets, album->glyphCount);
+            _SFAlbumRestoreList(album, (_SFListRef)&album->_advances, advances, album->glyphCount);
+        }
+
+        /* The map is built again from the associations. */
+        if (album->_indexMap.count != album->codeunitCount) {
+            SFListClear(&album->_indexMap);
+            _SFAlbumReserveList(album, (_SFListRef)&album->_indexMap, 0, album->codeunitCount);
+        }
+        album->_isMapPending = SFTrue;
+    }
+}
+
+SF_INTERNAL void SFAlbumReplaceSegment(SFAlbumRef album, SFUInteger glyphIndex, SFUInteger glyphCount,
+    SFUInteger codeunitIndex, SFUInteger codeunitCount, SFAlbumRef segment)
+{
+    SFBoolean isArranged = (album->_state == _SFAlbumStateArranged);
+    SFUInteger segmentCount = segment->glyphCount;
+    SFUInteger codeunitEnd = codeunitIndex + codeunitCount;
+    SFUInteger newCodeunitCount;
+    SFUInt32 *associations;
+    SFUInteger index;
+
+    /* The album must be wrapped up. */
+    SFAssert(album->_state == _SFAlbumStateFilled || isArranged);
+    /* The segment must be wrapped up in the same way, unless it is empty. */
+    SFAssert(segment->_state == album->_state || segmentCount == 0);
+    /* The ranges must lie within the album. */
+    SFAssert(glyphIndex + glyphCount <= album->glyphCount && codeunitEnd <= album->codeunitCount);
+
+    _SFAlbumUnshare(album);
+
+    _SFAlbumSpliceList(album, (_SFListRef)&album->_glyphs, (_SFListRef)&segment->_glyphs, glyphIndex, glyphCount, segmentCount);
+    _SFAlbumSpliceList(album, (_SFListRef)&album->_masks, (_SFListRef)&segment->_masks, glyphIndex, glyphCount, segmentCount);
+    _SFAlbumSpliceList(album, (_SFListRef)&album->_associations, (_SFListRef)&segment->_associations, glyphIndex, glyphCount, segmentCount);
+
+    if (isArranged) {
+        _SFAlbumSpliceList(album, (_SFListRef)&album->_offsets, (_SFListRef)&segment->_offsets, glyphIndex, glyphCount, segmentCount);
+        _SFAlbumSpliceList(album, (_SFListRef)&album->_advances, (_SFListRef)&segment->_advances, glyphIndex, glyphCount, segmentCount);
+    }
+
+    album->glyphCount = album->glyphCount - glyphCount + segmentCount;
+    newCodeunitCount = album->codeunitCount - codeunitCount + segment->codeunitCount;
+
+    /* Move the associations of the segment to its position, and the following ones by the change in length. */
+    associations = album->_associations.items;
+    for (index = 0; index < album->glyphCount; index++) {
+        if (index >= glyphIndex && index < glyphIndex + segmentCount) {
+            associations[index] += (SFUInt32)codeunitIndex;
+        } else if (associations[index] >= codeunitEnd) {
+            associations[index] = (SFUInt32)(associations[index] - codeunitCount + segment->codeunitCount);
+        }
+    }
+
+    /* Resize the map for the new text, leaving it to be built on first access. */
+    if (newCodeunitCount > album->codeunitCount) {
+        _SFAlbumReserveList(album, (_SFListRef)&album->_indexMap, album->codeunitCount, newCodeunitCount - album->codeunitCount);
+    } else {
+        SFListRemoveRange(&album->_indexMap, newCodeunitCount, album->codeunitCount - newCodeunitCount);
+    }
+    SFListClear(&album->_wideMap);
+
+    album->codeunitCount = newCodeunitCount;
+    album->_isMapPending = SFTrue;
+}
+
+SF_INTERNAL void SFAlbumSetFontIndex(SFAlbumRef album, SFUInt16 fontIndex)
+{
+    SFUInteger index;
+
+    /* The album must be wrapped up. */
+    SFAssert(album->_state == _SFAlbumStateFilled || album->_state == _SFAlbumStateArranged);
+
+    _SFAlbumUnshare(album);
+
+    for (index = 0; index < album->glyphCount; index++) {
+        album->_masks.items[index].section.feature = fontIndex;
+    }
+}
+
+SF_INTERNAL void SFAlbumRemoveContext(SFAlbumRef album, SFUInteger leadingCount, SFUInteger trailingCount)
+{
+    SFBoolean isArranged = (album->_state == _SFAlbumStateArranged);
+    SFUInteger codeunitEnd = album->codeunitCount - trailingCount;
+    SFUInteger newCodeunitCount = codeunitEnd - leadingCount;
+    SFUInteger glyphCount = 0;
+    SFUInteger index;
+
+    /* The album must be wrapped up. */
+    SFAssert(album->_state == _SFAlbumStateFilled || isArranged);
+    /* The context must lie within the album. */
+    SFAssert(leadingCount + trailingCount <= album->codeunitCount);
+
+    _SFAlbumUnshare(album);
+
+    /* Keep the glyphs of the text in place, whatever their order is. */
+    for (index = 0; index < album->glyphCount; index++) {
+        SFUInt32 association = album->_associations.items[index];
+
+        if (association >= leadingCount && association < codeunitEnd) {
+            album->_glyphs.items[glyphCount] = album->_glyphs.items[index];
+            album->_masks.items[glyphCount] = album->_masks.items[index];
+            album->_associations.items[glyphCount] = (SFUInt32)(association - leadingCount);
+
+            if (isArranged) {
+                album->_offsets.items[glyphCount] = album->_offsets.items[index];
+                album->_advances.items[glyphCount] = album->_advances.items[index];
+            }
+
+            glyphCount += 1;
+        }
+    }
+
+    SFListRemoveRange(&album->_glyphs, glyphCount, album->glyphCount - glyphCount);
+    SFListRemoveRange(&album->_masks, glyphCount, album->glyphCount - glyphCount);
+    SFListRemoveRange(&album->_associations, glyphCount, album->glyphCount - glyphCount);
+
+    if (isArranged) {
+        SFListRemoveRange(&album->_offsets, glyphCount, album->glyphCount - glyphCount);
+        SFListRemoveRange(&album->_advances, glyphCount, album->glyphCount - glyphCount);
+    }
+
+    /* Resize the map for the remaining text, leaving it to be built on first access. */
+    SFListRemoveRange(&album->_indexMap, newCodeunitCount, album->codeunitCount - newCodeunitCount);
+    SFListClear(&album->_wideMap);
+
+    album->glyphCount = glyphCount;
+    album->codeunitCount = newCodeunitCount;
+    album->_isMapPending = SFTrue;
+}
+
 SFAlbumRef SFAlbumRetain(SFAlbumRef album)
 {
     if (album) {
@@ -85,80 +830,280 @@ void SFAlbumRelease(SFAlbumRef album)
 {
     if (album && --album->_retainCount == 0) {
         SFAlbumFinalize(album);
+        SFAllocatorDeallocate(album);
     }
 }
 
 SF_INTERNAL void SFAlbumInitialize(SFAlbumRef album)
 {
     album->codepoints = NULL;
+    album->glyphInput = NULL;
     album->codeunitCount = 0;
     album->glyphCount = 0;
 
-    SFListInitialize(&album->_indexMap, sizeof(SFUInteger));
-    SFListInitialize(&album->_glyphs, sizeof(SFGlyphID));
+    SFListInitializeInline(&album->_indexMap, sizeof(SFUInt32), album->_inline.indexMap, SF_ALBUM_INLINE_CAPACITY);
+    SFListInitialize(&album->_wideMap, sizeof(SFUInteger));
+    SFListInitializeInline(&album->_glyphs, sizeof(SFGlyphID), album->_inline.glyphs, SF_ALBUM_INLINE_CAPACITY);
+    SFListInitialize(&album->_masks, sizeof(SFGlyphMask));
+    SFListInitializeInline(&album->_associations, sizeof(SFUInt32), album->_inline.associations, SF_ALBUM_INLINE_CAPACITY);
     SFListInitialize(&album->_details, sizeof(SFGlyphDetail));
     SFListInitialize(&album->_offsets, sizeof(SFPoint));
-    SFListInitialize(&album->_advances, sizeof(SFAdvance));
-
+    SFListInitializeInline(&album->_advances, sizeof(SFAdvance), album->_inline.advances, SF_ALBUM_INLINE_CAPACITY);
+    SFListInitialize(&album->_records, sizeof(SFCodepointRecord));
+    album->_share = NULL;
+
+    album->_gapIndex = 0;
+    album->_gapCount = 0;
+    album->_allocationCount = 0;
+    album->_peakMemory = 0;
+    album->_retainedLimit = SFUIntegerMax;
     album->_version = 0;
+    album->_isMapPending = SFFalse;
     album->_state = _SFAlbumStateEmpty;
     album->_retainCount = 1;
 }
 
+/**
+ * Returns the number of bytes taken by a code unit in all lists of the album, assuming one glyph
+ * per code unit.
+ */
+static SFUInteger _SFAlbumGetCodeunitMemory(void)
+{
+    return sizeof(SFUInt32)           /* Index map */
+         + sizeof(SFUInteger)         /* Wide map */
+         + sizeof(SFGlyphID)          /* Glyphs */
+         + sizeof(SFGlyphMask)        /* Masks */
+         + sizeof(SFUInt32)           /* Associations */
+         + sizeof(SFGlyphDetail)      /* Details */
+         + sizeof(SFPoint)            /* Offsets */
+         + sizeof(SFAdvance)          /* Advances */
+         + sizeof(SFCodepointRecord); /* Records */
+}
+
+static void _SFAlbumShrinkList(_SFListRef list, SFUInteger capacity)
+{
+    if (list->capacity > capacity) {
+        /* A list allocated on first use is released entirely rather than kept without room. */
+        if (capacity == 0 && !list->_inlineData) {
+            _SFListFinalize(list);
+            _SFListInitialize(list, list->_itemSize);
+        } else {
+            _SFListSetCapacity(list, capacity);
+        }
+    }
+}
+
+/**
+ * Shrinks the heap storage of all empty lists to the given capacity, returning them to their
+ * inline buffers if it fits in them.
+ */
+static void _SFAlbumShrinkStorage(SFAlbumRef album, SFUInteger capacity)
+{
+    _SFAlbumShrinkList((_SFListRef)&album->_indexMap, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_wideMap, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_glyphs, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_masks, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_associations, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_details, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_offsets, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_advances, capacity);
+    _SFAlbumShrinkList((_SFListRef)&album->_records, capacity);
+}
+
 SF_INTERNAL void SFAlbumReset(SFAlbumRef album, SFCodepointsRef codepoints, SFUInteger codeunitCount)
 {
+    /* The code unit count must be representable by a compact index. */
+    SFAssert(codeunitCount < SFUInt32Max);
+
+    /* The previous results are discarded anyway, so shared buffers are left without copying. */
+    _SFAlbumDetachShare(album);
+
     album->codepoints = codepoints;
+    album->glyphInput = NULL;
     album->codeunitCount = codeunitCount;
     album->glyphCount = 0;
+    album->_allocationCount = 0;
 
     SFListClear(&album->_indexMap);
-    SFListReserveRange(&album->_indexMap, 0, codeunitCount);
-
+    SFListClear(&album->_wideMap);
     SFListClear(&album->_glyphs);
+    SFListClear(&album->_masks);
+    SFListClear(&album->_associations);
     SFListClear(&album->_details);
     SFListClear(&album->_offsets);
     SFListClear(&album->_advances);
+    SFListClear(&album->_records);
 
+    /*
+     * Shrink the storage exceeding the limit to what fits in it, but not below what the new text is
+     * expected to need, so that it is not allocated again right away.
+     */
+    if (_SFAlbumGetMemory(album) > album->_retainedLimit) {
+        SFUInteger capacity = album->_retainedLimit / _SFAlbumGetCodeunitMemory();
+
+        if (capacity < codeunitCount) {
+            capacity = codeunitCount;
+        }
+
+        _SFAlbumShrinkStorage(album, capacity);
+    }
+
+    _SFAlbumReserveList(album, (_SFListRef)&album->_indexMap, 0, codeunitCount);
+
+    album->_gapIndex = 0;
+    album->_gapCount = 0;
     album->_version = 0;
+    album->_isMapPending = SFFalse;
     album->_state = _SFAlbumStateEmpty;
 }
 
+SF_INTERNAL void SFAlbumResetForGlyphs(SFAlbumRef album, SFGlyphInputRef glyphInput, SFUInteger codeunitCount)
+{
+    SFAlbumReset(album, NULL, codeunitCount);
+    album->glyphInput = glyphInput;
+}
+
+static void _SFAlbumGrowList(_SFListRef list, SFUInteger capacity)
+{
+    if (list->capacity < capacity) {
+        _SFListSetCapacity(list, capacity);
+    }
+}
+
+SF_INTERNAL void SFAlbumReserveCapacity(SFAlbumRef album, SFUInteger codeunitCount)
+{
+    SFUInteger memory = _SFAlbumGetMemory(album);
+
+    /* The album must not be sharing its buffers with a copy. */
+    SFAssert(album->_share == NULL);
+
+    _SFAlbumGrowList((_SFListRef)&album->_indexMap, codeunitCount);
+    _SFAlbumGrowList((_SFListRef)&album->_glyphs, codeunitCount);
+    _SFAlbumGrowList((_SFListRef)&album->_masks, codeunitCount);
+    _SFAlbumGrowList((_SFListRef)&album->_associations, codeunitCount);
+    _SFAlbumGrowList((_SFListRef)&album->_details, codeunitCount);
+    _SFAlbumGrowList((_SFListRef)&album->_offsets, codeunitCount);
+    _SFAlbumGrowList((_SFListRef)&album->_advances, codeunitCount);
+    _SFAlbumGrowList((_SFListRef)&album->_records, codeunitCount);
+
+    if (_SFAlbumGetMemory(album) != memory) {
+        _SFAlbumCountAllocation(album);
+    }
+}
+
+SF_INTERNAL SFCodepointRecord *SFAlbumReserveRecords(SFAlbumRef album, SFUInteger count)
+{
+    SFListClear(&album->_records);
+    _SFAlbumReserveList(album, (_SFListRef)&album->_records, 0, count);
+
+    return album->_records.items;
+}
+
+static void _SFAlbumReserveFillingRange(SFAlbumRef album, SFUInteger index, SFUInteger count)
+{
+    _SFAlbumReserveList(album, (_SFListRef)&album->_glyphs, index, count);
+    _SFAlbumReserveList(album, (_SFListRef)&album->_masks, index, count);
+    _SFAlbumReserveList(album, (_SFListRef)&album->_associations, index, count);
+}
+
+static void _SFAlbumMoveFillingRange(SFAlbumRef album, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger count)
+{
+    SFListMoveRange(&album->_glyphs, srcIndex, dstIndex, count);
+    SFListMoveRange(&album->_masks, srcIndex, dstIndex, count);
+    SFListMoveRange(&album->_associations, srcIndex, dstIndex, count);
+}
+
+static void _SFAlbumRemoveFillingRange(SFAlbumRef album, SFUInteger index, SFUInteger count)
+{
+    SFListRemoveRange(&album->_glyphs, index, count);
+    SFListRemoveRange(&album->_masks, index, count);
+    SFListRemoveRange(&album->_associations, index, count);
+}
+
+/**
+ * Places the gap at the given glyph index, making sure that it has room for specified number of
+ * glyphs.
+ */
+static void _SFAlbumPrepareGap(SFAlbumRef album, SFUInteger index, SFUInteger count)
+{
+    SFUInteger gapIndex = album->_gapIndex;
+    SFUInteger gapCount = album->_gapCount;
+
+    /* The index must be valid. */
+    SFAssert(index <= album->glyphCount);
+
+    if (gapCount < count) {
+        /* Grow the gap geometrically so that subsequent reservations remain cheap. */
+        SFUInteger extraCount = (count > album->glyphCount ? count : album->glyphCount);
+
+        _SFAlbumReserveFillingRange(album, gapIndex + gapCount, extraCount);
+        gapCount += extraCount;
+    }
+
+    if (index < gapIndex) {
+        /* Move the glyphs lying before the gap to its end. */
+        _SFAlbumMoveFillingRange(album, index, index + gapCount, gapIndex - index);
+    } else if (index > gapIndex) {
+        /* Move the glyphs lying after the gap to its start. */
+        _SFAlbumMoveFillingRange(album, gapIndex + gapCount, gapIndex, index - gapIndex);
+    }
+
+    album->_gapIndex = index;
+    album->_gapCount = gapCount;
+}
+
+/**
+ * Takes the given number of glyphs from the gap, placing them at its start.
+ */
+static void _SFAlbumConsumeGap(SFAlbumRef album, SFUInteger index, SFUInteger count)
+{
+    _SFAlbumPrepareGap(album, index, count);
+
+    album->_gapIndex += count;
+    album->_gapCount -= count;
+    album->glyphCount += count;
+}
+
 SF_INTERNAL void SFAlbumBeginFilling(SFAlbumRef album)
 {
-	SFUInteger glyphCapacity = album->codeunitCount;
+    SFUInteger glyphCapacity = album->codeunitCount;
 
-    SFListReserveRange(&album->_glyphs, 0, glyphCapacity);
-    SFListReserveRange(&album->_details, 0, glyphCapacity);
+    /* Keep the initial capacity as gap so that discovered glyphs are added in place. */
+    _SFAlbumReserveFillingRange(album, 0, glyphCapacity);
+    album->_gapIndex = 0;
+    album->_gapCount = glyphCapacity;
 
-	album->_state = _SFAlbumStateFilling;
+    album->_state = _SFAlbumStateFilling;
 }
 
 SF_INTERNAL void SFAlbumAddGlyph(SFAlbumRef album, SFGlyphID glyph, SFGlyphTraits traits, SFUInteger association)
 {
     SFUInteger index;
-    SFGlyphDetailRef detail;
+    SFGlyphMask *mask;
 
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
     album->_version++;
-    index = album->glyphCount++;
-    detail = SFListGetRef(&album->_details, index);
+    index = album->glyphCount;
+    _SFAlbumConsumeGap(album, index, 1);
+    mask = SFListGetRef(&album->_masks, index);
 
-    /* Initialize the glyph along with its details. */
+    /* Initialize the glyph along with its mask and association. */
     SFListSetVal(&album->_glyphs, index, glyph);
-    detail->association = association;
-    detail->mask.section.feature = SFUInt16Max;
-    detail->mask.section.traits = traits;
+    SFListSetVal(&album->_associations, index, (SFUInt32)association);
+    mask->section.feature = SFUInt16Max;
+    mask->section.traits = traits;
 }
 
-SF_INTERNAL SFUInteger *SFAlbumGetTemporaryIndexArray(SFAlbumRef album, SFUInteger count)
+SF_INTERNAL SFUInt32 *SFAlbumGetTemporaryIndexArray(SFAlbumRef album, SFUInteger count)
 {
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
     if (album->_indexMap.capacity < count) {
         SFListSetCapacity(&album->_indexMap, count);
+        _SFAlbumCountAllocation(album);
     }
 
     return album->_indexMap.items;
@@ -170,15 +1115,12 @@ SF_INTERNAL void SFAlbumReserveGlyphs(SFAlbumRef album, SFUInteger index, SFUInt
     SFAssert(album->_state == _SFAlbumStateFilling);
 
     album->_version++;
-    album->glyphCount += count;
-
-    SFListReserveRange(&album->_glyphs, index, count);
-    SFListReserveRange(&album->_details, index, count);
+    _SFAlbumConsumeGap(album, index, count);
 }
 
 SF_INTERNAL SFGlyphID SFAlbumGetGlyph(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetVal(&album->_glyphs, index);
+    return SFListGetVal(&album->_glyphs, _SFAlbumFillingIndex(album, index));
 }
 
 SF_INTERNAL void SFAlbumSetGlyph(SFAlbumRef album, SFUInteger index, SFGlyphID glyph)
@@ -186,12 +1128,12 @@ SF_INTERNAL void SFAlbumSetGlyph(SFAlbumRef album, SFUInteger index, SFGlyphID g
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListSetVal(&album->_glyphs, index, glyph);
+    SFListSetVal(&album->_glyphs, _SFAlbumFillingIndex(album, index), glyph);
 }
 
 SF_INTERNAL SFUInteger SFAlbumGetAssociation(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->association;
+    return SFListGetVal(&album->_associations, _SFAlbumFillingIndex(album, index));
 }
 
 SF_INTERNAL void SFAlbumSetAssociation(SFAlbumRef album, SFUInteger index, SFUInteger association)
@@ -199,17 +1141,17 @@ SF_INTERNAL void SFAlbumSetAssociation(SFAlbumRef album, SFUInteger index, SFUIn
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListGetRef(&album->_details, index)->association = association;
+    SFListSetVal(&album->_associations, _SFAlbumFillingIndex(album, index), (SFUInt32)association);
 }
 
 SF_PRIVATE SFGlyphMask _SFAlbumGetGlyphMask(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->mask;
+    return SFListGetVal(&album->_masks, _SFAlbumFillingIndex(album, index));
 }
 
 SF_INTERNAL SFUInt16 SFAlbumGetFeatureMask(SFAlbumRef album, SFUInteger index)
 {
-    return SFListGetRef(&album->_details, index)->mask.section.feature;
+    return SFListGetRef(&album->_masks, _SFAlbumFillingIndex(album, index))->section.feature;
 }
 
 SF_INTERNAL void SFAlbumSetFeatureMask(SFAlbumRef album, SFUInteger index, SFUInt16 featureMask)
@@ -217,12 +1159,12 @@ SF_INTERNAL void SFAlbumSetFeatureMask(SFAlbumRef album, SFUInteger index, SFUIn
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListGetRef(&album->_details, index)->mask.section.feature = featureMask;
+    SFListGetRef(&album->_masks, _SFAlbumFillingIndex(album, index))->section.feature = featureMask;
 }
 
 SF_INTERNAL SFGlyphTraits SFAlbumGetAllTraits(SFAlbumRef album, SFUInteger index)
 {
-    return (SFGlyphTraits)SFListGetRef(&album->_details, index)->mask.section.traits;
+    return (SFGlyphTraits)SFListGetRef(&album->_masks, _SFAlbumFillingIndex(album, index))->section.traits;
 }
 
 SF_INTERNAL void SFAlbumSetAllTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits)
@@ -230,7 +1172,7 @@ SF_INTERNAL void SFAlbumSetAllTraits(SFAlbumRef album, SFUInteger index, SFGlyph
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    SFListGetRef(&album->_details, index)->mask.section.traits = traits;
+    SFListGetRef(&album->_masks, _SFAlbumFillingIndex(album, index))->section.traits = traits;
 }
 
 SF_INTERNAL void SFAlbumReplaceBasicTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits)
@@ -240,15 +1182,34 @@ SF_INTERNAL void SFAlbumReplaceBasicTraits(SFAlbumRef album, SFUInteger index, S
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
-    all = &SFListGetRef(&album->_details, index)->mask.section.traits;
+    all = &SFListGetRef(&album->_masks, _SFAlbumFillingIndex(album, index))->section.traits;
     *all = (*all & 0xFF00) | (traits & 0x00FF);
 }
 
+SF_INTERNAL void SFAlbumMarkUnsafeToBreak(SFAlbumRef album, SFUInteger firstIndex, SFUInteger lastIndex)
+{
+    SFUInteger index;
+
+    /* The album must be in filling or arranging state. */
+    SFAssert(album->_state == _SFAlbumStateFilling || album->_state == _SFAlbumStateArranging);
+    /* The range must be in logical order. */
+    SFAssert(firstIndex <= lastIndex);
+
+    for (index = firstIndex + 1; index <= lastIndex; index++) {
+        SFListGetRef(&album->_masks, _SFAlbumFillingIndex(album, index))->section.traits |= SFGlyphTraitUnsafeToBreak;
+    }
+}
+
 SF_INTERNAL void SFAlbumEndFilling(SFAlbumRef album)
 {
     /* The album must be in filling state. */
     SFAssert(album->_state == _SFAlbumStateFilling);
 
+    /* Close the gap so that the glyphs are laid out contiguously from here onwards. */
+    _SFAlbumPrepareGap(album, album->glyphCount, 0);
+    _SFAlbumRemoveFillingRange(album, album->glyphCount, album->_gapCount);
+    album->_gapCount = 0;
+
     album->_state = _SFAlbumStateFilled;
 }
 
@@ -257,8 +1218,9 @@ SF_INTERNAL void SFAlbumBeginArranging(SFAlbumRef album)
     /* The album must be filled before arranging it. */
     SFAssert(album->_state == _SFAlbumStateFilled);
 
-    SFListReserveRange(&album->_offsets, 0, album->glyphCount);
-    SFListReserveRange(&album->_advances, 0, album->glyphCount);
+    _SFAlbumReserveList(album, (_SFListRef)&album->_details, 0, album->glyphCount);
+    _SFAlbumReserveList(album, (_SFListRef)&album->_offsets, 0, album->glyphCount);
+    _SFAlbumReserveList(album, (_SFListRef)&album->_advances, 0, album->glyphCount);
 
     album->_state = _SFAlbumStateArranging;
 }
@@ -270,7 +1232,7 @@ SF_INTERNAL void SFAlbumInsertHelperTraits(SFAlbumRef album, SFUInteger index, S
     /* Traits must be helping ones only. */
     SFAssert((traits & 0x0F00) == traits);
 
-    SFListGetRef(&album->_details, index)->mask.section.traits |= traits;
+    SFListGetRef(&album->_masks, index)->section.traits |= traits;
 }
 
 SF_INTERNAL void SFAlbumRemoveHelperTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits)
@@ -280,7 +1242,7 @@ SF_INTERNAL void SFAlbumRemoveHelperTraits(SFAlbumRef album, SFUInteger index, S
     /* Traits must be helping ones only. */
     SFAssert((traits & 0x0F00) == traits);
 
-    SFListGetRef(&album->_details, index)->mask.section.traits &= (SFUInt16)~traits;
+    SFListGetRef(&album->_masks, index)->section.traits &= (SFUInt16)~traits;
 }
 
 SF_INTERNAL SFInt32 SFAlbumGetX(SFAlbumRef album, SFUInteger index)
@@ -314,6 +1276,24 @@ SF_INTERNAL SFAdvance SFAlbumGetAdvance(SFAlbumRef album, SFUInteger index)
     return SFListGetVal(&album->_advances, index);
 }
 
+SF_INTERNAL SFInteger SFAlbumGetTotalAdvance(SFAlbumRef album)
+{
+    SFInteger totalAdvance = 0;
+    SFUInteger index;
+
+    /* Advances are only available once the album is arranged. */
+    if (album->_state == _SFAlbumStateArranged || album->_state == _SFAlbumStateMeasured) {
+        for (index = 0; index < album->glyphCount; index++) {
+            /* Ignore the placeholders as they are not yet removed before wrapping up. */
+            if (!(SFListGetRef(&album->_masks, index)->section.traits & SFGlyphTraitPlaceholder)) {
+                totalAdvance += album->_advances.items[index];
+            }
+        }
+    }
+
+    return totalAdvance;
+}
+
 SF_INTERNAL void SFAlbumSetAdvance(SFAlbumRef album, SFUInteger index, SFAdvance advance)
 {
     /* The album must be in arranging or arranged state. */
@@ -356,62 +1336,92 @@ SF_INTERNAL void SFAlbumEndArranging(SFAlbumRef album)
     album->_state = _SFAlbumStateArranged;
 }
 
-static void _SFAlbumRemoveGlyphs(SFAlbumRef album, SFUInteger index, SFUInteger count)
-{
-    SFListRemoveRange(&album->_glyphs, index, count);
-    SFListRemoveRange(&album->_details, index, count);
-    SFListRemoveRange(&album->_offsets, index, count);
-    SFListRemoveRange(&album->_advances, index, count);
-}
-
 static void _SFAlbumRemovePlaceholders(SFAlbumRef album)
 {
-    SFUInteger placeholderCount = 0;
-    SFUInteger index = album->glyphCount;
-
-    while (index--) {
-        SFGlyphTraits traits = SFAlbumGetAllTraits(album, index);
-        if (traits & SFGlyphTraitPlaceholder) {
-            placeholderCount++;
-        } else {
-            if (placeholderCount) {
-                _SFAlbumRemoveGlyphs(album, index + 1, placeholderCount);
-                album->glyphCount -= placeholderCount;
-                placeholderCount = 0;
+    /* Arranging lists are only filled if the album was arranged. */
+    SFBoolean isArranged = (album->_state == _SFAlbumStateArranged);
+    SFUInteger glyphCount = album->glyphCount;
+    SFUInteger writeIndex = 0;
+    SFUInteger readIndex;
+
+    /* Shift the remaining glyphs over the placeholders in a single stable pass. */
+    for (readIndex = 0; readIndex < glyphCount; readIndex++) {
+        SFGlyphTraits traits = SFAlbumGetAllTraits(album, readIndex);
+
+        if (!(traits & SFGlyphTraitPlaceholder)) {
+            if (writeIndex != readIndex) {
+                SFListSetVal(&album->_glyphs, writeIndex, SFListGetVal(&album->_glyphs, readIndex));
+                SFListSetVal(&album->_masks, writeIndex, SFListGetVal(&album->_masks, readIndex));
+                SFListSetVal(&album->_associations, writeIndex, SFListGetVal(&album->_associations, readIndex));
+
+                if (isArranged) {
+                    SFListSetVal(&album->_details, writeIndex, SFListGetVal(&album->_details, readIndex));
+                    SFListSetVal(&album->_offsets, writeIndex, SFListGetVal(&album->_offsets, readIndex));
+                    SFListSetVal(&album->_advances, writeIndex, SFListGetVal(&album->_advances, readIndex));
+                }
             }
+
+            writeIndex++;
         }
     }
 
-    if (placeholderCount) {
-        _SFAlbumRemoveGlyphs(album, 0, placeholderCount);
-        album->glyphCount -= placeholderCount;
+    if (writeIndex != glyphCount) {
+        SFUInteger removeCount = glyphCount - writeIndex;
+
+        _SFAlbumRemoveFillingRange(album, writeIndex, removeCount);
+
+        if (isArranged) {
+            SFListRemoveRange(&album->_details, writeIndex, removeCount);
+            SFListRemoveRange(&album->_offsets, writeIndex, removeCount);
+            SFListRemoveRange(&album->_advances, writeIndex, removeCount);
+        }
+
+        album->glyphCount = writeIndex;
     }
 }
 
 static void _SFAlbumBuildCodeunitToGlyphMap(SFAlbumRef album)
 {
     SFUInteger codeunitCount = album->codeunitCount;
-    SFUInteger association = 0;
+    SFUInt32 *indexMap = album->_indexMap.items;
+    const SFUInt32 *associations = album->_associations.items;
+    SFUInt32 association = 0;
     SFUInteger index;
 
-    /* Initialize the map array. */
-    for (index = 0; index < codeunitCount; index++) {
-        SFListSetVal(&album->_indexMap, index, SFInvalidIndex);
-    }
+    /* The map must have room for all code units. */
+    SFAssert(album->_indexMap.count == codeunitCount);
+
+    /* Initialize the map array in bulk as the marker has all bits set. */
+    memset(indexMap, 0xFF, sizeof(SFUInt32) * codeunitCount);
 
     /* Traverse in reverse order so that first glyph takes priority in case of multiple substitution. */
     for (index = album->glyphCount; index--;) {
-        association = SFAlbumGetAssociation(album, index);
-        SFListSetVal(&album->_indexMap, association, index);
+        association = associations[index];
+        indexMap[association] = (SFUInt32)index;
     }
 
     /* Assign the same glyph index to subsequent codeunits. */
     for (index = 0; index < codeunitCount; index++) {
-        if (SFListGetVal(&album->_indexMap, index) == SFInvalidIndex) {
-            SFListSetVal(&album->_indexMap, index, association);
+        if (indexMap[index] == SFUInt32Max) {
+            indexMap[index] = association;
         }
 
-        association = SFListGetVal(&album->_indexMap, index);
+        association = indexMap[index];
+    }
+
+    album->_isMapPending = SFFalse;
+}
+
+/**
+ * Clears the feature masks, which hold the font indexes of wrapped up glyphs. The glyphs belong to
+ * the font of the pattern until a fallback font replaces them.
+ */
+static void _SFAlbumClearFontIndexes(SFAlbumRef album)
+{
+    SFUInteger index;
+
+    for (index = 0; index < album->glyphCount; index++) {
+        album->_masks.items[index].section.feature = 0;
     }
 }
 
@@ -421,15 +1431,35 @@ SF_INTERNAL void SFAlbumWrapUp(SFAlbumRef album)
     SFAssert(album->_state == _SFAlbumStateFilled || album->_state == _SFAlbumStateArranged);
 
     _SFAlbumRemovePlaceholders(album);
-    _SFAlbumBuildCodeunitToGlyphMap(album);
+    _SFAlbumClearFontIndexes(album);
+
+    /* The map is built on first access as many clients never need it. */
+    album->_isMapPending = SFTrue;
 
     album->codepoints = NULL;
+    album->glyphInput = NULL;
+}
+
+SF_INTERNAL void SFAlbumWrapUpMeasured(SFAlbumRef album)
+{
+    /* The album must be arranged before measuring it. */
+    SFAssert(album->_state == _SFAlbumStateArranged);
+
+    album->codepoints = NULL;
+    album->glyphInput = NULL;
+    album->_state = _SFAlbumStateMeasured;
 }
 
 SF_INTERNAL void SFAlbumFinalize(SFAlbumRef album) {
+    _SFAlbumDetachShare(album);
+
     SFListFinalize(&album->_indexMap);
+    SFListFinalize(&album->_wideMap);
     SFListFinalize(&album->_glyphs);
+    SFListFinalize(&album->_masks);
+    SFListFinalize(&album->_associations);
     SFListFinalize(&album->_details);
     SFListFinalize(&album->_offsets);
     SFListFinalize(&album->_advances);
+    SFListFinalize(&album->_records);
 }
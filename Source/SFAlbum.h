@@ -29,7 +29,8 @@ typedef enum {
     _SFAlbumStateFilling,
     _SFAlbumStateFilled,
     _SFAlbumStateArranging,
-    _SFAlbumStateArranged
+    _SFAlbumStateArranged,
+    _SFAlbumStateMeasured
 } _SFAlbumState;
 
 enum {
@@ -46,37 +47,84 @@ enum {
     SFGlyphTraitRightToLeft = 1 << 10,  /**< HELPER: Right-to-Left cursive glyph. */
     SFGlyphTraitResolved    = 1 << 11,  /**< HELPER: Resolved cursive glyph. */
 
-    SFGlyphTraitZeroWidth   = 1 << 12   /**< CONTROL: Zero width, space glyph.*/
+    SFGlyphTraitZeroWidth   = 1 << 12,  /**< CONTROL: Zero width, space glyph.*/
+    SFGlyphTraitUnsafeToBreak = 1 << 13 /**< CONTROL: Shaped together with a previous glyph. */
 };
 typedef SFUInt16 SFGlyphTraits;
 
 typedef union {
     struct {
-        SFUInt16 feature;
+        SFUInt16 feature;       /**< Feature mask while shaping, font index once wrapped up. */
         SFUInt16 traits;
     } section;
     SFUInt32 full;
 } SFGlyphMask;
 
+/**
+ * Keeps the details of a glyph which are only needed while arranging.
+ */
 typedef struct _SFGlyphDetail {
-    SFUInteger association;     /**< Index of the code point to which the glyph maps. */
-    SFGlyphMask mask;           /**< Mask of the glyph. */
     SFUInt16 cursiveOffset;     /**< Offset to the next cursively connected glyph. */
     SFUInt16 attachmentOffset;  /**< Offset to the previous glyph attached with this one. */
 } SFGlyphDetail, *SFGlyphDetailRef;
 
+/**
+ * The number of glyphs whose results an album can hold without allocating memory.
+ */
+#define SF_ALBUM_INLINE_CAPACITY    32
+
+/**
+ * Keeps the inline buffers of the lists read back from every album, so that the results of short
+ * texts stay next to the album. The other lists are allocated on first use and kept across resets.
+ */
+typedef struct _SFAlbumInlineStorage {
+    SFUInt32 indexMap[SF_ALBUM_INLINE_CAPACITY];
+    SFGlyphID glyphs[SF_ALBUM_INLINE_CAPACITY];
+    SFUInt32 associations[SF_ALBUM_INLINE_CAPACITY];
+    SFAdvance advances[SF_ALBUM_INLINE_CAPACITY];
+} _SFAlbumInlineStorage;
+
+/**
+ * Keeps the glyphs supplied by the client for shaping in place of code points.
+ */
+typedef struct _SFGlyphInput {
+    const SFGlyphID *glyphIDs;          /**< Glyph IDs to be shaped. */
+    const SFUInt32 *clusters;           /**< Code unit indexes of the glyphs, may be NULL. */
+    SFUInteger glyphCount;              /**< Number of glyphs to be shaped. */
+} SFGlyphInput, *SFGlyphInputRef;
+
+/**
+ * Keeps the number of albums sharing the same result buffers through copies.
+ */
+typedef struct _SFAlbumShare {
+    SFUInteger _retainCount;
+} _SFAlbumShare, *_SFAlbumShareRef;
+
 typedef struct _SFAlbum {
     SFCodepointsRef codepoints;         /**< Code points to be shaped. */
+    SFGlyphInputRef glyphInput;         /**< Glyphs to be shaped in place of code points. */
     SFUInteger codeunitCount;           /**< Number of code units to process. */
     SFUInteger glyphCount;              /**< Total number of glyphs in the album. */
 
-    SF_LIST(SFUInteger) _indexMap;      /**< Code unit index to glyph index mapping list. */
+    SF_LIST(SFUInt32) _indexMap;        /**< Code unit index to glyph index mapping list. */
+    SF_LIST(SFUInteger) _wideMap;       /**< Machine word copy of index map, made on demand. */
     SF_LIST(SFGlyphID) _glyphs;         /**< List of ids of all glyphs in the album. */
-    SF_LIST(SFGlyphDetail) _details;    /**< List of details of all glyphs in the album. */
+    SF_LIST(SFGlyphMask) _masks;        /**< List of masks of all glyphs in the album. */
+    SF_LIST(SFUInt32) _associations;    /**< List of code unit indexes to which the glyphs map. */
+    SF_LIST(SFGlyphDetail) _details;    /**< List of arranging details of all glyphs in the album. */
     SF_LIST(SFPoint) _offsets;          /**< List of offsets of all glyphs in the album. */
     SF_LIST(SFAdvance) _advances;       /**< List of advances of all glyphs in the album. */
-
+    SF_LIST(SFCodepointRecord) _records; /**< Decoded code points of the text being shaped. */
+    _SFAlbumInlineStorage _inline;      /**< Inline buffers used by the lists for short texts. */
+    _SFAlbumShareRef _share;            /**< Shared result buffers, if the album was copied. */
+
+    SFUInteger _gapIndex;               /**< Index of the unused glyph slots while filling. */
+    SFUInteger _gapCount;               /**< Number of the unused glyph slots while filling. */
+    SFUInteger _allocationCount;        /**< Number of allocations made since last reset. */
+    SFUInteger _peakMemory;             /**< Highest number of heap bytes held by the lists. */
+    SFUInteger _retainedLimit;          /**< Number of heap bytes which can be kept across resets. */
     SFUInteger _version;                /**< Current version of the album. */
+    SFBoolean _isMapPending;            /**< Whether the index map is yet to be built. */
     _SFAlbumState _state;               /**< Current state of the album. */
 
     SFUInteger _retainCount;
@@ -84,19 +132,101 @@ typedef struct _SFAlbum {
 
 SF_PRIVATE SFUInt16 _SFAlbumGetAntiFeatureMask(SFUInt16 featureMask);
 
+/**
+ * Initializes the album.
+ * @note
+ *      The album must not be moved in memory afterwards as its lists refer to its inline storage.
+ */
 SF_INTERNAL void SFAlbumInitialize(SFAlbumRef album);
 
 /**
  * Initializes the album for given code points.
+ * @note
+ *      The storage of the album is released if it exceeds the retained capacity limit while the
+ *      new text fits in half of the limit, so that alternating text lengths do not thrash it.
+ * @note
+ *      The code unit count must be less than SFUInt32Max as the indexes are kept in 32 bits.
  */
 SF_INTERNAL void SFAlbumReset(SFAlbumRef album, SFCodepointsRef codepoints, SFUInteger codeunitCount);
 
+/**
+ * Initializes the album for given glyphs, which are shaped in place of code points.
+ */
+SF_INTERNAL void SFAlbumResetForGlyphs(SFAlbumRef album, SFGlyphInputRef glyphInput, SFUInteger codeunitCount);
+
+/**
+ * Replaces the contents of the album with the results serialized in a buffer by SFAlbumSerialize.
+ *
+ * @return
+ *      SFTrue if the buffer was valid and loaded, SFFalse otherwise.
+ */
+SF_INTERNAL SFBoolean SFAlbumLoadBuffer(SFAlbumRef album, const void *buffer, SFUInteger size);
+
+/**
+ * Appends the results of a wrapped up album, shaped from a segment of the text, at the end of the
+ * album. The album must have been reset for the whole text.
+ *
+ * @param codeunitOffset
+ *      The index of the first code unit of the segment in the whole text.
+ */
+SF_INTERNAL void SFAlbumAppendSegment(SFAlbumRef album, SFAlbumRef segment, SFUInteger codeunitOffset);
+
+/**
+ * Replaces a range of glyphs of a wrapped up album with the results of a segment, shaped from the
+ * text which replaced the code units of those glyphs. The associations following the range are
+ * moved by the change in the number of code units.
+ *
+ * @param glyphIndex
+ *      The index of the first glyph to replace.
+ * @param glyphCount
+ *      The number of glyphs to replace.
+ * @param codeunitIndex
+ *      The index of the first code unit of the replaced glyphs.
+ * @param codeunitCount
+ *      The number of code units of the replaced glyphs, before the replacement.
+ */
+SF_INTERNAL void SFAlbumReplaceSegment(SFAlbumRef album, SFUInteger glyphIndex, SFUInteger glyphCount,
+    SFUInteger codeunitIndex, SFUInteger codeunitCount, SFAlbumRef segment);
+
+/**
+ * Grows the storage of an empty album beforehand, so that shaping a text of up to the given number
+ * of code units does not allocate, assuming one glyph per code unit.
+ */
+SF_INTERNAL void SFAlbumReserveCapacity(SFAlbumRef album, SFUInteger codeunitCount);
+
+/**
+ * Returns a buffer of the album for decoding the code points of its text, so that the decoding
+ * reuses the storage of the album across shaping calls.
+ *
+ * @param count
+ *      The number of records to reserve.
+ * @return
+ *      A pointer to the reserved records, valid until the album is reset again.
+ */
+SF_INTERNAL SFCodepointRecord *SFAlbumReserveRecords(SFAlbumRef album, SFUInteger count);
+
+/**
+ * Sets the index of the font which produced all glyphs of a wrapped up album.
+ */
+SF_INTERNAL void SFAlbumSetFontIndex(SFAlbumRef album, SFUInt16 fontIndex);
+
+/**
+ * Removes the glyphs of the code units which were shaped only as context at both ends of the text
+ * of a wrapped up album, so that the album holds the results of the remaining code units.
+ *
+ * @param leadingCount
+ *      The number of code units of the context before the text.
+ * @param trailingCount
+ *      The number of code units of the context after the text.
+ */
+SF_INTERNAL void SFAlbumRemoveContext(SFAlbumRef album, SFUInteger leadingCount, SFUInteger trailingCount);
+
 /**
  * Starts filling the album with provided glyphs.
  */
 SF_INTERNAL void SFAlbumBeginFilling(SFAlbumRef album);
 
-SF_INTERNAL SFUInteger *SFAlbumGetTemporaryIndexArray(SFAlbumRef album, SFUInteger count);
+SF_INTERNAL SFUInt32 *SFAlbumGetTemporaryIndexArray(SFAlbumRef album, SFUInteger count);
 
 /**
  * Adds a new glyph into the album.
@@ -107,6 +237,9 @@ SF_INTERNAL void SFAlbumAddGlyph(SFAlbumRef album, SFGlyphID glyph, SFGlyphTrait
  * Reserves specified number of glyphs at the given index.
  * @note
  *      The reserved glyphs will be uninitialized.
+ * @note
+ *      The glyphs are kept in a gap buffer while filling, so reserving glyphs close to the previous
+ *      reservation only moves the glyphs lying in between.
  */
 SF_INTERNAL void SFAlbumReserveGlyphs(SFAlbumRef album, SFUInteger index, SFUInteger count);
 
@@ -125,6 +258,12 @@ SF_INTERNAL SFGlyphTraits SFAlbumGetAllTraits(SFAlbumRef album, SFUInteger index
 SF_INTERNAL void SFAlbumSetAllTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits);
 SF_INTERNAL void SFAlbumReplaceBasicTraits(SFAlbumRef album, SFUInteger index, SFGlyphTraits traits);
 
+/**
+ * Marks the glyphs after the first index up to and including the last index as unsafe to break,
+ * since a lookup has shaped them together with the glyph at the first index.
+ */
+SF_INTERNAL void SFAlbumMarkUnsafeToBreak(SFAlbumRef album, SFUInteger firstIndex, SFUInteger lastIndex);
+
 /**
  * Ends filling the album with glyphs.
  */
@@ -145,6 +284,7 @@ SF_INTERNAL SFInt32 SFAlbumGetY(SFAlbumRef album, SFUInteger index);
 SF_INTERNAL void SFAlbumSetY(SFAlbumRef album, SFUInteger index, SFInt32 y);
 
 SF_INTERNAL SFAdvance SFAlbumGetAdvance(SFAlbumRef album, SFUInteger index);
+SF_INTERNAL SFInteger SFAlbumGetTotalAdvance(SFAlbumRef album);
 SF_INTERNAL void SFAlbumSetAdvance(SFAlbumRef album, SFUInteger index, SFAdvance advance);
 
 SF_INTERNAL SFUInt16 SFAlbumGetCursiveOffset(SFAlbumRef album, SFUInteger index);
@@ -160,9 +300,17 @@ SF_INTERNAL void SFAlbumEndArranging(SFAlbumRef album);
 
 /**
  * Wraps up the album for client's usage.
+ * @note
+ *      The code unit to glyph map is only built when it is first accessed.
  */
 SF_INTERNAL void SFAlbumWrapUp(SFAlbumRef album);
 
+/**
+ * Leaves the arranged album as it is for summing up its advances, marking it measured so that its
+ * partial results are not handed out as complete ones until it is filled again.
+ */
+SF_INTERNAL void SFAlbumWrapUpMeasured(SFAlbumRef album);
+
 /**
  * Finalizes the album.
  */
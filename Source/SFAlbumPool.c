@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+#include <stddef.h>
+
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFAlbum.h"
+#include "SFAlbumPool.h"
+
+/**
+ * The highest code unit capacities of all but the last class.
+ */
+static const SFUInteger _SFAlbumPoolClassLimits[SF_ALBUM_POOL_CLASS_COUNT - 1] = { 256, 4096 };
+
+static SFUInteger _SFAlbumPoolGetClassIndex(SFUInteger codeunitCount)
+{
+    SFUInteger index;
+
+    for (index = 0; index < SF_ALBUM_POOL_CLASS_COUNT - 1; index++) {
+        if (codeunitCount <= _SFAlbumPoolClassLimits[index]) {
+            break;
+        }
+    }
+
+    return index;
+}
+
+static void _SFAlbumPoolLock(SFAlbumPoolRef pool)
+{
+    if (pool->_protocol.lock) {
+        pool->_protocol.lock(pool->_object);
+    }
+}
+
+static void _SFAlbumPoolUnlock(SFAlbumPoolRef pool)
+{
+    if (pool->_protocol.unlock) {
+        pool->_protocol.unlock(pool->_object);
+    }
+}
+
+SFAlbumPoolRef SFAlbumPoolCreate(const SFAlbumPoolProtocol *protocol, void *object, SFUInteger albumsPerClass)
+{
+    SFAlbumPoolRef pool = SFAllocatorAllocate(sizeof(SFAlbumPool));
+    SFUInteger index;
+
+    if (protocol) {
+        /* Locking functions must be provided in pairs. */
+        SFAssert((protocol->lock == NULL) == (protocol->unlock == NULL));
+
+        pool->_protocol = *protocol;
+    } else {
+        pool->_protocol.lock = NULL;
+        pool->_protocol.unlock = NULL;
+    }
+
+    pool->_object = object;
+    pool->_albumsPerClass = albumsPerClass;
+    pool->_retainCount = 1;
+
+    /* Allocate the room for idle albums upfront so that giving them back never allocates. */
+    for (index = 0; index < SF_ALBUM_POOL_CLASS_COUNT; index++) {
+        SFListInitialize(&pool->_classes[index], sizeof(SFAlbumRef));
+        SFListSetCapacity(&pool->_classes[index], albumsPerClass);
+    }
+
+    return pool;
+}
+
+SFAlbumRef SFAlbumPoolTake(SFAlbumPoolRef pool, SFUInteger codeunitCount)
+{
+    SFUInteger classIndex = _SFAlbumPoolGetClassIndex(codeunitCount);
+    SFAlbumRef album = NULL;
+
+    _SFAlbumPoolLock(pool);
+
+    if (pool->_classes[classIndex].count > 0) {
+        SFUInteger lastIndex = pool->_classes[classIndex].count - 1;
+
+        album = SFListGetVal(&pool->_classes[classIndex], lastIndex);
+        SFListRemoveAt(&pool->_classes[classIndex], lastIndex);
+    }
+
+    _SFAlbumPoolUnlock(pool);
+
+    /* Create the album outside the lock if the class had none, grown for the expected text. */
+    if (!album) {
+        album = SFAlbumCreate();
+        SFAlbumReserveCapacity(album, codeunitCount);
+    }
+
+    return album;
+}
+
+void SFAlbumPoolGiveBack(SFAlbumPoolRef pool, SFAlbumRef album)
+{
+    /*
+     * The class of an album is decided by the largest text its glyphs have been grown for, as the
+     * index map can also be grown on its own for the temporary index arrays.
+     */
+    SFUInteger classIndex = _SFAlbumPoolGetClassIndex(album->_glyphs.capacity);
+    SFBoolean isKept = SFFalse;
+
+    _SFAlbumPoolLock(pool);
+
+    if (pool->_classes[classIndex].count < pool->_albumsPerClass) {
+        SFListAdd(&pool->_classes[classIndex], album);
+        isKept = SFTrue;
+    }
+
+    _SFAlbumPoolUnlock(pool);
+
+    if (!isKept) {
+        SFAlbumRelease(album);
+    }
+}
+
+SFAlbumPoolRef SFAlbumPoolRetain(SFAlbumPoolRef pool)
+{
+    if (pool) {
+        pool->_retainCount++;
+    }
+
+    return pool;
+}
+
+void SFAlbumPoolRelease(SFAlbumPoolRef pool)
+{
+    if (pool && --pool->_retainCount == 0) {
+        SFUInteger classIndex;
+
+        for (classIndex = 0; classIndex < SF_ALBUM_POOL_CLASS_COUNT; classIndex++) {
+            SFUInteger albumIndex;
+
+            for (albumIndex = 0; albumIndex < pool->_classes[classIndex].count; albumIndex++) {
+                SFAlbumRelease(SFListGetVal(&pool->_classes[classIndex], albumIndex));
+            }
+
+            SFListFinalize(&pool->_classes[classIndex]);
+        }
+
+        SFAllocatorDeallocate(pool);
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_ALBUM_POOL_H
+#define _SF_INTERNAL_ALBUM_POOL_H
+
+#include <SFAlbumPool.h>
+#include <SFConfig.h>
+
+#include "SFAlbum.h"
+#include "SFBase.h"
+#include "SFList.h"
+
+/**
+ * The number of capacity classes in which the albums of a pool are kept.
+ */
+#define SF_ALBUM_POOL_CLASS_COUNT   3
+
+typedef struct _SFAlbumPool {
+    SFAlbumPoolProtocol _protocol;                      /**< Locking functions of the pool. */
+    void *_object;                                      /**< Object passed to locking functions. */
+    SF_LIST(SFAlbumRef) _classes[SF_ALBUM_POOL_CLASS_COUNT]; /**< Idle albums of each class. */
+    SFUInteger _albumsPerClass;                         /**< Maximum number of idle albums in a class. */
+    SFUInteger _retainCount;
+} SFAlbumPool;
+
+#endif
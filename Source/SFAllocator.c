@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFAllocator.h"
+
+static void *_SFSystemAllocate(void *object, SFUInteger size);
+static void *_SFSystemReallocate(void *object, void *pointer, SFUInteger size);
+static void _SFSystemDeallocate(void *object, void *pointer);
+
+static const SFAllocatorProtocol _SFSystemAllocator = {
+    _SFSystemAllocate,
+    _SFSystemReallocate,
+    _SFSystemDeallocate
+};
+
+static SFAllocatorProtocol _SFAllocatorProtocol = {
+    _SFSystemAllocate,
+    _SFSystemReallocate,
+    _SFSystemDeallocate
+};
+static void *_SFAllocatorObject = NULL;
+static SFUInteger _SFAllocatorCount = 0;
+
+static void *_SFSystemAllocate(void *object, SFUInteger size)
+{
+    return malloc(size);
+}
+
+static void *_SFSystemReallocate(void *object, void *pointer, SFUInteger size)
+{
+    return realloc(pointer, size);
+}
+
+static void _SFSystemDeallocate(void *object, void *pointer)
+{
+    free(pointer);
+}
+
+void SFAllocatorSetProtocol(const SFAllocatorProtocol *protocol, void *object)
+{
+    if (protocol) {
+        /* Verify that required functions exist in protocol. */
+        SFAssert(protocol->allocate && protocol->reallocate);
+
+        _SFAllocatorProtocol = *protocol;
+        _SFAllocatorObject = object;
+    } else {
+        _SFAllocatorProtocol = _SFSystemAllocator;
+        _SFAllocatorObject = NULL;
+    }
+}
+
+SFUInteger SFAllocatorGetAllocationCount(void)
+{
+    return _SFAllocatorCount;
+}
+
+SF_INTERNAL void *SFAllocatorAllocate(SFUInteger size)
+{
+    _SFAllocatorCount += 1;
+
+    return _SFAllocatorProtocol.allocate(_SFAllocatorObject, size);
+}
+
+SF_INTERNAL void *SFAllocatorReallocate(void *pointer, SFUInteger size)
+{
+    _SFAllocatorCount += 1;
+
+    return _SFAllocatorProtocol.reallocate(_SFAllocatorObject, pointer, size);
+}
+
+SF_INTERNAL void SFAllocatorDeallocate(void *pointer)
+{
+    if (_SFAllocatorProtocol.deallocate) {
+        _SFAllocatorProtocol.deallocate(_SFAllocatorObject, pointer);
+    }
+}
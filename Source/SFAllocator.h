@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_ALLOCATOR_H
+#define _SF_INTERNAL_ALLOCATOR_H
+
+#include <SFConfig.h>
+#include <SFAllocator.h>
+
+#include "SFBase.h"
+
+SF_INTERNAL void *SFAllocatorAllocate(SFUInteger size);
+SF_INTERNAL void *SFAllocatorReallocate(void *pointer, SFUInteger size);
+SF_INTERNAL void SFAllocatorDeallocate(void *pointer);
+
+#endif
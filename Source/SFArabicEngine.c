@@ -32,7 +32,7 @@
 #include "SFArabicEngine.h"
 
 static SFScriptKnowledgeRef _SFArabicKnowledgeSeekScript(const void *object, SFTag scriptTag);
-static void _SFPutArabicFeatureMask(SFAlbumRef album);
+static void _SFPutArabicFeatureMask(SFAlbumRef album, SFJoiningType leadingJoiningType, SFJoiningType trailingJoiningType);
 static void _SFArabicEngineProcessAlbum(const void *object, SFAlbumRef album);
 
 enum {
@@ -99,7 +99,7 @@ SF_INTERNAL void SFArabicEngineInitialize(SFArabicEngineRef arabicEngine, SFArti
     arabicEngine->_artist = artist;
 }
 
-static SFJoiningType _SFDetermineJoiningType(SFCodepoint codepoint)
+SF_INTERNAL SFJoiningType SFArabicEngineDetermineJoiningType(SFCodepoint codepoint)
 {
     SFJoiningType joiningType = SFJoiningTypeDetermine(codepoint);
 
@@ -122,28 +122,101 @@ static SFJoiningType _SFDetermineJoiningType(SFCodepoint codepoint)
     return joiningType;
 }
 
-static void _SFPutArabicFeatureMask(SFAlbumRef album)
+/**
+ * Determines the joining type with which the context of the text joins to it, skipping the
+ * transparent characters. The leading context is read from its end.
+ */
+static SFJoiningType _SFDetermineContextJoiningType(const SBCodepointSequence *context, SFBoolean isLeading)
+{
+    SFUInteger index = (isLeading ? context->stringLength : 0);
+    SBCodepoint codepoint;
+
+    while ((codepoint = (isLeading
+                         ? SBCodepointSequenceGetCodepointBefore(context, &index)
+                         : SBCodepointSequenceGetCodepointAt(context, &index))) != SFCodepointInvalid) {
+        SFJoiningType joiningType = SFArabicEngineDetermineJoiningType(codepoint);
+
+        switch (joiningType) {
+            case SFJoiningTypeT:
+                break;
+
+            case SFJoiningTypeC:
+                return SFJoiningTypeD;
+
+            default:
+                return joiningType;
+        }
+    }
+
+    return SFJoiningTypeU;
+}
+
+static SFJoiningType _SFGetRecordJoiningType(const SFCodepointRecord *record)
+{
+    /* The joining types are usually resolved while decoding the string. */
+    if (record->joiningType != SFJoiningTypeNil) {
+        return record->joiningType;
+    }
+
+    return SFArabicEngineDetermineJoiningType(record->codepoint);
+}
+
+/**
+ * Returns the joining type of a character, counted in the order of the text mode, or nil past the
+ * last character. The characters must be read one after another from the first one.
+ */
+static SFJoiningType _SFReadJoiningType(SFCodepointsRef codepoints,
+    const SFCodepointRecord *records, SFUInteger recordCount, SFUInteger index)
+{
+    SFCodepoint codepoint;
+
+    if (records) {
+        if (index < recordCount) {
+            return _SFGetRecordJoiningType(&records[codepoints->backward ? recordCount - 1 - index : index]);
+        }
+
+        return SFJoiningTypeNil;
+    }
+
+    /* The code points which were not decoded into records are read from the sequence. */
+    codepoint = SFCodepointsNext(codepoints);
+
+    if (codepoint == SFCodepointInvalid) {
+        return SFJoiningTypeNil;
+    }
+
+    return SFArabicEngineDetermineJoiningType(codepoint);
+}
+
+static void _SFPutArabicFeatureMask(SFAlbumRef album, SFJoiningType leadingJoiningType, SFJoiningType trailingJoiningType)
 {
     SFCodepointsRef codepoints = album->codepoints;
+    const SFCodepointRecord *records;
+    SFUInteger recordCount;
     SFUInteger currentIndex = 0;
     SFUInteger nextIndex = 0;
+    SFUInteger priorIndex = SFInvalidIndex;
     SFJoiningType priorJoiningType;
     SFJoiningType joiningType;
 
+    /* Walk the decoded records directly if there are any, otherwise the sequence itself. */
+    records = SFCodepointsGetRecords(codepoints, &recordCount);
     SFCodepointsReset(codepoints);
 
-    priorJoiningType = SFJoiningTypeU;
-    joiningType = _SFDetermineJoiningType(SFCodepointsNext(codepoints));
+    priorJoiningType = leadingJoiningType;
+    joiningType = _SFReadJoiningType(codepoints, records, recordCount, 0);
 
     while (joiningType != SFJoiningTypeNil) {
         SFUInt16 featureMask = _SFArabicFeatureMaskNone;
         SFJoiningType nextJoiningType = SFJoiningTypeNil;
-        SBCodepoint nextCodepoint;
+        SFJoiningType followingJoiningType;
+        SFJoiningType readJoiningType;
+        SFBoolean hasNext = SFFalse;
 
         /* Find the joining type of next character. */
-        while ((nextCodepoint = SFCodepointsNext(codepoints)) != SFCodepointInvalid) {
+        while ((readJoiningType = _SFReadJoiningType(codepoints, records, recordCount, nextIndex + 1)) != SFJoiningTypeNil) {
             nextIndex += 1;
-            nextJoiningType = _SFDetermineJoiningType(nextCodepoint);
+            nextJoiningType = readJoiningType;
 
             /* Normalize the joining type of next character. */
             switch (nextJoiningType) {
@@ -152,14 +225,19 @@ static void _SFPutArabicFeatureMask(SFAlbumRef album)
 
                 case SFJoiningTypeC:
                     nextJoiningType = SFJoiningTypeD;
+                    hasNext = SFTrue;
                     goto Process;
 
                 default:
+                    hasNext = SFTrue;
                     goto Process;
             }
         }
 
     Process:
+        /* The context after the text decides the form of its last character. */
+        followingJoiningType = (hasNext ? nextJoiningType : trailingJoiningType);
+
         switch (joiningType) {
             case SFJoiningTypeR:
                 switch (priorJoiningType) {
@@ -176,7 +254,7 @@ static void _SFPutArabicFeatureMask(SFAlbumRef album)
             case SFJoiningTypeD:
                 switch (priorJoiningType) {
                     case SFJoiningTypeD:
-                        switch (nextJoiningType) {
+                        switch (followingJoiningType) {
                             case SFJoiningTypeR:
                             case SFJoiningTypeD:
                                 featureMask |= _SFArabicFeatureMaskMedial;
@@ -189,7 +267,7 @@ static void _SFPutArabicFeatureMask(SFAlbumRef album)
                         break;
 
                     default:
-                        switch (nextJoiningType) {
+                        switch (followingJoiningType) {
                             case SFJoiningTypeR:
                             case SFJoiningTypeD:
                                 featureMask |= _SFArabicFeatureMaskInitial;
@@ -210,14 +288,23 @@ static void _SFPutArabicFeatureMask(SFAlbumRef album)
 
             /* Can only occur for first character. Should be treated as if there was no character. */
             case SFJoiningTypeT:
-                joiningType = SFJoiningTypeU;
+                joiningType = priorJoiningType;
                 break;
         }
 
         /* Save the mask of current character. */
         SFAlbumSetFeatureMask(album, currentIndex, featureMask);
 
-        /* Move to the next character. */
+        /* The forms of joined characters depend on each other, so they must not be broken apart. */
+        if (priorIndex != SFInvalidIndex && priorJoiningType == SFJoiningTypeD
+            && (joiningType == SFJoiningTypeR || joiningType == SFJoiningTypeD)) {
+            SFAlbumMarkUnsafeToBreak(album, priorIndex, currentIndex);
+        }
+
+        /* Move to the next character, remembering the last one which took a joining form. */
+        if (featureMask != _SFArabicFeatureMaskNone) {
+            priorIndex = currentIndex;
+        }
         priorJoiningType = joiningType;
         currentIndex = nextIndex;
         joiningType = nextJoiningType;
@@ -230,9 +317,29 @@ static void _SFArabicEngineProcessAlbum(const void *object, SFAlbumRef album)
     SFArtistRef artist = arabicEngine->_artist;
     SFTextProcessor processor;
 
-    SFTextProcessorInitialize(&processor, artist->pattern, album, artist->textDirection, artist->textMode, SFTrue);
+    SFTextProcessorInitialize(&processor, artist->pattern, album, artist->textDirection, artist->textMode, artist->shapingMode, SFTrue);
     SFTextProcessorDiscoverGlyphs(&processor);
-    _SFPutArabicFeatureMask(album);
+
+    /* Supplied glyphs are expected to be in their joining forms already. */
+    if (album->codepoints) {
+        SBCodepointSequence leadingContext;
+        SBCodepointSequence trailingContext;
+        SFJoiningType leadingJoiningType;
+        SFJoiningType trailingJoiningType;
+
+        SFArtistLoadLeadingContext(artist, &leadingContext);
+        SFArtistLoadTrailingContext(artist, &trailingContext);
+        leadingJoiningType = _SFDetermineContextJoiningType(&leadingContext, SFTrue);
+        trailingJoiningType = _SFDetermineContextJoiningType(&trailingContext, SFFalse);
+
+        /* The characters are visited in the order of the text mode. */
+        if (album->codepoints->backward) {
+            _SFPutArabicFeatureMask(album, trailingJoiningType, leadingJoiningType);
+        } else {
+            _SFPutArabicFeatureMask(album, leadingJoiningType, trailingJoiningType);
+        }
+    }
+
     SFTextProcessorSubstituteGlyphs(&processor);
     SFTextProcessorPositionGlyphs(&processor);
     SFTextProcessorWrapUp(&processor);
@@ -20,6 +20,7 @@
 #include <SFConfig.h>
 
 #include "SFArtist.h"
+#include "SFJoiningType.h"
 #include "SFShapingEngine.h"
 #include "SFShapingKnowledge.h"
 
@@ -32,4 +33,10 @@ extern SFShapingKnowledge SFArabicKnowledgeInstance;
 
 SF_INTERNAL void SFArabicEngineInitialize(SFArabicEngineRef arabicEngine, SFArtistRef artist);
 
+/**
+ * Determines the joining type of a code point, treating the unavailable ones as transparent or non
+ * joining according to their general category.
+ */
+SF_INTERNAL SFJoiningType SFArabicEngineDetermineJoiningType(SFCodepoint codepoint);
+
 #endif
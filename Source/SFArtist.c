@@ -18,9 +18,16 @@
 
 #include <SBCodepointSequence.h>
 #include <stddef.h>
-#include <stdlib.h>
 
+#include "SFAlbum.h"
+#include "SFAllocator.h"
+#include "SFArabicEngine.h"
 #include "SFBase.h"
+#include "SFCodepoints.h"
+#include "SFGeneralCategory.h"
+#include "SFGeneralCategoryLookup.h"
+#include "SFShapeCache.h"
+#include "SFShapingKnowledge.h"
 #include "SFUnifiedEngine.h"
 #include "SFArtist.h"
 
@@ -36,13 +43,97 @@ static SFBoolean _SFIsValidCodepointSequence(SBCodepointSequence *codepointSeque
     return (codepointSequence->stringBuffer && codepointSequence->stringLength);
 }
 
+static SFUInteger _SFGetCodeunitSize(SBStringEncoding stringEncoding)
+{
+    switch (stringEncoding) {
+        case SBStringEncodingUTF16:
+            return sizeof(SFUInt16);
+
+        case SBStringEncodingUTF32:
+            return sizeof(SFUInt32);
+
+        default:
+            return sizeof(SFUInt8);
+    }
+}
+
+static SFBoolean _SFIsSpaceCodeunit(SBCodepointSequence *codepointSequence, SFUInteger index)
+{
+    switch (codepointSequence->stringEncoding) {
+        case SBStringEncodingUTF16:
+            return (((SFUInt16 *)codepointSequence->stringBuffer)[index] == 0x0020);
+
+        case SBStringEncodingUTF32:
+            return (((SFUInt32 *)codepointSequence->stringBuffer)[index] == 0x0020);
+
+        default:
+            /* A space byte is never a part of a multibyte sequence in UTF-8. */
+            return (((SFUInt8 *)codepointSequence->stringBuffer)[index] == 0x0020);
+    }
+}
+
+/**
+ * Returns the end of the segment starting at given index, made up of a word and its trailing spaces.
+ */
+static SFUInteger _SFGetSegmentEnd(SBCodepointSequence *codepointSequence, SFUInteger start)
+{
+    SFUInteger length = codepointSequence->stringLength;
+    SFUInteger end = start;
+
+    while (end < length && !_SFIsSpaceCodeunit(codepointSequence, end)) {
+        end++;
+    }
+    while (end < length && _SFIsSpaceCodeunit(codepointSequence, end)) {
+        end++;
+    }
+
+    return end;
+}
+
+/**
+ * Returns the start of the segment ending at given index, made up of a word and its trailing spaces.
+ */
+static SFUInteger _SFGetSegmentStart(SBCodepointSequence *codepointSequence, SFUInteger end)
+{
+    SFUInteger start = end;
+
+    while (start > 0 && _SFIsSpaceCodeunit(codepointSequence, start - 1)) {
+        start--;
+    }
+    while (start > 0 && !_SFIsSpaceCodeunit(codepointSequence, start - 1)) {
+        start--;
+    }
+
+    return start;
+}
+
+static void _SFLoadGlyphInput(SFGlyphInputRef glyphInput, const SFGlyphID *glyphIDs, const SFUInt32 *clusters, SFUInteger glyphCount)
+{
+    glyphInput->glyphIDs = glyphIDs;
+    glyphInput->clusters = clusters;
+    glyphInput->glyphCount = glyphCount;
+}
+
+static SFBoolean _SFIsValidGlyphInput(SFGlyphInputRef glyphInput)
+{
+    return (glyphInput->glyphIDs && glyphInput->glyphCount);
+}
+
 SFArtistRef SFArtistCreate(void)
 {
-    SFArtistRef artist = malloc(sizeof(SFArtist));
+    SFArtistRef artist = SFAllocatorAllocate(sizeof(SFArtist));
     _SFLoadCodepointSequence(&artist->codepointSequence, 0, NULL, 0);
+    artist->leadingContext = 0;
+    artist->trailingContext = 0;
+    _SFLoadGlyphInput(&artist->glyphInput, NULL, NULL, 0);
+    artist->glyphCodeunitCount = 0;
     artist->pattern = NULL;
     artist->textDirection = SFTextDirectionLeftToRight;
     artist->textMode = SFTextModeForward;
+    artist->shapingMode = SFShapingModeComplete;
+    artist->segmentationMode = SFSegmentationModeNone;
+    artist->shapeCache = NULL;
+    SFListInitialize(&artist->_chunkTasks, sizeof(void *));
     artist->_retainCount = 1;
 
     return artist;
@@ -51,6 +142,37 @@ SFArtistRef SFArtistCreate(void)
 void SFArtistSetString(SFArtistRef artist, SFStringEncoding stringEncoding, void *stringBuffer, SFUInteger stringLength)
 {
     _SFLoadCodepointSequence(&artist->codepointSequence, stringEncoding, stringBuffer, stringLength);
+    _SFLoadGlyphInput(&artist->glyphInput, NULL, NULL, 0);
+    artist->leadingContext = 0;
+    artist->trailingContext = 0;
+}
+
+void SFArtistSetStringRange(SFArtistRef artist, SFStringEncoding stringEncoding, void *stringBuffer, SFUInteger stringLength,
+    SFUInteger rangeIndex, SFUInteger rangeLength)
+{
+    /* The range must lie within the string. */
+    SFAssert(rangeIndex <= stringLength && rangeLength <= stringLength - rangeIndex);
+
+    if (stringBuffer) {
+        stringBuffer = (SFUInt8 *)stringBuffer + (_SFGetCodeunitSize(stringEncoding) * rangeIndex);
+    }
+
+    _SFLoadCodepointSequence(&artist->codepointSequence, stringEncoding, stringBuffer, rangeLength);
+    _SFLoadGlyphInput(&artist->glyphInput, NULL, NULL, 0);
+    artist->leadingContext = rangeIndex;
+    artist->trailingContext = stringLength - rangeIndex - rangeLength;
+}
+
+void SFArtistSetGlyphs(SFArtistRef artist, const SFGlyphID *glyphIDs, const SFUInt32 *clusters, SFUInteger glyphCount, SFUInteger codeunitCount)
+{
+    /* Without clusters, each glyph maps to its own code unit. */
+    SFAssert(clusters || glyphCount <= codeunitCount);
+
+    _SFLoadGlyphInput(&artist->glyphInput, glyphIDs, clusters, glyphCount);
+    _SFLoadCodepointSequence(&artist->codepointSequence, 0, NULL, 0);
+    artist->leadingContext = 0;
+    artist->trailingContext = 0;
+    artist->glyphCodeunitCount = codeunitCount;
 }
 
 void SFArtistSetPattern(SFArtistRef artist, SFPatternRef pattern)
@@ -90,27 +212,975 @@ void SFArtistSetTextMode(SFArtistRef artist, SFTextMode textMode)
     artist->textMode = textMode;
 }
 
+void SFArtistSetShapingMode(SFArtistRef artist, SFShapingMode shapingMode)
+{
+    switch (shapingMode) {
+        case SFShapingModeComplete:
+        case SFShapingModeSubstitutionOnly:
+            break;
+
+        default:
+            /* Fallback to default value. */
+            shapingMode = SFShapingModeComplete;
+            break;
+    }
+
+    artist->shapingMode = shapingMode;
+}
+
+void SFArtistSetSegmentationMode(SFArtistRef artist, SFSegmentationMode segmentationMode)
+{
+    switch (segmentationMode) {
+        case SFSegmentationModeNone:
+        case SFSegmentationModeWords:
+            break;
+
+        default:
+            /* Fallback to default value. */
+            segmentationMode = SFSegmentationModeNone;
+            break;
+    }
+
+    artist->segmentationMode = segmentationMode;
+}
+
+void SFArtistSetShapeCache(SFArtistRef artist, SFShapeCacheRef shapeCache)
+{
+    SFShapeCacheRetain(shapeCache);
+    SFShapeCacheRelease(artist->shapeCache);
+
+    artist->shapeCache = shapeCache;
+}
+
+SF_INTERNAL void SFArtistLoadLeadingContext(SFArtistRef artist, SBCodepointSequence *context)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFUInt8 *contextBuffer = NULL;
+
+    if (sequence->stringBuffer) {
+        contextBuffer = (SFUInt8 *)sequence->stringBuffer - (_SFGetCodeunitSize(sequence->stringEncoding) * artist->leadingContext);
+    }
+
+    _SFLoadCodepointSequence(context, sequence->stringEncoding, contextBuffer, artist->leadingContext);
+}
+
+SF_INTERNAL void SFArtistLoadTrailingContext(SFArtistRef artist, SBCodepointSequence *context)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFUInt8 *contextBuffer = NULL;
+
+    if (sequence->stringBuffer) {
+        contextBuffer = (SFUInt8 *)sequence->stringBuffer + (_SFGetCodeunitSize(sequence->stringEncoding) * sequence->stringLength);
+    }
+
+    _SFLoadCodepointSequence(context, sequence->stringEncoding, contextBuffer, artist->trailingContext);
+}
+
+/**
+ * Narrows the source string of an artist to a range of it, keeping the rest of it as context.
+ */
+static void _SFNarrowString(SFArtistRef artist, SFUInteger index, SFUInteger length)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFUInteger codeunitSize = _SFGetCodeunitSize(sequence->stringEncoding);
+
+    artist->leadingContext += index;
+    artist->trailingContext += sequence->stringLength - index - length;
+
+    _SFLoadCodepointSequence(sequence, sequence->stringEncoding,
+                             (SFUInt8 *)sequence->stringBuffer + (codeunitSize * index), length);
+}
+
+static SFBoolean _SFHasContext(SFArtistRef artist)
+{
+    return (artist->leadingContext || artist->trailingContext);
+}
+
+static SFBoolean _SFShouldSegmentString(SFArtistRef artist)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+
+    /* Measurement leaves the album unfinished, so its segments could not be stitched. */
+    return (artist->segmentationMode == SFSegmentationModeWords
+            && artist->shapingMode != SFShapingModeMeasure
+            && artist->pattern->isSpaceSeparable
+            && _SFGetSegmentEnd(sequence, 0) < sequence->stringLength);
+}
+
+static void _SFFillAlbumBySegments(SFArtistRef artist, SFAlbumRef album)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFUInteger codeunitSize = _SFGetCodeunitSize(sequence->stringEncoding);
+    SFUInteger stringLength = sequence->stringLength;
+    SFBoolean isBackward = (artist->textMode == SFTextModeBackward);
+    SFArtist segmenter = *artist;
+    SFAlbum segmentAlbum;
+    SFUInteger segmentStart;
+    SFUInteger segmentEnd;
+
+    /* Shape the segments with a local copy which consults the same cache. */
+    segmenter.segmentationMode = SFSegmentationModeNone;
+    SFAlbumInitialize(&segmentAlbum);
+
+    SFAlbumReset(album, NULL, stringLength);
+
+    /* The glyphs of backward text start from its end, so are the segments. */
+    segmentStart = (isBackward ? stringLength : 0);
+    segmentEnd = segmentStart;
+
+    while (isBackward ? segmentStart > 0 : segmentEnd < stringLength) {
+        if (isBackward) {
+            segmentEnd = segmentStart;
+            segmentStart = _SFGetSegmentStart(sequence, segmentEnd);
+        } else {
+            segmentStart = segmentEnd;
+            segmentEnd = _SFGetSegmentEnd(sequence, segmentStart);
+        }
+
+        _SFLoadCodepointSequence(&segmenter.codepointSequence, sequence->stringEncoding,
+                                 (SFUInt8 *)sequence->stringBuffer + (codeunitSize * segmentStart),
+                                 segmentEnd - segmentStart);
+
+        /* The words do not affect each other, so only the outer segments keep the context. */
+        segmenter.leadingContext = (segmentStart == 0 ? artist->leadingContext : 0);
+        segmenter.trailingContext = (segmentEnd == stringLength ? artist->trailingContext : 0);
+
+        SFArtistFillAlbum(&segmenter, &segmentAlbum);
+        SFAlbumAppendSegment(album, &segmentAlbum, segmentStart);
+    }
+
+    SFAlbumFinalize(&segmentAlbum);
+}
+
+static void _SFProcessString(SFArtistRef artist, SFShapingEngineRef shapingEngine,
+    const SFCodepointRecord *records, SFUInteger recordCount, SFAlbumRef album)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFCodepoints codepoints;
+
+    SFCodepointsInitialize(&codepoints, sequence, artist->textMode == SFTextModeBackward);
+    SFAlbumReset(album, &codepoints, sequence->stringLength);
+
+    /* Decode the string once, so that each stage of the engine reads the same records. */
+    if (!records) {
+        SFBoolean isRTL = (artist->textDirection == SFTextDirectionRightToLeft);
+        SFCodepointsJoiningFunc joining = NULL;
+        SFCodepointRecord *buffer = SFAlbumReserveRecords(album, sequence->stringLength);
+
+        /* Classify the joining of each code point right away if the engine needs it. */
+        if (SFShapingKnowledgeSeekScript(&SFArabicKnowledgeInstance, artist->pattern->scriptTag)) {
+            joining = &SFArabicEngineDetermineJoiningType;
+        }
+
+        recordCount = SFCodepointsDecode(sequence, isRTL, joining, buffer);
+        records = buffer;
+    }
+
+    SFCodepointsSetRecords(&codepoints, records, recordCount);
+    SFShapingEngineProcessAlbum(shapingEngine, album);
+}
+
+static void _SFShapeString(SFArtistRef artist, SFAlbumRef album)
+{
+    SFUnifiedEngine unifiedEngine;
+
+    SFUnifiedEngineInitialize(&unifiedEngine, artist);
+    _SFProcessString(artist, (SFShapingEngineRef)&unifiedEngine, NULL, 0, album);
+}
+
+/**
+ * Shapes the source string with an engine initialized for the artist, consulting the shape cache.
+ * The code points are read from the records if they are given.
+ */
+static void _SFFillAlbumWithEngine(SFArtistRef artist, SFShapingEngineRef shapingEngine,
+    const SFCodepointRecord *records, SFUInteger recordCount, SFAlbumRef album)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    /*
+     * Measurement leaves the album unfinished, so its results are never cached. Neither are the
+     * results depending on a context, which is not a part of the key.
+     */
+    SFBoolean isCached = (artist->shapeCache && artist->shapingMode != SFShapingModeMeasure && !_SFHasContext(artist));
+    SFShapeCacheKey cacheKey;
+
+    if (isCached) {
+        SFShapeCacheKeyInitialize(&cacheKey, artist->pattern,
+                                  sequence->stringEncoding, sequence->stringBuffer,
+                                  _SFGetCodeunitSize(sequence->stringEncoding) * sequence->stringLength,
+                                  artist->textDirection, artist->textMode, artist->shapingMode);
+
+        if (SFShapeCacheLoadAlbum(artist->shapeCache, &cacheKey, album)) {
+            return;
+        }
+    }
+
+    _SFProcessString(artist, shapingEngine, records, recordCount, album);
+
+    if (isCached) {
+        SFShapeCacheStoreAlbum(artist->shapeCache, &cacheKey, album);
+    }
+}
+
+static SFBoolean _SFShouldExtendString(SFArtistRef artist)
+{
+    /* Measurement leaves the album unfinished, so the glyphs of the context could not be removed. */
+    return (_SFHasContext(artist)
+            && artist->shapingMode != SFShapingModeMeasure
+            && artist->pattern->contextLength > 1);
+}
+
+/**
+ * Tells whether a code point is a combining mark, which a lookup may skip, so that it does not
+ * count towards the reach of the lookup.
+ */
+static SFBoolean _SFIsCombiningMark(SFCodepoint codepoint)
+{
+    switch (SFGeneralCategoryDetermine(codepoint)) {
+        case SFGeneralCategoryMN:
+        case SFGeneralCategoryMC:
+        case SFGeneralCategoryME:
+            return SFTrue;
+
+        default:
+            return SFFalse;
+    }
+}
+
+/**
+ * Returns the number of code units taken by the given number of code points at the end of the
+ * leading context, not counting the combining marks.
+ */
+static SFUInteger _SFGetLeadingSpan(SFArtistRef artist, SFUInteger codepointCount)
+{
+    SBCodepointSequence context;
+    SFUInteger index;
+
+    SFArtistLoadLeadingContext(artist, &context);
+    index = context.stringLength;
+
+    while (codepointCount > 0 && index > 0) {
+        SFCodepoint codepoint = SBCodepointSequenceGetCodepointBefore(&context, &index);
+
+        if (!_SFIsCombiningMark(codepoint)) {
+            codepointCount -= 1;
+        }
+    }
+
+    return context.stringLength - index;
+}
+
+/**
+ * Returns the number of code units taken by the given number of code points at the start of the
+ * trailing context, not counting the combining marks, along with the marks of the last one.
+ */
+static SFUInteger _SFGetTrailingSpan(SFArtistRef artist, SFUInteger codepointCount)
+{
+    SBCodepointSequence context;
+    SFUInteger index = 0;
+
+    SFArtistLoadTrailingContext(artist, &context);
+
+    while (index < context.stringLength) {
+        SFUInteger nextIndex = index;
+        SFCodepoint codepoint = SBCodepointSequenceGetCodepointAt(&context, &nextIndex);
+        SFBoolean isMark = _SFIsCombiningMark(codepoint);
+
+        if (codepointCount == 0 && !isMark) {
+            break;
+        }
+
+        index = nextIndex;
+        if (!isMark) {
+            codepointCount -= 1;
+        }
+    }
+
+    return index;
+}
+
+/**
+ * Tells whether the glyphs of the string have been kept apart from the glyphs of its context, by
+ * looking for the glyphs of the code units right after the leading and right at the trailing span.
+ */
+static SFBoolean _SFIsContextSeparate(SFAlbumRef album, SFUInteger leadingSpan, SFUInteger trailingSpan)
+{
+    SFUInteger trailingStart = album->codeunitCount - trailingSpan;
+    SFBoolean hasLeadingEdge = (leadingSpan == 0);
+    SFBoolean hasTrailingEdge = (trailingSpan == 0);
+    SFUInteger index;
+
+    for (index = 0; index < album->glyphCount; index++) {
+        SFUInteger association = SFAlbumGetAssociation(album, index);
+
+        hasLeadingEdge |= (association == leadingSpan);
+        hasTrailingEdge |= (association == trailingStart);
+    }
+
+    return (hasLeadingEdge && hasTrailingEdge);
+}
+
+/**
+ * Fills the album by shaping the string along with its context.
+ *
+ * @return
+ *      SFTrue if the glyphs of the string were kept apart from the glyphs of its context, SFFalse if
+ *      the string had to be shaped with its joining context only.
+ */
+static SFBoolean _SFFillAlbumWithContext(SFArtistRef artist, SFAlbumRef album)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFUInteger codeunitSize = _SFGetCodeunitSize(sequence->stringEncoding);
+    SFUInteger contextLength = artist->pattern->contextLength;
+    SFUInteger leadingSpan = _SFGetLeadingSpan(artist, contextLength);
+    SFUInteger trailingSpan = _SFGetTrailingSpan(artist, contextLength);
+    SFArtist extender = *artist;
+
+    /*
+     * Shape the string along with as much of its context as the longest lookup can reach, counted
+     * in characters other than marks, so that the lookups see the same glyphs around the string as
+     * in the whole text. The context beyond is still consulted for joining.
+     */
+    _SFLoadCodepointSequence(&extender.codepointSequence, sequence->stringEncoding,
+                             (SFUInt8 *)sequence->stringBuffer - (codeunitSize * leadingSpan),
+                             leadingSpan + sequence->stringLength + trailingSpan);
+    extender.leadingContext -= leadingSpan;
+    extender.trailingContext -= trailingSpan;
+
+    _SFShapeString(&extender, album);
+
+    if (_SFIsContextSeparate(album, leadingSpan, trailingSpan)) {
+        SFAlbumRemoveContext(album, leadingSpan, trailingSpan);
+        return SFTrue;
+    }
+
+    /* A lookup has merged the glyphs across an edge, so keep the string to its own glyphs. */
+    _SFShapeString(artist, album);
+    return SFFalse;
+}
+
 void SFArtistFillAlbum(SFArtistRef artist, SFAlbumRef album)
 {
-    if (artist->pattern && _SFIsValidCodepointSequence(&artist->codepointSequence)) {
-        SFCodepoints codepoints;
+    if (artist->pattern && _SFIsValidGlyphInput(&artist->glyphInput)) {
         SFUnifiedEngine unifiedEngine;
         SFShapingEngineRef shapingEngine;
 
-        SFCodepointsInitialize(&codepoints,
-                               &artist->codepointSequence,
-                               artist->textMode == SFTextModeBackward);
-
         SFUnifiedEngineInitialize(&unifiedEngine, artist);
         shapingEngine = (SFShapingEngineRef)&unifiedEngine;
 
-        SFAlbumReset(album, &codepoints, artist->codepointSequence.stringLength);
+        SFAlbumResetForGlyphs(album, &artist->glyphInput, artist->glyphCodeunitCount);
         SFShapingEngineProcessAlbum(shapingEngine, album);
+    } else if (artist->pattern && _SFIsValidCodepointSequence(&artist->codepointSequence)
+               && _SFShouldSegmentString(artist)) {
+        _SFFillAlbumBySegments(artist, album);
+    } else if (artist->pattern && _SFIsValidCodepointSequence(&artist->codepointSequence)
+               && _SFShouldExtendString(artist)) {
+        _SFFillAlbumWithContext(artist, album);
+    } else if (artist->pattern && _SFIsValidCodepointSequence(&artist->codepointSequence)) {
+        SFUnifiedEngine unifiedEngine;
+
+        SFUnifiedEngineInitialize(&unifiedEngine, artist);
+        _SFFillAlbumWithEngine(artist, (SFShapingEngineRef)&unifiedEngine, NULL, 0, album);
     } else {
         SFAlbumReset(album, NULL, 0);
     }
 }
 
+void SFArtistFillAlbums(SFArtistRef artist, SFStringEncoding stringEncoding,
+    void * const *stringBuffers, const SFUInteger *stringLengths, SFUInteger count, SFAlbumRef *albums)
+{
+    SFArtist batcher = *artist;
+    SFUnifiedEngine unifiedEngine;
+    SFShapingEngineRef shapingEngine = NULL;
+    SFUInteger index;
+
+    /* The strings stand on their own, so they neither have a context nor need to be segmented. */
+    batcher.leadingContext = 0;
+    batcher.trailingContext = 0;
+
+    /* Pick the engine once, as it only depends on the pattern. */
+    if (artist->pattern) {
+        SFUnifiedEngineInitialize(&unifiedEngine, &batcher);
+        shapingEngine = (SFShapingEngineRef)&unifiedEngine;
+    }
+
+    for (index = 0; index < count; index++) {
+        SBCodepointSequence *sequence = &batcher.codepointSequence;
+        SFAlbumRef album = albums[index];
+
+        _SFLoadCodepointSequence(sequence, stringEncoding, stringBuffers[index], stringLengths[index]);
+
+        if (shapingEngine && _SFIsValidCodepointSequence(sequence)) {
+            _SFFillAlbumWithEngine(&batcher, shapingEngine, NULL, 0, album);
+        } else {
+            SFAlbumReset(album, NULL, 0);
+        }
+    }
+}
+
+/**
+ * Keeps the state of a chunk of the source string, shaped as a separate task.
+ */
+typedef struct _SFChunkTask {
+    SFArtist artist;                /**< Local copy of the artist, narrowed to the chunk. */
+    SFAlbum album;                  /**< Album receiving the results of the chunk. */
+    SFUInteger codeunitIndex;       /**< Index of the first code unit of the chunk. */
+    SFBoolean isSeparate;           /**< Whether the chunk was shaped apart from the context. */
+} _SFChunkTask, *_SFChunkTaskRef;
+
+static void _SFShapeChunk(void *object)
+{
+    _SFChunkTaskRef task = (_SFChunkTaskRef)object;
+
+    if (_SFShouldExtendString(&task->artist)) {
+        task->isSeparate = _SFFillAlbumWithContext(&task->artist, &task->album);
+    } else {
+        SFArtistFillAlbum(&task->artist, &task->album);
+        task->isSeparate = SFTrue;
+    }
+}
+
+/**
+ * Returns the tasks for given number of chunks, creating the missing ones. The tasks and their
+ * albums are kept by the artist, so a repeated fill reuses their storage.
+ */
+static void **_SFReserveChunkTasks(SFArtistRef artist, SFUInteger chunkCount)
+{
+    SFUInteger taskCount = artist->_chunkTasks.count;
+
+    if (chunkCount > taskCount) {
+        SFUInteger index;
+
+        SFListReserveRange(&artist->_chunkTasks, taskCount, chunkCount - taskCount);
+
+        for (index = taskCount; index < chunkCount; index++) {
+            _SFChunkTaskRef chunk = SFAllocatorAllocate(sizeof(_SFChunkTask));
+            SFAlbumInitialize(&chunk->album);
+            SFListSetVal(&artist->_chunkTasks, index, chunk);
+        }
+    }
+
+    return artist->_chunkTasks.items;
+}
+
+/**
+ * Returns the end of the chunk starting at given index, which is right after the spaces following
+ * its preferred length.
+ */
+static SFUInteger _SFGetChunkEnd(SBCodepointSequence *codepointSequence, SFUInteger start, SFUInteger chunkLength)
+{
+    if (chunkLength >= codepointSequence->stringLength - start) {
+        return codepointSequence->stringLength;
+    }
+
+    return _SFGetSegmentEnd(codepointSequence, start + chunkLength);
+}
+
+void SFArtistFillAlbumConcurrently(SFArtistRef artist, SFAlbumRef album, SFUInteger chunkLength,
+    SFArtistRunTasksFunc runTasks, void *object)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFUInteger stringLength = sequence->stringLength;
+    SFUInteger chunkCount = 0;
+    SFUInteger chunkStart;
+    SFUInteger chunkEnd;
+
+    /*
+     * Count the chunks, each of which ends at a word boundary. A lookup involving the space could
+     * merge the glyphs across the edges of the chunks, so such patterns shape the string at once.
+     */
+    if (artist->pattern && artist->pattern->isSpaceSeparable && _SFIsValidCodepointSequence(sequence)
+        && artist->shapingMode != SFShapingModeMeasure && chunkLength > 0) {
+        for (chunkStart = 0; chunkStart < stringLength; chunkStart = chunkEnd) {
+            chunkEnd = _SFGetChunkEnd(sequence, chunkStart, chunkLength);
+            chunkCount += 1;
+        }
+    }
+
+    if (chunkCount > 1) {
+        SFBoolean isBackward = (artist->textMode == SFTextModeBackward);
+        SFBoolean isSeparate = SFTrue;
+        void **tasks = _SFReserveChunkTasks(artist, chunkCount);
+        SFUInteger index;
+
+        chunkEnd = 0;
+
+        for (index = 0; index < chunkCount; index++) {
+            _SFChunkTaskRef chunk = tasks[index];
+
+            chunkStart = chunkEnd;
+            chunkEnd = _SFGetChunkEnd(sequence, chunkStart, chunkLength);
+
+            /* The chunks are shaped on other threads, so they may share the cache only if it is locked. */
+            chunk->artist = *artist;
+            chunk->artist.shapeCache = (SFShapeCacheIsLocked(artist->shapeCache) ? artist->shapeCache : NULL);
+            _SFNarrowString(&chunk->artist, chunkStart, chunkEnd - chunkStart);
+
+            /* The chunks end at spaces, so only the edges of the string keep its context. */
+            chunk->artist.leadingContext = (chunkStart == 0 ? artist->leadingContext : 0);
+            chunk->artist.trailingContext = (chunkEnd == stringLength ? artist->trailingContext : 0);
+
+            chunk->codeunitIndex = chunkStart;
+            chunk->isSeparate = SFFalse;
+        }
+
+        if (runTasks) {
+            runTasks(object, &_SFShapeChunk, tasks, chunkCount);
+        } else {
+            for (index = 0; index < chunkCount; index++) {
+                _SFShapeChunk(tasks[index]);
+            }
+        }
+
+        for (index = 0; index < chunkCount; index++) {
+            isSeparate &= ((_SFChunkTaskRef)tasks[index])->isSeparate;
+        }
+
+        if (isSeparate) {
+            SFAlbumReset(album, NULL, stringLength);
+
+            /* The glyphs of backward text start from its end, so are the chunks. */
+            for (index = 0; index < chunkCount; index++) {
+                _SFChunkTaskRef chunk = tasks[isBackward ? chunkCount - index - 1 : index];
+                SFAlbumAppendSegment(album, &chunk->album, chunk->codeunitIndex);
+            }
+        } else {
+            /* A lookup has merged the glyphs across the edges of the string with its context. */
+            SFArtistFillAlbum(artist, album);
+        }
+    } else {
+        SFArtistFillAlbum(artist, album);
+    }
+}
+
+/**
+ * Keeps the state of shaping the source string with one of many patterns, as a separate task.
+ */
+typedef struct _SFPatternTask {
+    SFArtist artist;                    /**< Local copy of the artist, holding the pattern. */
+    SFAlbumRef album;                   /**< Album receiving the results of the pattern. */
+    const SFCodepointRecord *records;   /**< Code points of the string, decoded once for all tasks. */
+    SFUInteger recordCount;             /**< Number of decoded code points. */
+} _SFPatternTask, *_SFPatternTaskRef;
+
+static void _SFShapePattern(void *object)
+{
+    _SFPatternTaskRef task = (_SFPatternTaskRef)object;
+    SFArtistRef artist = &task->artist;
+
+    /* Segments and contexts are decoded on their own, so only the whole string uses the records. */
+    if (artist->pattern && task->records
+        && !_SFShouldSegmentString(artist) && !_SFShouldExtendString(artist)) {
+        SFUnifiedEngine unifiedEngine;
+
+        SFUnifiedEngineInitialize(&unifiedEngine, artist);
+        _SFFillAlbumWithEngine(artist, (SFShapingEngineRef)&unifiedEngine,
+                               task->records, task->recordCount, task->album);
+    } else {
+        SFArtistFillAlbum(artist, task->album);
+    }
+}
+
+void SFArtistFillAlbumsWithPatterns(SFArtistRef artist, SFPatternRef *patterns, SFUInteger count,
+    SFAlbumRef *albums, SFArtistRunTasksFunc runTasks, void *object)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFCodepointRecord *records = NULL;
+    SFUInteger recordCount = 0;
+    _SFPatternTaskRef patternTasks;
+    void **tasks;
+    SFUInteger index;
+
+    if (count == 0) {
+        return;
+    }
+
+    /* Decode the string once, as it is the same for all patterns. */
+    if (!_SFIsValidGlyphInput(&artist->glyphInput) && _SFIsValidCodepointSequence(sequence)) {
+        records = SFAllocatorAllocate(sizeof(SFCodepointRecord) * sequence->stringLength);
+        /* Any of the patterns may need the joining types, so resolve them up front. */
+        recordCount = SFCodepointsDecode(sequence, artist->textDirection == SFTextDirectionRightToLeft,
+                                         &SFArabicEngineDetermineJoiningType, records);
+    }
+
+    patternTasks = SFAllocatorAllocate(sizeof(_SFPatternTask) * count);
+    tasks = SFAllocatorAllocate(sizeof(void *) * count);
+
+    for (index = 0; index < count; index++) {
+        _SFPatternTaskRef task = &patternTasks[index];
+
+        /* The tasks may run on other threads, so they share the cache only if it is locked. */
+        task->artist = *artist;
+        task->artist.pattern = patterns[index];
+        task->artist.shapeCache = (SFShapeCacheIsLocked(artist->shapeCache) ? artist->shapeCache : NULL);
+        task->album = albums[index];
+        task->records = records;
+        task->recordCount = recordCount;
+
+        tasks[index] = task;
+    }
+
+    if (runTasks) {
+        runTasks(object, &_SFShapePattern, tasks, count);
+    } else {
+        for (index = 0; index < count; index++) {
+            _SFShapePattern(tasks[index]);
+        }
+    }
+
+    SFAllocatorDeallocate(tasks);
+    SFAllocatorDeallocate(patternTasks);
+
+    if (records) {
+        SFAllocatorDeallocate(records);
+    }
+}
+
+/**
+ * Returns the association of a glyph counted in logical order, regardless of the text mode.
+ */
+static SFUInteger _SFGetLogicalAssociation(SFAlbumRef album, SFUInteger index, SFBoolean isBackward)
+{
+    return SFAlbumGetAssociation(album, isBackward ? album->glyphCount - index - 1 : index);
+}
+
+/**
+ * Tells whether the clusters of an album never go back in logical order, so that the glyphs of any
+ * range of code units are consecutive.
+ */
+static SFBoolean _SFHasOrderedClusters(SFAlbumRef album, SFBoolean isBackward)
+{
+    SFUInteger index;
+
+    for (index = 1; index < album->glyphCount; index++) {
+        if (_SFGetLogicalAssociation(album, index - 1, isBackward) > _SFGetLogicalAssociation(album, index, isBackward)) {
+            return SFFalse;
+        }
+    }
+
+    return SFTrue;
+}
+
+static SFBoolean _SFCanUpdateAlbum(SFArtistRef artist, SFAlbumRef album,
+    SFUInteger editIndex, SFUInteger editLength, SFUInteger newLength)
+{
+    SFUInteger codeunitCount = album->codeunitCount;
+
+    /* Only the wrapped up glyphs of a previous string can be updated. */
+    return (artist->pattern
+            && _SFIsValidCodepointSequence(&artist->codepointSequence)
+            && artist->shapingMode != SFShapingModeMeasure
+            && (album->_state == _SFAlbumStateFilled || album->_state == _SFAlbumStateArranged)
+            && (album->_state == _SFAlbumStateArranged) == (artist->shapingMode == SFShapingModeComplete)
+            && album->glyphCount > 0
+            && editIndex <= codeunitCount && editLength <= codeunitCount - editIndex
+            && codeunitCount - editLength + newLength == artist->codepointSequence.stringLength
+            && _SFHasOrderedClusters(album, artist->textMode == SFTextModeBackward));
+}
+
+/**
+ * Returns the number of glyphs, counted in logical order, which belong to code units before the
+ * given one.
+ */
+static SFUInteger _SFSearchBoundary(SFAlbumRef album, SFUInteger codeunitIndex, SFBoolean isBackward)
+{
+    SFUInteger low = 0;
+    SFUInteger high = album->glyphCount;
+
+    while (low < high) {
+        SFUInteger mid = low + (high - low) / 2;
+
+        if (_SFGetLogicalAssociation(album, mid, isBackward) < codeunitIndex) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * Tells whether the text can be broken before a glyph counted in logical order, without changing
+ * the shaping results on either side.
+ */
+static SFBoolean _SFIsSafeBoundary(SFAlbumRef album, SFUInteger boundary, SFBoolean isBackward)
+{
+    if (boundary == 0 || boundary == album->glyphCount) {
+        return SFTrue;
+    }
+
+    /* A cluster is never broken. */
+    if (_SFGetLogicalAssociation(album, boundary - 1, isBackward) >= _SFGetLogicalAssociation(album, boundary, isBackward)) {
+        return SFFalse;
+    }
+
+    /* The flag belongs to the latter of both glyphs in the order of the album. */
+    return !SFAlbumIsUnsafeToBreak(album, isBackward ? album->glyphCount - boundary : boundary);
+}
+
+static SFUInteger _SFGetBoundaryCodeunit(SFAlbumRef album, SFUInteger boundary, SFBoolean isBackward)
+{
+    if (boundary == 0) {
+        return 0;
+    }
+    if (boundary == album->glyphCount) {
+        return album->codeunitCount;
+    }
+
+    return _SFGetLogicalAssociation(album, boundary, isBackward);
+}
+
+/**
+ * Tells whether a glyph, counted in logical order, can be skipped by a lookup so that it does not
+ * count towards the reach of the lookup.
+ */
+static SFBoolean _SFIsIgnorableGlyph(SFAlbumRef album, SFUInteger index, SFBoolean isBackward)
+{
+    SFGlyphTraits traits = SFAlbumGetAllTraits(album, isBackward ? album->glyphCount - index - 1 : index);
+
+    return ((traits & SFGlyphTraitMark) != 0);
+}
+
+/**
+ * Fills the album with the window of an update.
+ *
+ * @return
+ *      SFTrue if the glyphs of the window were kept apart from the glyphs around it, SFFalse if a
+ *      lookup has merged them across an edge of the window.
+ */
+static SFBoolean _SFFillWindowAlbum(SFArtistRef artist, SFAlbumRef album)
+{
+    /* The window is short, so it is shaped at once to learn whether its edges were crossed. */
+    artist->segmentationMode = SFSegmentationModeNone;
+
+    if (_SFShouldExtendString(artist)) {
+        return _SFFillAlbumWithContext(artist, album);
+    }
+
+    SFArtistFillAlbum(artist, album);
+    return SFTrue;
+}
+
+void SFArtistUpdateAlbum(SFArtistRef artist, SFAlbumRef album,
+    SFUInteger editIndex, SFUInteger editLength, SFUInteger newLength)
+{
+    if (_SFCanUpdateAlbum(artist, album, editIndex, editLength, newLength)) {
+        SFBoolean isBackward = (artist->textMode == SFTextModeBackward);
+        SFUInteger firstBoundary = _SFSearchBoundary(album, editIndex, isBackward);
+        SFUInteger lastBoundary = _SFSearchBoundary(album, editIndex + editLength, isBackward);
+        SFUInteger skipCount;
+        SFUInteger windowStart;
+        SFUInteger windowEnd;
+        SFArtist updater = *artist;
+        SFAlbum windowAlbum;
+        SFBoolean isSeparate;
+
+        /*
+         * A lookup touching the edited glyphs can reach the context length of the pattern beyond
+         * them, not counting the marks which it may skip. One more glyph is taken as the cluster
+         * holding the start of the edit may begin before it.
+         */
+        skipCount = artist->pattern->contextLength + 1;
+        while (firstBoundary > 0 && (skipCount > 0 || !_SFIsSafeBoundary(album, firstBoundary, isBackward))) {
+            firstBoundary -= 1;
+            skipCount -= (skipCount > 0 && !_SFIsIgnorableGlyph(album, firstBoundary, isBackward));
+        }
+
+        skipCount = artist->pattern->contextLength + 1;
+        while (lastBoundary < album->glyphCount && (skipCount > 0 || !_SFIsSafeBoundary(album, lastBoundary, isBackward))) {
+            skipCount -= (skipCount > 0 && !_SFIsIgnorableGlyph(album, lastBoundary, isBackward));
+            lastBoundary += 1;
+        }
+
+        windowStart = _SFGetBoundaryCodeunit(album, firstBoundary, isBackward);
+        windowEnd = _SFGetBoundaryCodeunit(album, lastBoundary, isBackward);
+
+        /* Shape the window of the new string with a local copy, keeping the text around it as context. */
+        _SFNarrowString(&updater, windowStart, (windowEnd - windowStart) - editLength + newLength);
+        SFAlbumInitialize(&windowAlbum);
+        isSeparate = _SFFillWindowAlbum(&updater, &windowAlbum);
+
+        if (isSeparate) {
+            /* The glyphs of backward text start from its end. */
+            SFAlbumReplaceSegment(album, isBackward ? album->glyphCount - lastBoundary : firstBoundary,
+                                  lastBoundary - firstBoundary, windowStart, windowEnd - windowStart, &windowAlbum);
+        }
+
+        SFAlbumFinalize(&windowAlbum);
+
+        /* A lookup has merged the glyphs across an edge of the window, so shape the whole text. */
+        if (!isSeparate) {
+            SFArtistFillAlbum(artist, album);
+        }
+    } else {
+        SFArtistFillAlbum(artist, album);
+    }
+}
+
+static SFGlyphID _SFGetLogicalGlyph(SFAlbumRef album, SFUInteger index, SFBoolean isBackward)
+{
+    return SFAlbumGetGlyph(album, isBackward ? album->glyphCount - index - 1 : index);
+}
+
+/**
+ * Shapes the clusters left with missing glyphs again with a fallback pattern, replacing them with
+ * its results wherever it has any glyph for them.
+ */
+static void _SFFillMissingGlyphs(SFArtistRef artist, SFAlbumRef album, SFPatternRef fallback, SFUInt16 fontIndex)
+{
+    SFBoolean isBackward = (artist->textMode == SFTextModeBackward);
+    SFUInteger boundary = 0;
+    SFArtist fallbacker;
+    SFAlbum rangeAlbum;
+
+    SFAlbumInitialize(&rangeAlbum);
+
+    while (boundary < album->glyphCount) {
+        SFUInteger firstBoundary;
+        SFUInteger lastBoundary;
+        SFUInteger rangeStart;
+        SFUInteger rangeEnd;
+        SFUInteger index;
+        SFBoolean isFound = SFFalse;
+
+        if (_SFGetLogicalGlyph(album, boundary, isBackward) != 0) {
+            boundary += 1;
+            continue;
+        }
+
+        /* Take the whole clusters, joining the adjacent ones with missing glyphs. */
+        firstBoundary = boundary;
+        while (firstBoundary > 0
+               && _SFGetLogicalAssociation(album, firstBoundary - 1, isBackward) == _SFGetLogicalAssociation(album, firstBoundary, isBackward)) {
+            firstBoundary -= 1;
+        }
+
+        lastBoundary = boundary + 1;
+        while (lastBoundary < album->glyphCount
+               && (_SFGetLogicalGlyph(album, lastBoundary, isBackward) == 0
+                   || _SFGetLogicalAssociation(album, lastBoundary - 1, isBackward) == _SFGetLogicalAssociation(album, lastBoundary, isBackward))) {
+            lastBoundary += 1;
+        }
+
+        rangeStart = _SFGetBoundaryCodeunit(album, firstBoundary, isBackward);
+        rangeEnd = _SFGetBoundaryCodeunit(album, lastBoundary, isBackward);
+
+        /* Shape the range with a local copy, keeping the rest of the string as context. */
+        fallbacker = *artist;
+        fallbacker.pattern = fallback;
+        _SFNarrowString(&fallbacker, rangeStart, rangeEnd - rangeStart);
+        SFArtistFillAlbum(&fallbacker, &rangeAlbum);
+
+        for (index = 0; index < rangeAlbum.glyphCount; index++) {
+            if (SFAlbumGetGlyph(&rangeAlbum, index) != 0) {
+                isFound = SFTrue;
+                break;
+            }
+        }
+
+        /* The range is kept as it is if the fallback has none of its glyphs either. */
+        if (isFound && _SFHasOrderedClusters(&rangeAlbum, isBackward)) {
+            SFAlbumSetFontIndex(&rangeAlbum, fontIndex);
+
+            /* The glyphs of backward text start from its end. */
+            SFAlbumReplaceSegment(album, isBackward ? album->glyphCount - lastBoundary : firstBoundary,
+                                  lastBoundary - firstBoundary, rangeStart, rangeEnd - rangeStart, &rangeAlbum);
+
+            lastBoundary = firstBoundary + rangeAlbum.glyphCount;
+        }
+
+        boundary = lastBoundary;
+    }
+
+    SFAlbumFinalize(&rangeAlbum);
+}
+
+void SFArtistFillAlbumWithFallbacks(SFArtistRef artist, SFAlbumRef album,
+    SFPatternRef *fallbacks, SFUInteger fallbackCount)
+{
+    SFUInteger index;
+
+    SFArtistFillAlbum(artist, album);
+
+    /* The missing glyphs can only be replaced in clusters following the order of the text. */
+    if (_SFCanUpdateAlbum(artist, album, 0, album->codeunitCount, album->codeunitCount)) {
+        for (index = 0; index < fallbackCount; index++) {
+            if (fallbacks[index]) {
+                _SFFillMissingGlyphs(artist, album, fallbacks[index], (SFUInt16)(index + 1));
+            }
+        }
+    }
+}
+
+SFInteger SFArtistMeasure(SFArtistRef artist, SFAlbumRef album)
+{
+    /* Shape with a local copy so that the artist remains untouched. */
+    SFArtist measurer = *artist;
+    measurer.shapingMode = SFShapingModeMeasure;
+
+    SFArtistFillAlbum(&measurer, album);
+
+    return SFAlbumGetTotalAdvance(album);
+}
+
+/**
+ * Mixes a value into the hash of a shape key as 32 bits, so that the key does not depend on the
+ * width of the types holding the value.
+ */
+static SFUInt64 _SFHashKeyValue(SFUInt64 hash, SFUInteger value)
+{
+    SFUInt32 fixed = (SFUInt32)value;
+
+    return SFHash64Bytes(hash, &fixed, sizeof(SFUInt32));
+}
+
+/**
+ * Mixes the code units of a sequence into the hash of a shape key, preceded by their count so that
+ * consecutive sequences cannot be confused with each other.
+ */
+static SFUInt64 _SFHashKeySequence(SFUInt64 hash, const SBCodepointSequence *sequence)
+{
+    hash = _SFHashKeyValue(hash, sequence->stringLength);
+    hash = SFHash64Bytes(hash, sequence->stringBuffer, _SFGetCodeunitSize(sequence->stringEncoding) * sequence->stringLength);
+
+    return hash;
+}
+
+void SFArtistGetShapeKey(SFArtistRef artist, SFShapeKey *key)
+{
+    SBCodepointSequence *sequence = &artist->codepointSequence;
+    SFGlyphInputRef glyphInput = &artist->glyphInput;
+    SFUInt64 hash = SFHash64Seed;
+
+    if (_SFIsValidGlyphInput(glyphInput)) {
+        hash = _SFHashKeyValue(hash, glyphInput->glyphCount);
+        hash = SFHash64Bytes(hash, glyphInput->glyphIDs, sizeof(SFGlyphID) * glyphInput->glyphCount);
+        if (glyphInput->clusters) {
+            hash = SFHash64Bytes(hash, glyphInput->clusters, sizeof(SFUInt32) * glyphInput->glyphCount);
+        }
+        hash = _SFHashKeyValue(hash, artist->glyphCodeunitCount);
+    } else if (_SFIsValidCodepointSequence(sequence)) {
+        hash = _SFHashKeyValue(hash, sequence->stringEncoding);
+        hash = _SFHashKeySequence(hash, sequence);
+
+        if (_SFHasContext(artist)) {
+            SBCodepointSequence context;
+
+            SFArtistLoadLeadingContext(artist, &context);
+            hash = _SFHashKeySequence(hash, &context);
+            SFArtistLoadTrailingContext(artist, &context);
+            hash = _SFHashKeySequence(hash, &context);
+        }
+    }
+
+    hash = _SFHashKeyValue(hash, artist->textDirection);
+    hash = _SFHashKeyValue(hash, artist->textMode);
+    hash = _SFHashKeyValue(hash, artist->shapingMode);
+
+    key->patternHash = (artist->pattern ? SFPatternCalculateHash(artist->pattern) : SFHashSeed);
+    key->textHash = hash;
+}
+
 SFArtistRef SFArtistRetain(SFArtistRef artist)
 {
     if (artist) {
@@ -123,6 +1193,16 @@ SFArtistRef SFArtistRetain(SFArtistRef artist)
 void SFArtistRelease(SFArtistRef artist)
 {
     if (artist && --artist->_retainCount == 0) {
-        free(artist);
+        SFUInteger index;
+
+        for (index = 0; index < artist->_chunkTasks.count; index++) {
+            _SFChunkTaskRef chunk = SFListGetVal(&artist->_chunkTasks, index);
+            SFAlbumFinalize(&chunk->album);
+            SFAllocatorDeallocate(chunk);
+        }
+
+        SFListFinalize(&artist->_chunkTasks);
+        SFShapeCacheRelease(artist->shapeCache);
+        SFAllocatorDeallocate(artist);
     }
 }
@@ -22,15 +22,42 @@
 
 #include <SBCodepointSequence.h>
 
+#include "SFAlbum.h"
 #include "SFBase.h"
+#include "SFList.h"
 #include "SFPattern.h"
 
+/**
+ * The internal shaping mode which only produces the advances needed for measurement.
+ */
+enum {
+    SFShapingModeMeasure = 2
+};
+
 typedef struct _SFArtist {
     SBCodepointSequence codepointSequence;
+    SFUInteger leadingContext;
+    SFUInteger trailingContext;
+    SFGlyphInput glyphInput;
+    SFUInteger glyphCodeunitCount;
     SFPatternRef pattern;
     SFTextDirection textDirection;
     SFTextMode textMode;
+    SFShapingMode shapingMode;
+    SFSegmentationMode segmentationMode;
+    SFShapeCacheRef shapeCache;
+    SF_LIST(void *) _chunkTasks;    /**< Tasks of concurrent filling, kept along with their albums. */
     SFUInteger _retainCount;
 } SFArtist;
 
+/**
+ * Loads the code units before the source string which are kept as its context.
+ */
+SF_INTERNAL void SFArtistLoadLeadingContext(SFArtistRef artist, SBCodepointSequence *context);
+
+/**
+ * Loads the code units after the source string which are kept as its context.
+ */
+SF_INTERNAL void SFArtistLoadTrailingContext(SFArtistRef artist, SBCodepointSequence *context);
+
 #endif
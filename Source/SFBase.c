@@ -20,6 +20,33 @@
 
 const SFRange SFRangeEmpty = { 0, 0 };
 
+SF_INTERNAL SFUInt32 SFHashBytes(SFUInt32 hash, const void *bytes, SFUInteger length)
+{
+    const SFUInt8 *data = bytes;
+    SFUInteger index;
+
+    for (index = 0; index < length; index++) {
+        hash ^= data[index];
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+SF_INTERNAL SFUInt64 SFHash64Bytes(SFUInt64 hash, const void *bytes, SFUInteger length)
+{
+    const SFUInt64 prime = ((SFUInt64)0x100UL << 32) | 0x1B3UL;
+    const SFUInt8 *data = bytes;
+    SFUInteger index;
+
+    for (index = 0; index < length; index++) {
+        hash ^= data[index];
+        hash *= prime;
+    }
+
+    return hash;
+}
+
 SFTextDirection SFScriptGetDefaultDirection(SFTag scriptTag)
 {
     SFScriptKnowledgeRef knowledge = SFShapingKnowledgeSeekScript(&SFUnifiedKnowledgeInstance, scriptTag);
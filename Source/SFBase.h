@@ -35,6 +35,11 @@
  */
 #define SFUInt32Max         UINT32_MAX
 
+/**
+ * A value that indicates maximum limit of SFUInteger
+ */
+#define SFUIntegerMax       ((SFUInteger)(-1))
+
 /**
  * A value representing an invalid code point.
  */
@@ -58,4 +63,24 @@ typedef struct _SFRange {
 
 extern const SFRange SFRangeEmpty;
 
+/**
+ * The initial value of a hash computed with SFHashBytes.
+ */
+#define SFHashSeed          2166136261UL
+
+/**
+ * Mixes the given bytes into a 32-bit FNV-1a hash.
+ */
+SF_INTERNAL SFUInt32 SFHashBytes(SFUInt32 hash, const void *bytes, SFUInteger length);
+
+/**
+ * The initial value of a hash computed with SFHash64Bytes.
+ */
+#define SFHash64Seed        (((SFUInt64)0xCBF29CE4UL << 32) | 0x84222325UL)
+
+/**
+ * Mixes the given bytes into a 64-bit FNV-1a hash.
+ */
+SF_INTERNAL SFUInt64 SFHash64Bytes(SFUInt64 hash, const void *bytes, SFUInteger length);
+
 #endif
@@ -17,6 +17,7 @@
 #include <SBBase.h>
 #include <SBCodepointSequence.h>
 #include <SFConfig.h>
+#include <string.h>
 
 #include "SFAssert.h"
 #include "SFBase.h"
@@ -27,23 +28,202 @@ SF_INTERNAL SFCodepoint SFCodepointsGetMirror(SFCodepoint codepoint)
     return SBCodepointGetMirror(codepoint);
 }
 
+/**
+ * Describes how the properties of the decoded code points are resolved.
+ */
+typedef struct _SFDecodeOptions {
+    SFBoolean mirrors;
+    SFCodepointsJoiningFunc joining;
+} _SFDecodeOptions;
+
+static SFBoolean _SFIsMirroredASCII(SFCodepoint codepoint)
+{
+    switch (codepoint) {
+        case '(':
+        case ')':
+        case '<':
+        case '>':
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+            return SFTrue;
+
+        default:
+            return SFFalse;
+    }
+}
+
+static void _SFPutASCIIRecord(SFCodepointRecordRef record, SFCodepoint codepoint, SFUInteger index,
+    const _SFDecodeOptions *options)
+{
+    record->codepoint = codepoint;
+    record->index = (SFUInt32)index;
+    record->joiningType = (options->joining ? SFJoiningTypeU : SFJoiningTypeNil);
+    record->isMirrored = (options->mirrors && _SFIsMirroredASCII(codepoint));
+}
+
+static void _SFPutCodepointRecord(SFCodepointRecordRef record, SFCodepoint codepoint, SFUInteger index,
+    const _SFDecodeOptions *options)
+{
+    record->codepoint = codepoint;
+    record->index = (SFUInt32)index;
+    record->joiningType = (options->joining ? options->joining(codepoint) : SFJoiningTypeNil);
+    record->isMirrored = (options->mirrors && SBCodepointGetMirror(codepoint) != 0);
+}
+
+static SFUInteger _SFDecodeUTF8(const SBCodepointSequence *sequence, const _SFDecodeOptions *options, SFCodepointRecord *records)
+{
+    const SFUInt8 *units = sequence->stringBuffer;
+    SFUInteger length = sequence->stringLength;
+    SFUInteger recordCount = 0;
+    SFUInteger index = 0;
+
+    while (index < length) {
+        SFUInt32 word;
+
+        /* Take four ASCII bytes at once, as long as none of them has the high bit set. */
+        if (length - index >= 4) {
+            memcpy(&word, &units[index], sizeof(word));
+
+            if (!(word & 0x80808080UL)) {
+                _SFPutASCIIRecord(&records[recordCount++], units[index], index, options);
+                _SFPutASCIIRecord(&records[recordCount++], units[index + 1], index + 1, options);
+                _SFPutASCIIRecord(&records[recordCount++], units[index + 2], index + 2, options);
+                _SFPutASCIIRecord(&records[recordCount++], units[index + 3], index + 3, options);
+                index += 4;
+                continue;
+            }
+        }
+
+        if (units[index] < 0x80) {
+            _SFPutASCIIRecord(&records[recordCount++], units[index], index, options);
+            index += 1;
+        } else {
+            SFUInteger start = index;
+            SFCodepoint codepoint = SBCodepointSequenceGetCodepointAt(sequence, &index);
+
+            /* The sequence ends wherever it cannot be read any further. */
+            if (codepoint == SFCodepointInvalid) {
+                break;
+            }
+
+            _SFPutCodepointRecord(&records[recordCount++], codepoint, start, options);
+        }
+    }
+
+    return recordCount;
+}
+
+static SFUInteger _SFDecodeWideUnits(const SBCodepointSequence *sequence, const _SFDecodeOptions *options, SFCodepointRecord *records)
+{
+    SFBoolean isUTF16 = (sequence->stringEncoding == SBStringEncodingUTF16);
+    SFUInteger length = sequence->stringLength;
+    SFUInteger recordCount = 0;
+    SFUInteger index = 0;
+
+    while (index < length) {
+        SFUInt32 unit = (isUTF16
+                         ? ((const SFUInt16 *)sequence->stringBuffer)[index]
+                         : ((const SFUInt32 *)sequence->stringBuffer)[index]);
+
+        /* A unit below the surrogates is always a code point of its own. */
+        if (unit < 0x80) {
+            _SFPutASCIIRecord(&records[recordCount++], unit, index, options);
+            index += 1;
+        } else if (unit < 0xD800) {
+            _SFPutCodepointRecord(&records[recordCount++], unit, index, options);
+            index += 1;
+        } else {
+            SFUInteger start = index;
+            SFCodepoint codepoint = SBCodepointSequenceGetCodepointAt(sequence, &index);
+
+            /* The sequence ends wherever it cannot be read any further. */
+            if (codepoint == SFCodepointInvalid) {
+                break;
+            }
+
+            _SFPutCodepointRecord(&records[recordCount++], codepoint, start, options);
+        }
+    }
+
+    return recordCount;
+}
+
+SF_INTERNAL SFUInteger SFCodepointsDecode(const SBCodepointSequence *sequence, SFBoolean mirrors,
+    SFCodepointsJoiningFunc joining, SFCodepointRecord *records)
+{
+    _SFDecodeOptions options;
+    options.mirrors = mirrors;
+    options.joining = joining;
+
+    switch (sequence->stringEncoding) {
+        case SBStringEncodingUTF16:
+        case SBStringEncodingUTF32:
+            return _SFDecodeWideUnits(sequence, &options, records);
+
+        default:
+            return _SFDecodeUTF8(sequence, &options, records);
+    }
+}
+
 SF_INTERNAL void SFCodepointsInitialize(SFCodepointsRef codepoints, const SBCodepointSequence *referral, SFBoolean backward)
 {
     codepoints->_referral = referral;
+    codepoints->_records = NULL;
+    codepoints->_record = NULL;
+    codepoints->_recordCount = 0;
     codepoints->_token = SFInvalidIndex;
     codepoints->index = SFInvalidIndex;
     codepoints->backward = backward;
 }
 
+SF_INTERNAL void SFCodepointsSetRecords(SFCodepointsRef codepoints, const SFCodepointRecord *records, SFUInteger recordCount)
+{
+    codepoints->_records = records;
+    codepoints->_recordCount = recordCount;
+}
+
 SF_INTERNAL void SFCodepointsReset(SFCodepointsRef codepoints)
 {
-    codepoints->_token = (!codepoints->backward ? 0 : codepoints->_referral->stringLength);
+    SFUInteger limit = (codepoints->_records ? codepoints->_recordCount : codepoints->_referral->stringLength);
+
+    codepoints->_token = (!codepoints->backward ? 0 : limit);
+    codepoints->_record = NULL;
+}
+
+static SFCodepoint _SFCodepointsNextRecord(SFCodepointsRef codepoints)
+{
+    const SFCodepointRecord *record = NULL;
+
+    if (!codepoints->backward) {
+        if (codepoints->_token < codepoints->_recordCount) {
+            record = &codepoints->_records[codepoints->_token++];
+        }
+    } else {
+        if (codepoints->_token > 0) {
+            record = &codepoints->_records[--codepoints->_token];
+        }
+    }
+
+    codepoints->_record = record;
+
+    if (record) {
+        codepoints->index = record->index;
+        return record->codepoint;
+    }
+
+    return SFCodepointInvalid;
 }
 
 SF_INTERNAL SFCodepoint SFCodepointsNext(SFCodepointsRef codepoints)
 {
     SFCodepoint current;
 
+    if (codepoints->_records) {
+        return _SFCodepointsNextRecord(codepoints);
+    }
+
     if (!codepoints->backward) {
         codepoints->index = codepoints->_token;
         current = SBCodepointSequenceGetCodepointAt(codepoints->_referral, &codepoints->_token);
@@ -54,3 +234,14 @@ SF_INTERNAL SFCodepoint SFCodepointsNext(SFCodepointsRef codepoints)
 
     return current;
 }
+
+SF_INTERNAL const SFCodepointRecord *SFCodepointsGetRecords(SFCodepointsRef codepoints, SFUInteger *outCount)
+{
+    *outCount = codepoints->_recordCount;
+    return codepoints->_records;
+}
+
+SF_INTERNAL const SFCodepointRecord *SFCodepointsGetRecord(SFCodepointsRef codepoints)
+{
+    return codepoints->_record;
+}
@@ -21,9 +21,29 @@
 #include <SFConfig.h>
 
 #include "SFBase.h"
+#include "SFJoiningType.h"
+
+/**
+ * Keeps a decoded code point along with its properties, so that a string shaped many times is
+ * decoded and classified only once.
+ */
+typedef struct _SFCodepointRecord {
+    SFCodepoint codepoint;              /**< The decoded code point. */
+    SFUInt32 index;                     /**< Index of the first code unit of the code point. */
+    SFJoiningType joiningType;          /**< Resolved joining type, or nil if not yet resolved. */
+    SFBoolean isMirrored;               /**< Whether the code point has a mirror to be looked up. */
+} SFCodepointRecord, *SFCodepointRecordRef;
+
+/**
+ * The function resolving the joining type of a code point while it is decoded.
+ */
+typedef SFJoiningType (*SFCodepointsJoiningFunc)(SFCodepoint codepoint);
 
 typedef struct _SFCodepoints {
     const SBCodepointSequence *_referral;
+    const SFCodepointRecord *_records;
+    const SFCodepointRecord *_record;
+    SFUInteger _recordCount;
     SFUInteger _token;
     SFUInteger index;
     SFBoolean backward;
@@ -31,8 +51,44 @@ typedef struct _SFCodepoints {
 
 SF_INTERNAL SFCodepoint SFCodepointsGetMirror(SFCodepoint codepoint);
 
+/**
+ * Decodes a sequence into records in a single pass, reading runs of ASCII directly. The properties
+ * of ASCII code points are known up front, so they are filled in without any lookup.
+ *
+ * @param mirrors
+ *      Whether the code points having a mirror should be marked.
+ * @param joining
+ *      The function resolving the joining type of each non-ASCII code point, or NULL to leave the
+ *      joining types unresolved. ASCII code points are always non-joining.
+ * @param records
+ *      The array receiving the records, with room for as many records as the code units of the
+ *      sequence.
+ * @return
+ *      The number of decoded code points.
+ */
+SF_INTERNAL SFUInteger SFCodepointsDecode(const SBCodepointSequence *sequence, SFBoolean mirrors,
+    SFCodepointsJoiningFunc joining, SFCodepointRecord *records);
+
 SF_INTERNAL void SFCodepointsInitialize(SFCodepointsRef codepoints, const SBCodepointSequence *referral, SFBoolean backward);
+
+/**
+ * Makes the code points to be read from the given records, decoded from the same sequence.
+ */
+SF_INTERNAL void SFCodepointsSetRecords(SFCodepointsRef codepoints, const SFCodepointRecord *records, SFUInteger recordCount);
+
 SF_INTERNAL void SFCodepointsReset(SFCodepointsRef codepoints);
 SF_INTERNAL SFCodepoint SFCodepointsNext(SFCodepointsRef codepoints);
 
+/**
+ * Returns the records from which the code points are read, or NULL if they are read from the
+ * sequence directly.
+ */
+SF_INTERNAL const SFCodepointRecord *SFCodepointsGetRecords(SFCodepointsRef codepoints, SFUInteger *outCount);
+
+/**
+ * Returns the record of the code point last returned by SFCodepointsNext, or NULL if the code points
+ * are not read from records.
+ */
+SF_INTERNAL const SFCodepointRecord *SFCodepointsGetRecord(SFCodepointsRef codepoints);
+
 #endif
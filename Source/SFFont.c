@@ -17,23 +17,48 @@
 #include <SFConfig.h>
 
 #include <stddef.h>
-#include <stdlib.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFData.h"
 #include "SFFont.h"
 
+/**
+ * Calculates the checksum of a table in the same way as an open type table directory does.
+ */
+static SFUInt32 _SFFontCalculateChecksum(const SFUInt8 *data, SFUInteger length)
+{
+    SFUInt32 checksum = 0;
+    SFUInteger index;
+
+    for (index = 0; index + 4 <= length; index += 4) {
+        checksum += SFData_UInt32(data, index);
+    }
+
+    /* Pad the last partial word with zeros. */
+    for (; index < length; index++) {
+        checksum += (SFUInt32)data[index] << ((3 - (index & 3)) * 8);
+    }
+
+    return checksum;
+}
+
 static SFUInt8 *_SFFontCopyTable(SFFontRef font, SFTag tag) {
     SFUInt8 *data = NULL;
     SFUInteger length = 0;
+    SFUInt32 checksum = 0;
 
     SFFontLoadTable(font, tag, NULL, &length);
 
     if (length) {
-        data = malloc(length);
+        data = SFAllocatorAllocate(length);
         SFFontLoadTable(font, tag, data, NULL);
+
+        checksum = _SFFontCalculateChecksum(data, length);
     }
 
+    font->tables.checksum = SFHashBytes(font->tables.checksum, &checksum, sizeof(checksum));
+
     return data;
 }
 
@@ -41,10 +66,11 @@ SFFontRef SFFontCreateWithProtocol(const SFFontProtocol *protocol, void *object)
 {
     /* Verify that required functions exist in protocol. */
     if (protocol && protocol->loadTable && protocol->getGlyphIDForCodepoint) {
-        SFFontRef font = malloc(sizeof(SFFont));
+        SFFontRef font = SFAllocatorAllocate(sizeof(SFFont));
         font->_protocol = *protocol;
         font->_object = object;
         font->_retainCount = 1;
+        font->tables.checksum = SFHashSeed;
 
         /* Load open type tables. */
         font->tables.gdef = _SFFontCopyTable(font, SFTagMake('G', 'D', 'E', 'F'));
@@ -91,9 +117,9 @@ void SFFontRelease(SFFontRef font)
         if (font->_protocol.finalize) {
             font->_protocol.finalize(font->_object);
         }
-        free((void *)font->tables.gdef);
-        free((void *)font->tables.gsub);
-        free((void *)font->tables.gpos);
-        free(font);
+        SFAllocatorDeallocate((void *)font->tables.gdef);
+        SFAllocatorDeallocate((void *)font->tables.gsub);
+        SFAllocatorDeallocate((void *)font->tables.gpos);
+        SFAllocatorDeallocate(font);
     }
 }
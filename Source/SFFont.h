@@ -27,6 +27,7 @@ typedef struct _SFFontTables {
     SFData gdef;
     SFData gsub;
     SFData gpos;
+    SFUInt32 checksum;  /**< Combined checksum of the loaded tables. */
 } SFFontTables;
 
 typedef struct _SFFont {
@@ -17,6 +17,7 @@
 #include <SFConfig.h>
 
 #include "SFAlbum.h"
+#include "SFAssert.h"
 #include "SFBase.h"
 #include "SFCodepoints.h"
 #include "SFFont.h"
@@ -59,6 +60,23 @@ SF_PRIVATE SFGlyphTraits _SFGetGlyphTraits(SFTextProcessorRef processor, SFGlyph
     return SFGlyphTraitNone;
 }
 
+static void _SFDiscoverInputGlyphs(SFTextProcessorRef processor)
+{
+    SFAlbumRef album = processor->_album;
+    SFGlyphInputRef glyphInput = album->glyphInput;
+    SFUInteger index;
+
+    for (index = 0; index < glyphInput->glyphCount; index++) {
+        SFGlyphID glyph = glyphInput->glyphIDs[index];
+        SFUInteger cluster = (glyphInput->clusters ? glyphInput->clusters[index] : index);
+
+        /* The cluster must refer to a valid code unit. */
+        SFAssert(cluster < album->codeunitCount);
+
+        SFAlbumAddGlyph(album, glyph, _SFGetGlyphTraits(processor, glyph), cluster);
+    }
+}
+
 SF_INTERNAL void _SFDiscoverGlyphs(SFTextProcessorRef processor)
 {
     SFPatternRef pattern = processor->_pattern;
@@ -67,6 +85,12 @@ SF_INTERNAL void _SFDiscoverGlyphs(SFTextProcessorRef processor)
     SFCodepointsRef codepoints = album->codepoints;
     SFBoolean isRTL = processor->_textDirection == SFTextDirectionRightToLeft;
 
+    /* Glyphs supplied by the client are taken as they are, bypassing the character map. */
+    if (album->glyphInput) {
+        _SFDiscoverInputGlyphs(processor);
+        return;
+    }
+
     SFCodepointsReset(album->codepoints);
 
     switch (processor->_textMode) {
@@ -79,7 +103,8 @@ SF_INTERNAL void _SFDiscoverGlyphs(SFTextProcessorRef processor)
                 SFGlyphTraits traits;
 
                 if (isRTL) {
-                    SFCodepoint mirror = SFCodepointsGetMirror(current);
+                    const SFCodepointRecord *record = SFCodepointsGetRecord(codepoints);
+                    SFCodepoint mirror = (!record || record->isMirrored ? SFCodepointsGetMirror(current) : 0);
 
                     if (mirror) {
                         current = mirror;
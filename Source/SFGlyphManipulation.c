@@ -101,7 +101,8 @@ static SFBoolean _SFAssessGlyphByCoverage(_SFGlyphAgent *glyphAgent)
 }
 
 static SFBoolean _SFAssessBacktrackGlyphs(SFTextProcessorRef textProcessor,
-    SFData valueArray, SFUInteger valueCount, _SFGlyphAssessment glyphAssessment, void *helperPtr)
+    SFData valueArray, SFUInteger valueCount, _SFGlyphAssessment glyphAssessment, void *helperPtr,
+    SFUInteger *contextFirst)
 {
     SFAlbumRef album = textProcessor->_album;
     SFLocatorRef locator = &textProcessor->_locator;
@@ -127,6 +128,7 @@ static SFBoolean _SFAssessBacktrackGlyphs(SFTextProcessorRef textProcessor,
         }
     }
 
+    *contextFirst = backIndex;
     return SFTrue;
 }
 
@@ -177,7 +179,7 @@ static SFBoolean _SFAssessInputGlyphs(SFTextProcessorRef textProcessor,
 
 static SFBoolean _SFAssessLookaheadGlyphs(SFTextProcessorRef textProcessor,
     SFData valueArray, SFUInteger valueCount,
-    _SFGlyphAssessment glyphAssessment, void *helperPtr, SFUInteger contextEnd)
+    _SFGlyphAssessment glyphAssessment, void *helperPtr, SFUInteger contextEnd, SFUInteger *contextLast)
 {
     SFAlbumRef album = textProcessor->_album;
     SFLocatorRef locator = &textProcessor->_locator;
@@ -203,6 +205,7 @@ static SFBoolean _SFAssessLookaheadGlyphs(SFTextProcessorRef textProcessor,
         }
     }
 
+    *contextLast = aheadIndex;
     return SFTrue;
 }
 
@@ -298,8 +301,12 @@ static SFBoolean _SFApplyRuleTable(SFTextProcessorRef textProcessor,
         SFUInteger contextStart = textProcessor->_locator.index;
         SFUInteger contextEnd;
 
-        return (_SFAssessInputGlyphs(textProcessor, valueArray, glyphCount, includeFirst, glyphAsessment, helperPtr, &contextEnd)
-             && _SFApplyContextLookups(textProcessor, lookupArray, lookupCount, contextStart, contextEnd));
+        if (_SFAssessInputGlyphs(textProcessor, valueArray, glyphCount, includeFirst, glyphAsessment, helperPtr, &contextEnd)) {
+            /* Breaking anywhere within the matched glyphs would prevent the rule. */
+            SFAlbumMarkUnsafeToBreak(textProcessor->_album, contextStart, contextEnd);
+
+            return _SFApplyContextLookups(textProcessor, lookupArray, lookupCount, contextStart, contextEnd);
+        }
     }
 
     return SFFalse;
@@ -408,11 +415,17 @@ static SFBoolean _SFApplyChainRuleTable(SFTextProcessorRef textProcessor,
         SFData lookupArray = SFContextRecord_LookupArray(contextRecord);
         SFUInteger contextStart = textProcessor->_locator.index;
         SFUInteger contextEnd;
+        SFUInteger contextFirst;
+        SFUInteger contextLast;
 
-        return (_SFAssessInputGlyphs(textProcessor, inputArray, inputCount, includeFirst, glyphAsessment, helperPtr, &contextEnd)
-             && _SFAssessBacktrackGlyphs(textProcessor, backtrackArray, backtrackCount, glyphAsessment, helperPtr)
-             && _SFAssessLookaheadGlyphs(textProcessor, lookaheadArray, lookaheadCount, glyphAsessment, helperPtr, contextEnd)
-             && _SFApplyContextLookups(textProcessor, lookupArray, lookupCount, contextStart, contextEnd));
+        if (_SFAssessInputGlyphs(textProcessor, inputArray, inputCount, includeFirst, glyphAsessment, helperPtr, &contextEnd)
+         && _SFAssessBacktrackGlyphs(textProcessor, backtrackArray, backtrackCount, glyphAsessment, helperPtr, &contextFirst)
+         && _SFAssessLookaheadGlyphs(textProcessor, lookaheadArray, lookaheadCount, glyphAsessment, helperPtr, contextEnd, &contextLast)) {
+            /* Breaking anywhere within the matched glyphs, including the context, would prevent the rule. */
+            SFAlbumMarkUnsafeToBreak(textProcessor->_album, contextFirst, contextLast);
+
+            return _SFApplyContextLookups(textProcessor, lookupArray, lookupCount, contextStart, contextEnd);
+        }
     }
 
     return SFFalse;
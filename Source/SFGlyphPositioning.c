@@ -66,6 +66,16 @@ static void _SFResolveMarkPositions(SFTextProcessorRef textProcessor, SFLocatorR
 
 SF_PRIVATE SFBoolean _SFApplyPositioningSubtable(SFTextProcessorRef textProcessor, SFLookupType lookupType, SFData subtable)
 {
+    /* Mark attachments never change the advances, so skip them while measuring. */
+    if (textProcessor->_shapingMode == SFShapingModeMeasure) {
+        switch (lookupType) {
+            case SFLookupTypeMarkToBaseAttachment:
+            case SFLookupTypeMarkToLigatureAttachment:
+            case SFLookupTypeMarkToMarkAttachment:
+                return SFFalse;
+        }
+    }
+
     switch (lookupType) {
         case SFLookupTypeSingleAdjustment:
             return _SFApplySinglePos(textProcessor, subtable);
@@ -228,6 +238,11 @@ static SFBoolean _SFApplyPairPos(SFTextProcessorRef textProcessor, SFData pairPo
         }
     }
 
+    if (didPosition) {
+        /* Breaking between the pair would lose its adjustment. */
+        SFAlbumMarkUnsafeToBreak(textProcessor->_album, firstIndex, secondIndex);
+    }
+
     if (shouldSkip) {
         SFLocatorJumpTo(locator, secondIndex);
     }
@@ -521,6 +536,9 @@ static SFBoolean _SFApplyCursiveAnchors(SFTextProcessorRef textProcessor,
     SFAlbumSetCursiveOffset(album, secondIndex, 0);
     SFAlbumInsertHelperTraits(album, secondIndex, traits);
 
+    /* Breaking between the glyphs would disconnect them. */
+    SFAlbumMarkUnsafeToBreak(album, firstIndex, secondIndex);
+
     return SFTrue;
 }
 
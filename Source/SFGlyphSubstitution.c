@@ -301,7 +301,7 @@ static SFBoolean _SFApplyLigatureSetTable(SFTextProcessorRef textProcessor, SFDa
     for (ligIndex = 0; ligIndex < ligCount; ligIndex++) {
         SFData ligature = SFLigatureSet_LigatureTable(ligatureSet, ligIndex);
         SFUInt16 compCount = SFLigature_CompCount(ligature);
-        SFUInteger *partIndexes;
+        SFUInt32 *partIndexes;
         SFUInteger prevIndex;
         SFUInteger nextIndex;
         SFUInteger compIndex;
@@ -330,7 +330,7 @@ static SFBoolean _SFApplyLigatureSetTable(SFTextProcessorRef textProcessor, SFDa
                 break;
             }
 
-            partIndexes[compIndex] = nextIndex;
+            partIndexes[compIndex] = (SFUInt32)nextIndex;
             prevIndex = nextIndex;
         }
 
@@ -340,6 +340,9 @@ static SFBoolean _SFApplyLigatureSetTable(SFTextProcessorRef textProcessor, SFDa
             SFGlyphTraits ligTraits = _SFGetGlyphTraits(textProcessor, ligGlyph);
             SFUInteger ligAssociation;
 
+            /* Breaking anywhere within the components would prevent the ligature. */
+            SFAlbumMarkUnsafeToBreak(album, locator->index, prevIndex);
+
             /* Substitute the ligature glyph and set its traits. */
             SFAlbumSetGlyph(album, locator->index, ligGlyph);
             SFAlbumReplaceBasicTraits(album, locator->index, ligTraits);
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "SFAllocator.h"
 #include "SFAssert.h"
 #include "SFBase.h"
 #include "SFList.h"
@@ -39,15 +40,36 @@ SF_PRIVATE void _SFListInitialize(_SFListRef list, SFUInteger itemSize)
     list->count = 0;
     list->capacity = 0;
     list->_itemSize = itemSize;
+    list->_inlineData = NULL;
+    list->_inlineCapacity = 0;
+}
+
+SF_PRIVATE void _SFListInitializeInline(_SFListRef list, SFUInteger itemSize, void *buffer, SFUInteger capacity)
+{
+    /* Item size MUST be greater than 0 and the buffer MUST be valid. */
+    SFAssert(itemSize > 0 && buffer != NULL);
+
+    list->_data = buffer;
+    list->count = 0;
+    list->capacity = capacity;
+    list->_itemSize = itemSize;
+    list->_inlineData = buffer;
+    list->_inlineCapacity = capacity;
 }
 
 SF_PRIVATE void _SFListFinalize(_SFListRef list)
 {
-    free(list->_data);
+    /* The inline buffer is owned by the caller. */
+    if (list->_data != list->_inlineData) {
+        SFAllocatorDeallocate(list->_data);
+    }
 }
 
 SF_PRIVATE void _SFListFinalizeKeepingArray(_SFListRef list, void **outArray, SFUInteger *outCount)
 {
+    /* The array of a list backed by an inline buffer can not be handed over. */
+    SFAssert(list->_inlineData == NULL);
+
     if (list->count > 0) {
         _SFListSetCapacity(list, list->count);
 
@@ -67,8 +89,28 @@ SF_PRIVATE void _SFListSetCapacity(_SFListRef list, SFUInteger capacity)
     SFAssert(capacity >= list->count);
 
     if (capacity != list->capacity) {
-        list->_data = realloc(list->_data, list->_itemSize * capacity);
-        list->capacity = capacity;
+        SFUInt8 *inlineData = list->_inlineData;
+
+        if (inlineData && capacity <= list->_inlineCapacity) {
+            /* Return to the inline buffer as it is large enough. */
+            if (list->_data != inlineData) {
+                memcpy(inlineData, list->_data, list->_itemSize * list->count);
+                SFAllocatorDeallocate(list->_data);
+
+                list->_data = inlineData;
+            }
+
+            list->capacity = list->_inlineCapacity;
+        } else if (inlineData && list->_data == inlineData) {
+            /* Move out of the inline buffer as it can not be resized. */
+            list->_data = SFAllocatorAllocate(list->_itemSize * capacity);
+            memcpy(list->_data, inlineData, list->_itemSize * list->count);
+
+            list->capacity = capacity;
+        } else {
+            list->_data = SFAllocatorReallocate(list->_data, list->_itemSize * capacity);
+            list->capacity = capacity;
+        }
     }
 }
 
@@ -123,6 +165,14 @@ SF_PRIVATE void _SFListRemoveRange(_SFListRef list, SFUInteger index, SFUInteger
     list->count -= count;
 }
 
+SF_PRIVATE void _SFListMoveRange(_SFListRef list, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger count)
+{
+    /* The source and destination ranges must be valid. */
+    SFAssert((srcIndex + count) <= list->count && (dstIndex + count) <= list->count);
+
+    _SFListMoveItems(list, srcIndex, dstIndex, count);
+}
+
 SF_PRIVATE void _SFListClear(_SFListRef list)
 {
     list->count = 0;
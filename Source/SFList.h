@@ -27,6 +27,8 @@ typedef struct _SFList {
     SFUInteger count;
     SFUInteger capacity;
     SFUInteger _itemSize;
+    SFUInt8 *_inlineData;
+    SFUInteger _inlineCapacity;
 } _SFList, *_SFListRef;
 
 #define SF_LIST(type)       \
@@ -35,17 +37,21 @@ struct {                    \
     SFUInteger count;       \
     SFUInteger capacity;    \
     SFUInteger _itemSize;   \
+    SFUInt8 *_inlineData;   \
+    SFUInteger _inlineCapacity; \
 }
 
 typedef int (*SFComparison)(const void *item1, const void *item2);
 
 SF_PRIVATE void _SFListInitialize(_SFListRef list, SFUInteger itemSize);
+SF_PRIVATE void _SFListInitializeInline(_SFListRef list, SFUInteger itemSize, void *buffer, SFUInteger capacity);
 SF_PRIVATE void _SFListFinalize(_SFListRef list);
 SF_PRIVATE void _SFListFinalizeKeepingArray(_SFListRef list, void **outArray, SFUInteger *outCount);
 
 SF_PRIVATE void _SFListSetCapacity(_SFListRef list, SFUInteger capacity);
 SF_PRIVATE void _SFListReserveRange(_SFListRef list, SFUInteger index, SFUInteger count);
 SF_PRIVATE void _SFListRemoveRange(_SFListRef list, SFUInteger index, SFUInteger count);
+SF_PRIVATE void _SFListMoveRange(_SFListRef list, SFUInteger srcIndex, SFUInteger dstIndex, SFUInteger count);
 
 SF_PRIVATE void _SFListClear(_SFListRef list);
 SF_PRIVATE void _SFListTrimExcess(_SFListRef list);
@@ -88,6 +94,8 @@ do {                                                    \
 
 
 #define SFListInitialize(list, itemSize)            _SFListInitialize((_SFListRef)(list), itemSize)
+#define SFListInitializeInline(list, itemSize, buffer, capacity) \
+                                    _SFListInitializeInline((_SFListRef)(list), itemSize, buffer, capacity)
 #define SFListFinalize(list)                        _SFListFinalize((_SFListRef)(list))
 #define SFListFinalizeKeepingArray(list, outArray, outCount) \
                                     _SFListFinalizeKeepingArray((_SFListRef)(list), (void **)outArray, outCount)
@@ -95,6 +103,8 @@ do {                                                    \
 #define SFListSetCapacity(list, capacity)           _SFListSetCapacity((_SFListRef)(list), capacity)
 #define SFListReserveRange(list, index, count)      _SFListReserveRange((_SFListRef)(list), index, count)
 #define SFListRemoveRange(list, index, count)       _SFListRemoveRange((_SFListRef)(list), index, count)
+#define SFListMoveRange(list, srcIndex, dstIndex, count) \
+                                    _SFListMoveRange((_SFListRef)(list), srcIndex, dstIndex, count)
 
 #define SFListClear(list)                           _SFListClear((_SFListRef)(list))
 #define SFListTrimExcess(list)                      _SFListTrimExcess((_SFListRef)(list))
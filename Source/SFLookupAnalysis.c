@@ -0,0 +1,695 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+
+#include "SFBase.h"
+#include "SFCommon.h"
+#include "SFData.h"
+#include "SFGPOS.h"
+#include "SFGSUB.h"
+#include "SFOpenType.h"
+#include "SFPattern.h"
+#include "SFLookupAnalysis.h"
+
+static SFBoolean _SFCoverageInvolvesGlyph(SFData parent, SFOffset coverageOffset, SFGlyphID glyphID)
+{
+    SFData coverage = SFData_Subdata(parent, coverageOffset);
+
+    return (SFOpenTypeSearchCoverageIndex(coverage, glyphID) != SFInvalidIndex);
+}
+
+static SFUInt16 _SFGetGlyphClass(SFData parent, SFOffset classDefOffset, SFGlyphID glyphID)
+{
+    SFData classDef = SFData_Subdata(parent, classDefOffset);
+
+    return SFOpenTypeSearchGlyphClass(classDef, glyphID);
+}
+
+static SFBoolean _SFGlyphArrayInvolvesGlyph(SFData glyphArray, SFUInteger glyphCount, SFGlyphID glyphID)
+{
+    SFUInteger index;
+
+    for (index = 0; index < glyphCount; index++) {
+        if (SFUInt16Array_Value(glyphArray, index) == glyphID) {
+            return SFTrue;
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFCoverageArrayInvolvesGlyph(SFData parent, SFData offsetArray, SFUInteger coverageCount, SFGlyphID glyphID)
+{
+    SFUInteger index;
+
+    for (index = 0; index < coverageCount; index++) {
+        SFOffset coverageOffset = SFUInt16Array_Value(offsetArray, index);
+
+        if (_SFCoverageInvolvesGlyph(parent, coverageOffset, glyphID)) {
+            return SFTrue;
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFRuleSetInvolvesGlyph(SFData ruleSet, SFGlyphID glyphID)
+{
+    SFUInt16 ruleCount = SFRuleSet_RuleCount(ruleSet);
+    SFUInteger ruleIndex;
+
+    for (ruleIndex = 0; ruleIndex < ruleCount; ruleIndex++) {
+        SFOffset ruleOffset = SFRuleSet_RuleOffset(ruleSet, ruleIndex);
+
+        if (ruleOffset) {
+            SFData rule = SFData_Subdata(ruleSet, ruleOffset);
+            SFUInt16 glyphCount = SFRule_GlyphCount(rule);
+
+            /* The first glyph of the rule is matched by the coverage of the subtable. */
+            if (glyphCount > 0
+                && _SFGlyphArrayInvolvesGlyph(SFRule_ValueArray(rule), glyphCount - 1, glyphID)) {
+                return SFTrue;
+            }
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFChainRuleSetInvolvesGlyph(SFData chainRuleSet, SFGlyphID glyphID)
+{
+    SFUInt16 ruleCount = SFChainRuleSet_ChainRuleCount(chainRuleSet);
+    SFUInteger ruleIndex;
+
+    for (ruleIndex = 0; ruleIndex < ruleCount; ruleIndex++) {
+        SFData chainRule = SFChainRuleSet_ChainRuleTable(chainRuleSet, ruleIndex);
+        SFData backtrackRecord = SFChainRule_BacktrackRecord(chainRule);
+        SFUInt16 backtrackCount = SFBacktrackRecord_GlyphCount(backtrackRecord);
+        SFData inputRecord = SFBacktrackRecord_InputRecord(backtrackRecord, backtrackCount);
+        SFUInt16 inputCount = SFInputRecord_GlyphCount(inputRecord);
+
+        if (inputCount > 0) {
+            SFData lookaheadRecord = SFInputRecord_LookaheadRecord(inputRecord, inputCount - 1);
+            SFUInt16 lookaheadCount = SFLookaheadRecord_GlyphCount(lookaheadRecord);
+
+            /* The first input glyph is matched by the coverage of the subtable. */
+            if (_SFGlyphArrayInvolvesGlyph(SFBacktrackRecord_ValueArray(backtrackRecord), backtrackCount, glyphID)
+                || _SFGlyphArrayInvolvesGlyph(SFInputRecord_ValueArray(inputRecord), inputCount - 1, glyphID)
+                || _SFGlyphArrayInvolvesGlyph(SFLookaheadRecord_ValueArray(lookaheadRecord), lookaheadCount, glyphID)) {
+                return SFTrue;
+            }
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFContextInvolvesGlyph(SFData context, SFGlyphID glyphID)
+{
+    SFUInt16 tblFormat = SFContext_Format(context);
+
+    switch (tblFormat) {
+        case 1: {
+            SFUInt16 ruleSetCount = SFContextF1_RuleSetCount(context);
+            SFUInteger setIndex;
+
+            if (_SFCoverageInvolvesGlyph(context, SFContextF1_CoverageOffset(context), glyphID)) {
+                return SFTrue;
+            }
+
+            for (setIndex = 0; setIndex < ruleSetCount; setIndex++) {
+                SFData ruleSet = SFContextF1_RuleSetTable(context, setIndex);
+
+                if (_SFRuleSetInvolvesGlyph(ruleSet, glyphID)) {
+                    return SFTrue;
+                }
+            }
+            break;
+        }
+
+        case 2: {
+            SFUInt16 ruleSetCount = SFContextF2_RuleSetCount(context);
+            SFUInteger setIndex;
+
+            if (_SFCoverageInvolvesGlyph(context, SFContextF2_CoverageOffset(context), glyphID)
+                || _SFGetGlyphClass(context, SFContextF2_ClassDefOffset(context), glyphID) != 0) {
+                return SFTrue;
+            }
+
+            /* Class zero holds all unlisted glyphs, so it counts once a rule refers to it. */
+            for (setIndex = 0; setIndex < ruleSetCount; setIndex++) {
+                SFOffset ruleSetOffset = SFContextF2_RuleSetOffset(context, setIndex);
+
+                if (ruleSetOffset) {
+                    SFData ruleSet = SFData_Subdata(context, ruleSetOffset);
+
+                    if (_SFRuleSetInvolvesGlyph(ruleSet, 0)) {
+                        return SFTrue;
+                    }
+                }
+            }
+            break;
+        }
+
+        case 3: {
+            SFData rule = SFContextF3_Rule(context);
+
+            return _SFCoverageArrayInvolvesGlyph(context, SFRule_ValueArray(rule), SFRule_GlyphCount(rule), glyphID);
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFChainContextInvolvesGlyph(SFData chainContext, SFGlyphID glyphID)
+{
+    SFUInt16 tblFormat = SFChainContext_Format(chainContext);
+
+    switch (tblFormat) {
+        case 1: {
+            SFUInt16 ruleSetCount = SFChainContextF1_ChainRuleSetCount(chainContext);
+            SFUInteger setIndex;
+
+            if (_SFCoverageInvolvesGlyph(chainContext, SFChainContextF1_CoverageOffset(chainContext), glyphID)) {
+                return SFTrue;
+            }
+
+            for (setIndex = 0; setIndex < ruleSetCount; setIndex++) {
+                SFData chainRuleSet = SFChainContextF1_ChainRuleSetTable(chainContext, setIndex);
+
+                if (_SFChainRuleSetInvolvesGlyph(chainRuleSet, glyphID)) {
+                    return SFTrue;
+                }
+            }
+            break;
+        }
+
+        case 2: {
+            SFUInt16 ruleSetCount = SFChainContextF2_ChainRuleSetCount(chainContext);
+            SFUInteger setIndex;
+
+            if (_SFCoverageInvolvesGlyph(chainContext, SFChainContextF2_CoverageOffset(chainContext), glyphID)
+                || _SFGetGlyphClass(chainContext, SFChainContextF2_BacktrackClassDefOffset(chainContext), glyphID) != 0
+                || _SFGetGlyphClass(chainContext, SFChainContextF2_InputClassDefOffset(chainContext), glyphID) != 0
+                || _SFGetGlyphClass(chainContext, SFChainContextF2_LookaheadClassDefOffset(chainContext), glyphID) != 0) {
+                return SFTrue;
+            }
+
+            /* The glyph is unlisted in all class definitions, so look for any rule referring to class zero. */
+            for (setIndex = 0; setIndex < ruleSetCount; setIndex++) {
+                SFOffset ruleSetOffset = SFChainContextF2_ChainRuleSetOffset(chainContext, setIndex);
+
+                if (ruleSetOffset) {
+                    SFData chainRuleSet = SFData_Subdata(chainContext, ruleSetOffset);
+
+                    if (_SFChainRuleSetInvolvesGlyph(chainRuleSet, 0)) {
+                        return SFTrue;
+                    }
+                }
+            }
+            break;
+        }
+
+        case 3: {
+            SFData backtrackRecord = SFChainContextF3_ChainRuleTable(chainContext);
+            SFUInt16 backtrackCount = SFBacktrackRecord_GlyphCount(backtrackRecord);
+            SFData inputRecord = SFBacktrackRecord_InputRecord(backtrackRecord, backtrackCount);
+            SFUInt16 inputCount = SFInputRecord_GlyphCount(inputRecord);
+            SFData lookaheadRecord = SFInputRecord_LookaheadRecord(inputRecord, inputCount);
+            SFUInt16 lookaheadCount = SFLookaheadRecord_GlyphCount(lookaheadRecord);
+
+            return (_SFCoverageArrayInvolvesGlyph(chainContext, SFBacktrackRecord_ValueArray(backtrackRecord), backtrackCount, glyphID)
+                 || _SFCoverageArrayInvolvesGlyph(chainContext, SFInputRecord_ValueArray(inputRecord), inputCount, glyphID)
+                 || _SFCoverageArrayInvolvesGlyph(chainContext, SFLookaheadRecord_ValueArray(lookaheadRecord), lookaheadCount, glyphID));
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFLigatureSubstInvolvesGlyph(SFData ligSubst, SFGlyphID glyphID)
+{
+    SFUInt16 ligSetCount = SFLigatureSubstF1_LigSetCount(ligSubst);
+    SFUInteger setIndex;
+
+    if (_SFCoverageInvolvesGlyph(ligSubst, SFLigatureSubstF1_CoverageOffset(ligSubst), glyphID)) {
+        return SFTrue;
+    }
+
+    for (setIndex = 0; setIndex < ligSetCount; setIndex++) {
+        SFData ligatureSet = SFLigatureSubstF1_LigatureSetTable(ligSubst, setIndex);
+        SFUInt16 ligCount = SFLigatureSet_LigatureCount(ligatureSet);
+        SFUInteger ligIndex;
+
+        for (ligIndex = 0; ligIndex < ligCount; ligIndex++) {
+            SFData ligature = SFLigatureSet_LigatureTable(ligatureSet, ligIndex);
+            SFUInt16 compCount = SFLigature_CompCount(ligature);
+            SFUInteger compIndex;
+
+            /* The first component is matched by the coverage of the subtable. */
+            for (compIndex = 1; compIndex < compCount; compIndex++) {
+                if (SFLigature_Component(ligature, compIndex - 1) == glyphID) {
+                    return SFTrue;
+                }
+            }
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFPairClassesAdjustSecondClass(SFData pairPos, SFUInt16 class2Value)
+{
+    SFUInt16 class1Count = SFPairPosF2_Class1Count(pairPos);
+    SFUInt16 class2Count = SFPairPosF2_Class2Count(pairPos);
+    SFUInteger value1Size = SFValueRecord_Size(SFPairPosF2_ValueFormat1(pairPos));
+    SFUInteger value2Size = SFValueRecord_Size(SFPairPosF2_ValueFormat2(pairPos));
+    SFUInteger class2Size = SFClass2Record_Value(value1Size, value2Size);
+    SFUInteger class1Size = SFClass1Record_Size(class2Count, class2Size);
+    SFUInteger class1Value;
+
+    if (class2Value >= class2Count) {
+        return SFFalse;
+    }
+
+    for (class1Value = 0; class1Value < class1Count; class1Value++) {
+        SFData class1Record = SFPairPosF2_Class1Record(pairPos, class1Value, class1Size);
+        SFData class2Record = SFClass1Record_Class2Record(class1Record, class2Value, class2Size);
+        SFUInteger valueIndex;
+
+        /* Any non-zero value or device offset makes the pair adjust the glyphs. */
+        for (valueIndex = 0; valueIndex < class2Size / 2; valueIndex++) {
+            if (SFUInt16Array_Value(class2Record, valueIndex) != 0) {
+                return SFTrue;
+            }
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFPairPosInvolvesGlyph(SFData pairPos, SFGlyphID glyphID)
+{
+    SFUInt16 tblFormat = SFPairPos_Format(pairPos);
+
+    switch (tblFormat) {
+        case 1: {
+            SFUInt16 valueFormat1 = SFPairPosF1_ValueFormat1(pairPos);
+            SFUInt16 valueFormat2 = SFPairPosF1_ValueFormat2(pairPos);
+            SFUInt16 pairSetCount = SFPairPosF1_PairSetCount(pairPos);
+            SFUInteger recordSize;
+            SFUInteger setIndex;
+
+            if (_SFCoverageInvolvesGlyph(pairPos, SFPairPosF1_CoverageOffset(pairPos), glyphID)) {
+                return SFTrue;
+            }
+
+            recordSize = SFPairValueRecord_Size(SFValueRecord_Size(valueFormat1), SFValueRecord_Size(valueFormat2));
+
+            for (setIndex = 0; setIndex < pairSetCount; setIndex++) {
+                SFData pairSet = SFPairPosF1_PairSetTable(pairPos, setIndex);
+                SFUInt16 pairCount = SFPairSet_PairValueCount(pairSet);
+                SFUInteger pairIndex;
+
+                for (pairIndex = 0; pairIndex < pairCount; pairIndex++) {
+                    SFData pairRecord = SFPairSet_PairValueRecord(pairSet, pairIndex, recordSize);
+
+                    if (SFPairValueRecord_SecondGlyph(pairRecord) == glyphID) {
+                        return SFTrue;
+                    }
+                }
+            }
+            break;
+        }
+
+        case 2: {
+            SFUInt16 class2Value;
+
+            /* The first class is only looked up for the covered glyphs. */
+            if (_SFCoverageInvolvesGlyph(pairPos, SFPairPosF2_CoverageOffset(pairPos), glyphID)) {
+                return SFTrue;
+            }
+
+            /* Class zero holds all unlisted glyphs, so it counts once a pair adjusts it. */
+            class2Value = _SFGetGlyphClass(pairPos, SFPairPosF2_ClassDef2Offset(pairPos), glyphID);
+
+            return (class2Value != 0 || _SFPairClassesAdjustSecondClass(pairPos, 0));
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFSubstitutionSubtableInvolvesGlyph(SFLookupType lookupType, SFData subtable, SFGlyphID glyphID)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingle:
+        case SFLookupTypeMultiple:
+        case SFLookupTypeAlternate:
+            /* All formats keep the coverage at the same offset. */
+            return _SFCoverageInvolvesGlyph(subtable, SFSingleSubstF1_CoverageOffset(subtable), glyphID);
+
+        case SFLookupTypeLigature:
+            return _SFLigatureSubstInvolvesGlyph(subtable, glyphID);
+
+        case SFLookupTypeContext:
+            return _SFContextInvolvesGlyph(subtable, glyphID);
+
+        case SFLookupTypeChainingContext:
+            return _SFChainContextInvolvesGlyph(subtable, glyphID);
+
+        case SFLookupTypeExtension: {
+            SFLookupType innerType = SFExtensionF1_LookupType(subtable);
+
+            /* An extension must not refer to another one, so a malformed table cannot recurse. */
+            if (innerType != SFLookupTypeExtension) {
+                return _SFSubstitutionSubtableInvolvesGlyph(innerType, SFExtensionF1_ExtensionData(subtable), glyphID);
+            }
+            break;
+        }
+
+        case SFLookupTypeReverseChainingContext:
+            /* Reverse chaining substitution is not applied by the text processor. */
+            break;
+    }
+
+    return SFFalse;
+}
+
+static SFBoolean _SFPositioningSubtableInvolvesGlyph(SFLookupType lookupType, SFData subtable, SFGlyphID glyphID)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingleAdjustment:
+            return _SFCoverageInvolvesGlyph(subtable, SFSinglePosF1_CoverageOffset(subtable), glyphID);
+
+        case SFLookupTypePairAdjustment:
+            return _SFPairPosInvolvesGlyph(subtable, glyphID);
+
+        case SFLookupTypeCursiveAttachment:
+            return _SFCoverageInvolvesGlyph(subtable, SFCursivePos_CoverageOffset(subtable), glyphID);
+
+        case SFLookupTypeMarkToBaseAttachment:
+        case SFLookupTypeMarkToLigatureAttachment:
+        case SFLookupTypeMarkToMarkAttachment:
+            /* All attachment subtables keep both coverages at the same offsets. */
+            return (_SFCoverageInvolvesGlyph(subtable, SFMarkBasePos_MarkCoverageOffset(subtable), glyphID)
+                 || _SFCoverageInvolvesGlyph(subtable, SFMarkBasePos_BaseCoverageOffset(subtable), glyphID));
+
+        case SFLookupTypeContextPositioning:
+            return _SFContextInvolvesGlyph(subtable, glyphID);
+
+        case SFLookupTypeChainedContextPositioning:
+            return _SFChainContextInvolvesGlyph(subtable, glyphID);
+
+        case SFLookupTypeExtensionPositioning: {
+            SFLookupType innerType = SFExtensionF1_LookupType(subtable);
+
+            if (innerType != SFLookupTypeExtensionPositioning) {
+                return _SFPositioningSubtableInvolvesGlyph(innerType, SFExtensionF1_ExtensionData(subtable), glyphID);
+            }
+            break;
+        }
+    }
+
+    return SFFalse;
+}
+
+SF_INTERNAL SFBoolean SFLookupInvolvesGlyph(SFData lookupTable, SFFeatureKind featureKind, SFGlyphID glyphID)
+{
+    SFLookupType lookupType = SFLookup_LookupType(lookupTable);
+    SFUInt16 subtableCount = SFLookup_SubtableCount(lookupTable);
+    SFUInteger subtableIndex;
+
+    for (subtableIndex = 0; subtableIndex < subtableCount; subtableIndex++) {
+        SFData subtable = SFLookup_SubtableData(lookupTable, subtableIndex);
+        SFBoolean isInvolved;
+
+        if (featureKind == SFFeatureKindSubstitution) {
+            isInvolved = _SFSubstitutionSubtableInvolvesGlyph(lookupType, subtable, glyphID);
+        } else {
+            isInvolved = _SFPositioningSubtableInvolvesGlyph(lookupType, subtable, glyphID);
+        }
+
+        if (isInvolved) {
+            return SFTrue;
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFUInteger _SFRuleSetGetContextLength(SFData ruleSet)
+{
+    SFUInt16 ruleCount = SFRuleSet_RuleCount(ruleSet);
+    SFUInteger contextLength = 0;
+    SFUInteger ruleIndex;
+
+    for (ruleIndex = 0; ruleIndex < ruleCount; ruleIndex++) {
+        SFOffset ruleOffset = SFRuleSet_RuleOffset(ruleSet, ruleIndex);
+
+        if (ruleOffset) {
+            SFData rule = SFData_Subdata(ruleSet, ruleOffset);
+            SFUInt16 glyphCount = SFRule_GlyphCount(rule);
+
+            if (glyphCount > contextLength) {
+                contextLength = glyphCount;
+            }
+        }
+    }
+
+    return contextLength;
+}
+
+static SFUInteger _SFChainRuleGetContextLength(SFData backtrackRecord, SFBoolean includeFirst)
+{
+    SFUInt16 backtrackCount = SFBacktrackRecord_GlyphCount(backtrackRecord);
+    SFData inputRecord = SFBacktrackRecord_InputRecord(backtrackRecord, backtrackCount);
+    SFUInt16 inputCount = SFInputRecord_GlyphCount(inputRecord);
+    SFData lookaheadRecord;
+    SFUInt16 lookaheadCount;
+
+    /* A rule without input glyphs is never matched. */
+    if (inputCount == 0) {
+        return 0;
+    }
+
+    lookaheadRecord = SFInputRecord_LookaheadRecord(inputRecord, inputCount - !includeFirst);
+    lookaheadCount = SFLookaheadRecord_GlyphCount(lookaheadRecord);
+
+    return (SFUInteger)backtrackCount + inputCount + lookaheadCount;
+}
+
+static SFUInteger _SFChainRuleSetGetContextLength(SFData chainRuleSet)
+{
+    SFUInt16 ruleCount = SFChainRuleSet_ChainRuleCount(chainRuleSet);
+    SFUInteger contextLength = 0;
+    SFUInteger ruleIndex;
+
+    for (ruleIndex = 0; ruleIndex < ruleCount; ruleIndex++) {
+        SFData chainRule = SFChainRuleSet_ChainRuleTable(chainRuleSet, ruleIndex);
+        SFUInteger ruleLength = _SFChainRuleGetContextLength(SFChainRule_BacktrackRecord(chainRule), SFFalse);
+
+        if (ruleLength > contextLength) {
+            contextLength = ruleLength;
+        }
+    }
+
+    return contextLength;
+}
+
+static SFUInteger _SFContextGetContextLength(SFData context)
+{
+    SFUInt16 tblFormat = SFContext_Format(context);
+    SFUInteger contextLength = 0;
+
+    switch (tblFormat) {
+        case 1:
+        case 2: {
+            SFUInt16 ruleSetCount = (tblFormat == 1 ? SFContextF1_RuleSetCount(context) : SFContextF2_RuleSetCount(context));
+            SFUInteger setIndex;
+
+            for (setIndex = 0; setIndex < ruleSetCount; setIndex++) {
+                SFOffset ruleSetOffset = (tblFormat == 1
+                                          ? SFContextF1_RuleSetOffset(context, setIndex)
+                                          : SFContextF2_RuleSetOffset(context, setIndex));
+
+                if (ruleSetOffset) {
+                    SFUInteger setLength = _SFRuleSetGetContextLength(SFData_Subdata(context, ruleSetOffset));
+
+                    if (setLength > contextLength) {
+                        contextLength = setLength;
+                    }
+                }
+            }
+            break;
+        }
+
+        case 3:
+            contextLength = SFRule_GlyphCount(SFContextF3_Rule(context));
+            break;
+    }
+
+    return contextLength;
+}
+
+static SFUInteger _SFChainContextGetContextLength(SFData chainContext)
+{
+    SFUInt16 tblFormat = SFChainContext_Format(chainContext);
+    SFUInteger contextLength = 0;
+
+    switch (tblFormat) {
+        case 1:
+        case 2: {
+            SFUInt16 ruleSetCount = (tblFormat == 1
+                                     ? SFChainContextF1_ChainRuleSetCount(chainContext)
+                                     : SFChainContextF2_ChainRuleSetCount(chainContext));
+            SFUInteger setIndex;
+
+            for (setIndex = 0; setIndex < ruleSetCount; setIndex++) {
+                SFOffset ruleSetOffset = (tblFormat == 1
+                                          ? SFChainContextF1_ChainRuleSetOffset(chainContext, setIndex)
+                                          : SFChainContextF2_ChainRuleSetOffset(chainContext, setIndex));
+
+                if (ruleSetOffset) {
+                    SFUInteger setLength = _SFChainRuleSetGetContextLength(SFData_Subdata(chainContext, ruleSetOffset));
+
+                    if (setLength > contextLength) {
+                        contextLength = setLength;
+                    }
+                }
+            }
+            break;
+        }
+
+        case 3:
+            contextLength = _SFChainRuleGetContextLength(SFChainContextF3_ChainRuleTable(chainContext), SFTrue);
+            break;
+    }
+
+    return contextLength;
+}
+
+static SFUInteger _SFLigatureSubstGetContextLength(SFData ligSubst)
+{
+    SFUInt16 ligSetCount = SFLigatureSubstF1_LigSetCount(ligSubst);
+    SFUInteger contextLength = 0;
+    SFUInteger setIndex;
+
+    for (setIndex = 0; setIndex < ligSetCount; setIndex++) {
+        SFData ligatureSet = SFLigatureSubstF1_LigatureSetTable(ligSubst, setIndex);
+        SFUInt16 ligCount = SFLigatureSet_LigatureCount(ligatureSet);
+        SFUInteger ligIndex;
+
+        for (ligIndex = 0; ligIndex < ligCount; ligIndex++) {
+            SFData ligature = SFLigatureSet_LigatureTable(ligatureSet, ligIndex);
+            SFUInt16 compCount = SFLigature_CompCount(ligature);
+
+            if (compCount > contextLength) {
+                contextLength = compCount;
+            }
+        }
+    }
+
+    return contextLength;
+}
+
+static SFUInteger _SFSubstitutionSubtableGetContextLength(SFLookupType lookupType, SFData subtable)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingle:
+        case SFLookupTypeMultiple:
+        case SFLookupTypeAlternate:
+            return 1;
+
+        case SFLookupTypeLigature:
+            return _SFLigatureSubstGetContextLength(subtable);
+
+        case SFLookupTypeContext:
+            return _SFContextGetContextLength(subtable);
+
+        case SFLookupTypeChainingContext:
+            return _SFChainContextGetContextLength(subtable);
+
+        case SFLookupTypeExtension: {
+            SFLookupType innerType = SFExtensionF1_LookupType(subtable);
+
+            if (innerType != SFLookupTypeExtension) {
+                return _SFSubstitutionSubtableGetContextLength(innerType, SFExtensionF1_ExtensionData(subtable));
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static SFUInteger _SFPositioningSubtableGetContextLength(SFLookupType lookupType, SFData subtable)
+{
+    switch (lookupType) {
+        case SFLookupTypeSingleAdjustment:
+            return 1;
+
+        case SFLookupTypePairAdjustment:
+        case SFLookupTypeCursiveAttachment:
+        case SFLookupTypeMarkToBaseAttachment:
+        case SFLookupTypeMarkToLigatureAttachment:
+        case SFLookupTypeMarkToMarkAttachment:
+            return 2;
+
+        case SFLookupTypeContextPositioning:
+            return _SFContextGetContextLength(subtable);
+
+        case SFLookupTypeChainedContextPositioning:
+            return _SFChainContextGetContextLength(subtable);
+
+        case SFLookupTypeExtensionPositioning: {
+            SFLookupType innerType = SFExtensionF1_LookupType(subtable);
+
+            if (innerType != SFLookupTypeExtensionPositioning) {
+                return _SFPositioningSubtableGetContextLength(innerType, SFExtensionF1_ExtensionData(subtable));
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+SF_INTERNAL SFUInteger SFLookupGetContextLength(SFData lookupTable, SFFeatureKind featureKind)
+{
+    SFUInt16 subtableCount = SFLookup_SubtableCount(lookupTable);
+    SFLookupType lookupType = SFLookup_LookupType(lookupTable);
+    SFUInteger contextLength = 0;
+    SFUInteger subtableIndex;
+
+    for (subtableIndex = 0; subtableIndex < subtableCount; subtableIndex++) {
+        SFData subtable = SFLookup_SubtableData(lookupTable, subtableIndex);
+        SFUInteger subtableLength;
+
+        if (featureKind == SFFeatureKindSubstitution) {
+            subtableLength = _SFSubstitutionSubtableGetContextLength(lookupType, subtable);
+        } else {
+            subtableLength = _SFPositioningSubtableGetContextLength(lookupType, subtable);
+        }
+
+        if (subtableLength > contextLength) {
+            contextLength = subtableLength;
+        }
+    }
+
+    return contextLength;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_LOOKUP_ANALYSIS_H
+#define _SF_INTERNAL_LOOKUP_ANALYSIS_H
+
+#include <SFConfig.h>
+
+#include "SFBase.h"
+#include "SFData.h"
+#include "SFPattern.h"
+
+/**
+ * Tells whether a lookup can match the given glyph as an input, context or pair glyph.
+ *
+ * Only the glyphs listed explicitly in the coverage tables, rule sequences, ligature components and
+ * pair sets of the lookup are considered, along with the glyphs having a nonzero class in its class
+ * definition tables. The lookups nested in contextual subtables are not visited, as they are only
+ * applied inside a context matched by the subtable itself.
+ */
+SF_INTERNAL SFBoolean SFLookupInvolvesGlyph(SFData lookupTable, SFFeatureKind featureKind, SFGlyphID glyphID);
+
+/**
+ * Returns the highest number of glyphs which a lookup can match at once, counting the backtrack and
+ * lookahead glyphs of contextual subtables and the components of ligatures.
+ */
+SF_INTERNAL SFUInteger SFLookupGetContextLength(SFData lookupTable, SFFeatureKind featureKind);
+
+#endif
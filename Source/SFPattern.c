@@ -17,18 +17,24 @@
 #include <SFConfig.h>
 
 #include <stddef.h>
-#include <stdlib.h>
 #include <string.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFPattern.h"
 
 static void _SFFinalizeFeatureUnit(SFFeatureUnitRef featureUnit);
 static void _SFPatternFinalize(SFPatternRef pattern);
 
+/*
+ * Identifier of the next pattern. The caches compare the addresses along with the identifiers, so
+ * patterns created at once on different threads may even share an identifier safely.
+ */
+static SFUInt64 _SFPatternNextIdentifier = 1;
+
 SF_INTERNAL SFPatternRef SFPatternCreate(void)
 {
-    SFPatternRef pattern = malloc(sizeof(SFPattern));
+    SFPatternRef pattern = SFAllocatorAllocate(sizeof(SFPattern));
     pattern->font = NULL;
     pattern->featureTags.items = NULL;
     pattern->featureTags.count = 0;
@@ -38,6 +44,9 @@ SF_INTERNAL SFPatternRef SFPatternCreate(void)
     pattern->scriptTag = 0;
     pattern->languageTag = 0;
     pattern->defaultDirection = SFTextDirectionLeftToRight;
+    pattern->isSpaceSeparable = SFFalse;
+    pattern->contextLength = 0;
+    pattern->identifier = _SFPatternNextIdentifier++;
     pattern->_retainCount = 1;
 
     return pattern;
@@ -45,7 +54,7 @@ SF_INTERNAL SFPatternRef SFPatternCreate(void)
 
 static void _SFFinalizeFeatureUnit(SFFeatureUnitRef featureUnit)
 {
-    free(featureUnit->lookupIndexes.items);
+    SFAllocatorDeallocate(featureUnit->lookupIndexes.items);
 }
 
 static void _SFPatternFinalize(SFPatternRef pattern)
@@ -58,7 +67,22 @@ static void _SFPatternFinalize(SFPatternRef pattern)
         _SFFinalizeFeatureUnit((SFFeatureUnitRef)&pattern->featureUnits.items[index]);
     }
 
-    free(pattern->featureUnits.items);
+    SFAllocatorDeallocate(pattern->featureUnits.items);
+}
+
+SF_INTERNAL SFUInt32 SFPatternCalculateHash(SFPatternRef pattern)
+{
+    SFUInt32 hash = SFHashSeed;
+
+    if (pattern->font) {
+        hash = SFHashBytes(hash, &pattern->font->tables.checksum, sizeof(SFUInt32));
+    }
+
+    hash = SFHashBytes(hash, &pattern->scriptTag, sizeof(SFTag));
+    hash = SFHashBytes(hash, &pattern->languageTag, sizeof(SFTag));
+    hash = SFHashBytes(hash, pattern->featureTags.items, sizeof(SFTag) * pattern->featureTags.count);
+
+    return hash;
 }
 
 SFFontRef SFPatternGetFont(SFPatternRef pattern)
@@ -86,6 +110,16 @@ void SFPatternGetFeatureTags(SFPatternRef pattern, SFTag *buffer)
     memcpy(buffer, pattern->featureTags.items, sizeof(SFTag) * pattern->featureTags.count);
 }
 
+SFBoolean SFPatternIsSpaceSeparable(SFPatternRef pattern)
+{
+    return pattern->isSpaceSeparable;
+}
+
+SFUInteger SFPatternGetContextLength(SFPatternRef pattern)
+{
+    return pattern->contextLength;
+}
+
 SFPatternRef SFPatternRetain(SFPatternRef pattern)
 {
     if (pattern) {
@@ -99,5 +133,6 @@ void SFPatternRelease(SFPatternRef pattern)
 {
     if (pattern && --pattern->_retainCount == 0) {
         _SFPatternFinalize(pattern);
+        SFAllocatorDeallocate(pattern);
     }
 }
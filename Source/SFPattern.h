@@ -62,9 +62,17 @@ typedef struct _SFPattern {
     SFTag scriptTag;                    /**< Tag of the script. */
     SFTag languageTag;                  /**< Tag of the language. */
     SFTextDirection defaultDirection;   /**< Default direction of the script. */
+    SFBoolean isSpaceSeparable;         /**< Whether no lookup of the pattern involves the space. */
+    SFUInteger contextLength;           /**< Maximum number of glyphs matched by a lookup at once. */
+    SFUInt64 identifier;                /**< Number telling the pattern apart from all other ones. */
     SFUInteger _retainCount;
 } SFPattern;
 
 SF_INTERNAL SFPatternRef SFPatternCreate(void);
 
+/**
+ * Calculates a hash of the font tables, script, language and features of the pattern.
+ */
+SF_INTERNAL SFUInt32 SFPatternCalculateHash(SFPatternRef pattern);
+
 #endif
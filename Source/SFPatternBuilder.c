@@ -22,11 +22,16 @@
 #include "SFArtist.h"
 #include "SFAssert.h"
 #include "SFBase.h"
+#include "SFCommon.h"
+#include "SFFont.h"
 #include "SFList.h"
+#include "SFLookupAnalysis.h"
 #include "SFPattern.h"
 #include "SFPatternBuilder.h"
 
 static int _SFLookupIndexComparison(const void *item1, const void *item2);
+static SFBoolean _SFFeatureUnitsInvolveGlyph(SFData table, SFFeatureUnit *featureUnits, SFUInteger unitCount,
+    SFFeatureKind featureKind, SFGlyphID glyphID);
 
 static int _SFLookupIndexComparison(const void *item1, const void *item2)
 {
@@ -36,6 +41,77 @@ static int _SFLookupIndexComparison(const void *item1, const void *item2)
     return (int)(*ref1 - *ref2);
 }
 
+static SFBoolean _SFFeatureUnitsInvolveGlyph(SFData table, SFFeatureUnit *featureUnits, SFUInteger unitCount,
+    SFFeatureKind featureKind, SFGlyphID glyphID)
+{
+    SFData lookupList;
+    SFUInt16 lookupCount;
+    SFUInteger unitIndex;
+
+    /* A table without a lookup list has nothing to apply. */
+    if (!table || !SFHeader_LookupListOffset(table)) {
+        return SFFalse;
+    }
+
+    lookupList = SFHeader_LookupListTable(table);
+    lookupCount = SFLookupList_LookupCount(lookupList);
+
+    for (unitIndex = 0; unitIndex < unitCount; unitIndex++) {
+        SFFeatureUnitRef featureUnit = &featureUnits[unitIndex];
+        SFUInteger index;
+
+        for (index = 0; index < featureUnit->lookupIndexes.count; index++) {
+            SFUInt16 lookupIndex = featureUnit->lookupIndexes.items[index];
+
+            if (lookupIndex < lookupCount) {
+                SFData lookupTable = SFLookupList_LookupTable(lookupList, lookupIndex);
+
+                if (SFLookupInvolvesGlyph(lookupTable, featureKind, glyphID)) {
+                    return SFTrue;
+                }
+            }
+        }
+    }
+
+    return SFFalse;
+}
+
+static SFUInteger _SFFeatureUnitsGetContextLength(SFData table, SFFeatureUnit *featureUnits, SFUInteger unitCount,
+    SFFeatureKind featureKind)
+{
+    SFUInteger contextLength = 0;
+    SFData lookupList;
+    SFUInt16 lookupCount;
+    SFUInteger unitIndex;
+
+    if (!table || !SFHeader_LookupListOffset(table)) {
+        return 0;
+    }
+
+    lookupList = SFHeader_LookupListTable(table);
+    lookupCount = SFLookupList_LookupCount(lookupList);
+
+    for (unitIndex = 0; unitIndex < unitCount; unitIndex++) {
+        SFFeatureUnitRef featureUnit = &featureUnits[unitIndex];
+        SFUInteger index;
+
+        for (index = 0; index < featureUnit->lookupIndexes.count; index++) {
+            SFUInt16 lookupIndex = featureUnit->lookupIndexes.items[index];
+
+            if (lookupIndex < lookupCount) {
+                SFData lookupTable = SFLookupList_LookupTable(lookupList, lookupIndex);
+                SFUInteger lookupLength = SFLookupGetContextLength(lookupTable, featureKind);
+
+                if (lookupLength > contextLength) {
+                    contextLength = lookupLength;
+                }
+            }
+        }
+    }
+
+    return contextLength;
+}
+
 SF_INTERNAL void SFPatternBuilderInitialize(SFPatternBuilderRef builder, SFPatternRef pattern)
 {
     /* Pattern must NOT be null. */
@@ -204,5 +280,27 @@ SF_INTERNAL void SFPatternBuilderBuild(SFPatternBuilderRef builder)
     SFListFinalizeKeepingArray(&builder->_featureTags, &pattern->featureTags.items, &pattern->featureTags.count);
     SFListFinalizeKeepingArray(&builder->_featureUnits, &pattern->featureUnits.items, &unitCount);
 
+    if (unitCount == 0) {
+        /* Without any lookup, nothing can reach across a space. */
+        pattern->isSpaceSeparable = SFTrue;
+    } else if (pattern->font) {
+        SFFontTables *tables = &pattern->font->tables;
+        SFFeatureUnit *gsubUnits = pattern->featureUnits.items;
+        SFFeatureUnit *gposUnits = gsubUnits + pattern->featureUnits.gsub;
+        SFGlyphID spaceGlyph = SFFontGetGlyphIDForCodepoint(pattern->font, 0x0020);
+        SFUInteger gsubLength;
+        SFUInteger gposLength;
+
+        /* Words can be shaped apart only if no lookup of the pattern can reach across a space. */
+        pattern->isSpaceSeparable =
+            !_SFFeatureUnitsInvolveGlyph(tables->gsub, gsubUnits, pattern->featureUnits.gsub, SFFeatureKindSubstitution, spaceGlyph)
+         && !_SFFeatureUnitsInvolveGlyph(tables->gpos, gposUnits, pattern->featureUnits.gpos, SFFeatureKindPositioning, spaceGlyph);
+
+        /* Keep the larger context of both tables to know how far an edit can reach. */
+        gsubLength = _SFFeatureUnitsGetContextLength(tables->gsub, gsubUnits, pattern->featureUnits.gsub, SFFeatureKindSubstitution);
+        gposLength = _SFFeatureUnitsGetContextLength(tables->gpos, gposUnits, pattern->featureUnits.gpos, SFFeatureKindPositioning);
+        pattern->contextLength = (gsubLength > gposLength ? gsubLength : gposLength);
+    }
+
     builder->_canBuild = SFFalse;
 }
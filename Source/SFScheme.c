@@ -16,8 +16,8 @@
 
 #include <SFConfig.h>
 #include <stddef.h>
-#include <stdlib.h>
 
+#include "SFAllocator.h"
 #include "SFBase.h"
 #include "SFCommon.h"
 #include "SFFont.h"
@@ -182,7 +182,7 @@ static void _SFAddHeaderTable(SFSchemeRef scheme, SFPatternBuilderRef patternBui
 
 SFSchemeRef SFSchemeCreate(void)
 {
-    SFSchemeRef scheme = malloc(sizeof(SFScheme));
+    SFSchemeRef scheme = SFAllocatorAllocate(sizeof(SFScheme));
     scheme->_font = NULL;
     scheme->_scriptTag = 0;
     scheme->_languageTag = 0;
@@ -253,6 +253,6 @@ SFSchemeRef SFSchemeRetain(SFSchemeRef scheme)
 void SFSchemeRelease(SFSchemeRef scheme)
 {
     if (scheme && --scheme->_retainCount == 0) {
-        free(scheme);
+        SFAllocatorDeallocate(scheme);
     }
 }
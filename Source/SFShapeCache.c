@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SFConfig.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "SFAlbum.h"
+#include "SFAllocator.h"
+#include "SFAssert.h"
+#include "SFBase.h"
+#include "SFPattern.h"
+#include "SFShapeCache.h"
+
+/**
+ * The number of buckets with which each shard starts.
+ */
+#define _SFShapeCacheInitialBucketCount     16
+
+/**
+ * Rounds a size up to keep the serialized album aligned to four bytes.
+ */
+#define _SFShapeCacheAlign(size)            (((size) + 3) & ~(SFUInteger)3)
+
+#define _SFShapeCacheEntryText(entry)       ((SFUInt8 *)((entry) + 1))
+#define _SFShapeCacheEntryAlbum(entry)      (_SFShapeCacheEntryText(entry) + _SFShapeCacheAlign((entry)->key.textSize))
+
+static void _SFShapeCacheLock(SFShapeCacheRef cache, SFUInteger shard)
+{
+    if (cache->_protocol.lock) {
+        cache->_protocol.lock(cache->_object, shard);
+    }
+}
+
+static void _SFShapeCacheUnlock(SFShapeCacheRef cache, SFUInteger shard)
+{
+    if (cache->_protocol.unlock) {
+        cache->_protocol.unlock(cache->_object, shard);
+    }
+}
+
+static SFShapeCacheEntryRef *_SFShapeCacheCreateBuckets(SFUInteger bucketCount)
+{
+    SFShapeCacheEntryRef *buckets = SFAllocatorAllocate(sizeof(SFShapeCacheEntryRef) * bucketCount);
+    SFUInteger index;
+
+    for (index = 0; index < bucketCount; index++) {
+        buckets[index] = NULL;
+    }
+
+    return buckets;
+}
+
+static SFUInteger _SFShapeCacheGetShardIndex(SFShapeCacheRef cache, SFUInt32 hash)
+{
+    return hash % cache->_shardCount;
+}
+
+static SFShapeCacheEntryRef *_SFShapeCacheGetBucket(SFShapeCacheRef cache, SFShapeCacheShardRef shard, SFUInt32 hash)
+{
+    /* Skip the part of the hash which decided the shard. */
+    return &shard->buckets[(hash / cache->_shardCount) & (shard->bucketCount - 1)];
+}
+
+static SFBoolean _SFShapeCacheKeyEqualToKey(SFShapeCacheKeyRef key1, SFShapeCacheKeyRef key2)
+{
+    return (key1->hash == key2->hash
+            && key1->pattern == key2->pattern
+            && key1->patternIdentifier == key2->patternIdentifier
+            && key1->encoding == key2->encoding
+            && key1->textDirection == key2->textDirection
+            && key1->textMode == key2->textMode
+            && key1->shapingMode == key2->shapingMode
+            && key1->textSize == key2->textSize
+            && memcmp(key1->text, key2->text, key1->textSize) == 0);
+}
+
+static SFShapeCacheEntryRef _SFShapeCacheFindEntry(SFShapeCacheRef cache, SFShapeCacheShardRef shard, SFShapeCacheKeyRef key)
+{
+    SFShapeCacheEntryRef entry = *_SFShapeCacheGetBucket(cache, shard, key->hash);
+
+    while (entry) {
+        if (_SFShapeCacheKeyEqualToKey(&entry->key, key)) {
+            break;
+        }
+
+        entry = entry->_next;
+    }
+
+    return entry;
+}
+
+static void _SFShapeCacheLinkNewest(SFShapeCacheShardRef shard, SFShapeCacheEntryRef entry)
+{
+    entry->_newer = NULL;
+    entry->_older = shard->newest;
+
+    if (shard->newest) {
+        shard->newest->_newer = entry;
+    } else {
+        shard->oldest = entry;
+    }
+
+    shard->newest = entry;
+}
+
+static void _SFShapeCacheUnlinkUsage(SFShapeCacheShardRef shard, SFShapeCacheEntryRef entry)
+{
+    if (entry->_newer) {
+        entry->_newer->_older = entry->_older;
+    } else {
+        shard->newest = entry->_older;
+    }
+
+    if (entry->_older) {
+        entry->_older->_newer = entry->_newer;
+    } else {
+        shard->oldest = entry->_newer;
+    }
+}
+
+static void _SFShapeCacheUnlinkBucket(SFShapeCacheRef cache, SFShapeCacheShardRef shard, SFShapeCacheEntryRef entry)
+{
+    SFShapeCacheEntryRef *link = _SFShapeCacheGetBucket(cache, shard, entry->key.hash);
+
+    while (*link != entry) {
+        link = &(*link)->_next;
+    }
+
+    *link = entry->_next;
+}
+
+/**
+ * Doubles the buckets of a shard once it holds more entries than buckets, keeping the chains short.
+ */
+static void _SFShapeCacheGrowBuckets(SFShapeCacheRef cache, SFShapeCacheShardRef shard)
+{
+    SFShapeCacheEntryRef *oldBuckets = shard->buckets;
+    SFUInteger oldCount = shard->bucketCount;
+    SFUInteger index;
+
+    shard->bucketCount = oldCount * 2;
+    shard->buckets = _SFShapeCacheCreateBuckets(shard->bucketCount);
+
+    for (index = 0; index < oldCount; index++) {
+        SFShapeCacheEntryRef entry = oldBuckets[index];
+
+        while (entry) {
+            SFShapeCacheEntryRef next = entry->_next;
+            SFShapeCacheEntryRef *bucket = _SFShapeCacheGetBucket(cache, shard, entry->key.hash);
+
+            entry->_next = *bucket;
+            *bucket = entry;
+
+            entry = next;
+        }
+    }
+
+    SFAllocatorDeallocate(oldBuckets);
+}
+
+/**
+ * Releases a chain of entries linked through their next pointers.
+ */
+static void _SFShapeCacheReleaseEntries(SFShapeCacheEntryRef entry)
+{
+    while (entry) {
+        SFShapeCacheEntryRef next = entry->_next;
+
+        SFAllocatorDeallocate(entry);
+
+        entry = next;
+    }
+}
+
+/**
+ * Detaches all entries of a shard, returning them as a chain linked through their next pointers.
+ */
+static SFShapeCacheEntryRef _SFShapeCacheDetachEntries(SFShapeCacheShardRef shard)
+{
+    SFShapeCacheEntryRef chain = NULL;
+    SFShapeCacheEntryRef entry = shard->newest;
+    SFUInteger index;
+
+    while (entry) {
+        entry->_next = chain;
+        chain = entry;
+
+        entry = entry->_older;
+    }
+
+    for (index = 0; index < shard->bucketCount; index++) {
+        shard->buckets[index] = NULL;
+    }
+
+    shard->newest = NULL;
+    shard->oldest = NULL;
+    shard->entryCount = 0;
+    shard->memoryUsage = 0;
+
+    return chain;
+}
+
+SFShapeCacheRef SFShapeCacheCreate(const SFShapeCacheProtocol *protocol, void *object, SFUInteger shardCount, SFUInteger byteBudget)
+{
+    SFShapeCacheRef cache;
+    SFUInteger index;
+
+    /* There must be at least one shard. */
+    SFAssert(shardCount > 0);
+
+    cache = SFAllocatorAllocate(sizeof(SFShapeCache));
+
+    if (protocol) {
+        /* Locking functions must be provided in pairs. */
+        SFAssert((protocol->lock == NULL) == (protocol->unlock == NULL));
+
+        cache->_protocol = *protocol;
+    } else {
+        cache->_protocol.lock = NULL;
+        cache->_protocol.unlock = NULL;
+    }
+
+    cache->_object = object;
+    cache->_shards = SFAllocatorAllocate(sizeof(SFShapeCacheShard) * shardCount);
+    cache->_shardCount = shardCount;
+    cache->_shardBudget = byteBudget / shardCount;
+    cache->_retainCount = 1;
+
+    for (index = 0; index < shardCount; index++) {
+        SFShapeCacheShardRef shard = &cache->_shards[index];
+
+        shard->buckets = _SFShapeCacheCreateBuckets(_SFShapeCacheInitialBucketCount);
+        shard->bucketCount = _SFShapeCacheInitialBucketCount;
+        shard->newest = NULL;
+        shard->oldest = NULL;
+        shard->entryCount = 0;
+        shard->memoryUsage = 0;
+        shard->hitCount = 0;
+        shard->missCount = 0;
+    }
+
+    return cache;
+}
+
+SF_INTERNAL void SFShapeCacheKeyInitialize(SFShapeCacheKeyRef key, SFPatternRef pattern,
+    SFUInt32 encoding, const void *text, SFUInteger textSize,
+    SFTextDirection textDirection, SFTextMode textMode, SFUInt32 shapingMode)
+{
+    SFUInt32 hash = SFHashSeed;
+
+    key->pattern = pattern;
+    key->patternIdentifier = (pattern ? pattern->identifier : 0);
+    key->text = text;
+    key->textSize = textSize;
+    key->encoding = encoding;
+    key->textDirection = textDirection;
+    key->textMode = textMode;
+    key->shapingMode = shapingMode;
+
+    hash = SFHashBytes(hash, &key->patternIdentifier, sizeof(SFUInt64));
+    hash = SFHashBytes(hash, &key->encoding, sizeof(SFUInt32));
+    hash = SFHashBytes(hash, &key->textDirection, sizeof(SFTextDirection));
+    hash = SFHashBytes(hash, &key->textMode, sizeof(SFTextMode));
+    hash = SFHashBytes(hash, &key->shapingMode, sizeof(SFUInt32));
+    hash = SFHashBytes(hash, text, textSize);
+
+    key->hash = hash;
+}
+
+SF_INTERNAL SFBoolean SFShapeCacheIsLocked(SFShapeCacheRef cache)
+{
+    return (cache && cache->_protocol.lock);
+}
+
+SF_INTERNAL SFBoolean SFShapeCacheLoadAlbum(SFShapeCacheRef cache, SFShapeCacheKeyRef key, SFAlbumRef album)
+{
+    SFUInteger shardIndex = _SFShapeCacheGetShardIndex(cache, key->hash);
+    SFShapeCacheShardRef shard = &cache->_shards[shardIndex];
+    SFShapeCacheEntryRef entry;
+
+    _SFShapeCacheLock(cache, shardIndex);
+
+    entry = _SFShapeCacheFindEntry(cache, shard, key);
+
+    if (entry) {
+        /* Mark the entry as most recently used. */
+        _SFShapeCacheUnlinkUsage(shard, entry);
+        _SFShapeCacheLinkNewest(shard, entry);
+
+        /* Copy the results while the entry cannot be evicted by another thread. */
+        SFAlbumLoadBuffer(album, _SFShapeCacheEntryAlbum(entry), entry->albumSize);
+
+        shard->hitCount++;
+    } else {
+        shard->missCount++;
+    }
+
+    _SFShapeCacheUnlock(cache, shardIndex);
+
+    return (entry != NULL);
+}
+
+SF_INTERNAL void SFShapeCacheStoreAlbum(SFShapeCacheRef cache, SFShapeCacheKeyRef key, SFAlbumRef album)
+{
+    SFUInteger shardIndex = _SFShapeCacheGetShardIndex(cache, key->hash);
+    SFShapeCacheShardRef shard = &cache->_shards[shardIndex];
+    SFUInteger albumSize = SFAlbumSerialize(album, NULL, NULL, 0);
+    SFUInteger entrySize = sizeof(SFShapeCacheEntry) + _SFShapeCacheAlign(key->textSize) + albumSize;
+    SFShapeCacheEntryRef evicted = NULL;
+    SFShapeCacheEntryRef entry;
+
+    /* Results which would not fit in the shard are not worth evicting everything else for. */
+    if (entrySize > cache->_shardBudget) {
+        return;
+    }
+
+    /* Prepare the entry outside the lock. */
+    entry = SFAllocatorAllocate(entrySize);
+    entry->key = *key;
+    entry->key.text = _SFShapeCacheEntryText(entry);
+    entry->albumSize = albumSize;
+    entry->size = entrySize;
+
+    memcpy(_SFShapeCacheEntryText(entry), key->text, key->textSize);
+    SFAlbumSerialize(album, NULL, _SFShapeCacheEntryAlbum(entry), albumSize);
+
+    _SFShapeCacheLock(cache, shardIndex);
+
+    if (_SFShapeCacheFindEntry(cache, shard, key)) {
+        /* Another thread has stored the same results in the meantime. */
+        entry->_next = NULL;
+        evicted = entry;
+    } else {
+        SFShapeCacheEntryRef *bucket;
+
+        if (shard->entryCount >= shard->bucketCount) {
+            _SFShapeCacheGrowBuckets(cache, shard);
+        }
+
+        bucket = _SFShapeCacheGetBucket(cache, shard, key->hash);
+        entry->_next = *bucket;
+        *bucket = entry;
+
+        _SFShapeCacheLinkNewest(shard, entry);
+        shard->entryCount++;
+        shard->memoryUsage += entrySize;
+
+        /* Evict the least recently used entries until the shard is within its budget. */
+        while (shard->memoryUsage > cache->_shardBudget) {
+            SFShapeCacheEntryRef oldest = shard->oldest;
+
+            _SFShapeCacheUnlinkBucket(cache, shard, oldest);
+            _SFShapeCacheUnlinkUsage(shard, oldest);
+            shard->entryCount--;
+            shard->memoryUsage -= oldest->size;
+
+            oldest->_next = evicted;
+            evicted = oldest;
+        }
+    }
+
+    _SFShapeCacheUnlock(cache, shardIndex);
+
+    /* Release the discarded entries outside the lock. */
+    _SFShapeCacheReleaseEntries(evicted);
+}
+
+SFUInteger SFShapeCacheGetHitCount(SFShapeCacheRef cache)
+{
+    SFUInteger hitCount = 0;
+    SFUInteger index;
+
+    for (index = 0; index < cache->_shardCount; index++) {
+        _SFShapeCacheLock(cache, index);
+        hitCount += cache->_shards[index].hitCount;
+        _SFShapeCacheUnlock(cache, index);
+    }
+
+    return hitCount;
+}
+
+SFUInteger SFShapeCacheGetMissCount(SFShapeCacheRef cache)
+{
+    SFUInteger missCount = 0;
+    SFUInteger index;
+
+    for (index = 0; index < cache->_shardCount; index++) {
+        _SFShapeCacheLock(cache, index);
+        missCount += cache->_shards[index].missCount;
+        _SFShapeCacheUnlock(cache, index);
+    }
+
+    return missCount;
+}
+
+SFUInteger SFShapeCacheGetMemoryUsage(SFShapeCacheRef cache)
+{
+    SFUInteger memoryUsage = 0;
+    SFUInteger index;
+
+    for (index = 0; index < cache->_shardCount; index++) {
+        _SFShapeCacheLock(cache, index);
+        memoryUsage += cache->_shards[index].memoryUsage;
+        _SFShapeCacheUnlock(cache, index);
+    }
+
+    return memoryUsage;
+}
+
+void SFShapeCacheClear(SFShapeCacheRef cache)
+{
+    SFUInteger index;
+
+    for (index = 0; index < cache->_shardCount; index++) {
+        SFShapeCacheEntryRef chain;
+
+        _SFShapeCacheLock(cache, index);
+        chain = _SFShapeCacheDetachEntries(&cache->_shards[index]);
+        _SFShapeCacheUnlock(cache, index);
+
+        _SFShapeCacheReleaseEntries(chain);
+    }
+}
+
+void SFShapeCachePurgePattern(SFShapeCacheRef cache, SFPatternRef pattern)
+{
+    SFUInteger index;
+
+    for (index = 0; index < cache->_shardCount; index++) {
+        SFShapeCacheShardRef shard = &cache->_shards[index];
+        SFShapeCacheEntryRef purged = NULL;
+        SFShapeCacheEntryRef entry;
+
+        _SFShapeCacheLock(cache, index);
+
+        entry = shard->newest;
+
+        while (entry) {
+            SFShapeCacheEntryRef older = entry->_older;
+
+            if (entry->key.pattern == pattern
+                && entry->key.patternIdentifier == pattern->identifier) {
+                _SFShapeCacheUnlinkBucket(cache, shard, entry);
+                _SFShapeCacheUnlinkUsage(shard, entry);
+                shard->entryCount--;
+                shard->memoryUsage -= entry->size;
+
+                entry->_next = purged;
+                purged = entry;
+            }
+
+            entry = older;
+        }
+
+        _SFShapeCacheUnlock(cache, index);
+
+        _SFShapeCacheReleaseEntries(purged);
+    }
+}
+
+SFShapeCacheRef SFShapeCacheRetain(SFShapeCacheRef cache)
+{
+    if (cache) {
+        cache->_retainCount++;
+    }
+
+    return cache;
+}
+
+void SFShapeCacheRelease(SFShapeCacheRef cache)
+{
+    if (cache && --cache->_retainCount == 0) {
+        SFUInteger index;
+
+        for (index = 0; index < cache->_shardCount; index++) {
+            SFShapeCacheShardRef shard = &cache->_shards[index];
+
+            _SFShapeCacheReleaseEntries(_SFShapeCacheDetachEntries(shard));
+            SFAllocatorDeallocate(shard->buckets);
+        }
+
+        SFAllocatorDeallocate(cache->_shards);
+        SFAllocatorDeallocate(cache);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_INTERNAL_SHAPE_CACHE_H
+#define _SF_INTERNAL_SHAPE_CACHE_H
+
+#include <SFConfig.h>
+#include <SFShapeCache.h>
+
+#include "SFAlbum.h"
+#include "SFBase.h"
+#include "SFPattern.h"
+
+/**
+ * Identifies the input of a shaping call in a cache.
+ */
+typedef struct _SFShapeCacheKey {
+    SFPatternRef pattern;               /**< Pattern used for shaping, never dereferenced by the cache. */
+    SFUInt64 patternIdentifier;         /**< Identifier of the pattern, telling apart reused addresses. */
+    const void *text;                   /**< Bytes of the text. */
+    SFUInteger textSize;                /**< Number of bytes in the text. */
+    SFUInt32 encoding;                  /**< Encoding of the text. */
+    SFTextDirection textDirection;      /**< Direction in which the text is shaped. */
+    SFTextMode textMode;                /**< Mode in which the text is shaped. */
+    SFUInt32 shapingMode;               /**< Extent to which the text is shaped. */
+    SFUInt32 hash;                      /**< Hash of all the above. */
+} SFShapeCacheKey, *SFShapeCacheKeyRef;
+
+typedef struct _SFShapeCacheEntry *SFShapeCacheEntryRef;
+
+/**
+ * Keeps the results of a shaping call, followed by the bytes of its text and the serialized album.
+ */
+typedef struct _SFShapeCacheEntry {
+    SFShapeCacheEntryRef _next;         /**< Next entry in the same bucket. */
+    SFShapeCacheEntryRef _newer;        /**< Entry used more recently than this one. */
+    SFShapeCacheEntryRef _older;        /**< Entry used less recently than this one. */
+    SFShapeCacheKey key;                /**< Key of the entry, referring to its own copy of text. */
+    SFUInteger albumSize;               /**< Number of bytes in the serialized album. */
+    SFUInteger size;                    /**< Total number of bytes occupied by the entry. */
+} SFShapeCacheEntry;
+
+typedef struct _SFShapeCacheShard {
+    SFShapeCacheEntryRef *buckets;      /**< Heads of the entry chains, indexed by hash. */
+    SFUInteger bucketCount;             /**< Number of buckets, always a power of two. */
+    SFShapeCacheEntryRef newest;        /**< Most recently used entry. */
+    SFShapeCacheEntryRef oldest;        /**< Least recently used entry. */
+    SFUInteger entryCount;              /**< Number of entries in the shard. */
+    SFUInteger memoryUsage;             /**< Number of bytes occupied by the entries. */
+    SFUInteger hitCount;                /**< Number of successful lookups. */
+    SFUInteger missCount;               /**< Number of failed lookups. */
+} SFShapeCacheShard, *SFShapeCacheShardRef;
+
+typedef struct _SFShapeCache {
+    SFShapeCacheProtocol _protocol;     /**< Locking functions of the shards. */
+    void *_object;                      /**< Object passed to locking functions. */
+    SFShapeCacheShardRef _shards;       /**< Independently locked parts of the cache. */
+    SFUInteger _shardCount;             /**< Number of shards. */
+    SFUInteger _shardBudget;            /**< Maximum number of bytes occupied by each shard. */
+    SFUInteger _retainCount;
+} SFShapeCache;
+
+/**
+ * Initializes a key and computes its hash.
+ */
+SF_INTERNAL void SFShapeCacheKeyInitialize(SFShapeCacheKeyRef key, SFPatternRef pattern,
+    SFUInt32 encoding, const void *text, SFUInteger textSize,
+    SFTextDirection textDirection, SFTextMode textMode, SFUInt32 shapingMode);
+
+/**
+ * Returns whether the cache can be accessed from multiple threads at once.
+ *
+ * @return
+ *      SFTrue if the cache has locking functions, SFFalse if it is NULL or unlocked.
+ */
+SF_INTERNAL SFBoolean SFShapeCacheIsLocked(SFShapeCacheRef cache);
+
+/**
+ * Fills the album with the cached results of the given key.
+ *
+ * @return
+ *      SFTrue if the results were found, SFFalse otherwise.
+ */
+SF_INTERNAL SFBoolean SFShapeCacheLoadAlbum(SFShapeCacheRef cache, SFShapeCacheKeyRef key, SFAlbumRef album);
+
+/**
+ * Keeps the results of a wrapped up album against the given key, discarding the least recently used
+ * results if the budget is exceeded.
+ */
+SF_INTERNAL void SFShapeCacheStoreAlbum(SFShapeCacheRef cache, SFShapeCacheKeyRef key, SFAlbumRef album);
+
+#endif
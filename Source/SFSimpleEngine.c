@@ -58,7 +58,7 @@ static void _SFSimpleEngineProcessAlbum(const void *object, SFAlbumRef album)
     SFArtistRef artist = simpleEngine->_artist;
     SFTextProcessor processor;
 
-    SFTextProcessorInitialize(&processor, artist->pattern, album, artist->textDirection, artist->textMode, SFFalse);
+    SFTextProcessorInitialize(&processor, artist->pattern, album, artist->textDirection, artist->textMode, artist->shapingMode, SFFalse);
     SFTextProcessorDiscoverGlyphs(&processor);
     SFTextProcessorSubstituteGlyphs(&processor);
     SFTextProcessorPositionGlyphs(&processor);
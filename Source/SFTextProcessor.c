@@ -38,7 +38,8 @@ static void _SFPrepareLookup(SFTextProcessorRef processor, SFUInt16 lookupIndex,
 static void _SFApplySubtables(SFTextProcessorRef processor, SFData lookupTable);
 
 SF_INTERNAL void SFTextProcessorInitialize(SFTextProcessorRef textProcessor, SFPatternRef pattern,
-    SFAlbumRef album, SFTextDirection textDirection, SFTextMode textMode, SFBoolean zeroWidthMarks)
+    SFAlbumRef album, SFTextDirection textDirection, SFTextMode textMode, SFShapingMode shapingMode,
+    SFBoolean zeroWidthMarks)
 {
     SFData gdef;
 
@@ -52,6 +53,7 @@ SF_INTERNAL void SFTextProcessorInitialize(SFTextProcessorRef textProcessor, SFP
     textProcessor->_glyphClassDef = NULL;
     textProcessor->_textDirection = textDirection;
     textProcessor->_textMode = textMode;
+    textProcessor->_shapingMode = shapingMode;
     textProcessor->_zeroWidthMarks = zeroWidthMarks;
     textProcessor->_containsZeroWidthCodepoints = SFFalse;
 
@@ -134,6 +136,11 @@ SF_INTERNAL void SFTextProcessorPositionGlyphs(SFTextProcessorRef textProcessor)
     SFUInteger glyphCount = album->glyphCount;
     SFUInteger index;
 
+    /* Leave the album filled so that no positioning storage is touched. */
+    if (textProcessor->_shapingMode == SFShapingModeSubstitutionOnly) {
+        return;
+    }
+
     SFAlbumBeginArranging(album);
 
     /* Set positions and advances of all glyphs. */
@@ -166,7 +173,10 @@ SF_INTERNAL void SFTextProcessorPositionGlyphs(SFTextProcessorRef textProcessor)
             _SFMakeMarksZeroWidth(textProcessor);
         }
 
-        _SFResolveAttachments(textProcessor);
+        /* Attachments never change the advances, so they are not needed for measurement. */
+        if (textProcessor->_shapingMode != SFShapingModeMeasure) {
+            _SFResolveAttachments(textProcessor);
+        }
     }
 
     SFAlbumEndArranging(album);
@@ -174,7 +184,13 @@ SF_INTERNAL void SFTextProcessorPositionGlyphs(SFTextProcessorRef textProcessor)
 
 SF_INTERNAL void SFTextProcessorWrapUp(SFTextProcessorRef textProcessor)
 {
-    SFAlbumWrapUp(textProcessor->_album);
+    SFAlbumRef album = textProcessor->_album;
+
+    if (textProcessor->_shapingMode == SFShapingModeMeasure) {
+        SFAlbumWrapUpMeasured(album);
+    } else {
+        SFAlbumWrapUp(album);
+    }
 }
 
 static void _SFApplyFeatureRange(SFTextProcessorRef processor, SFUInteger index, SFUInteger count)
@@ -20,6 +20,8 @@
 #ifdef SF_CONFIG_UNITY
 
 #include "SFAlbum.c"
+#include "SFAlbumPool.c"
+#include "SFAllocator.c"
 #include "SFArabicEngine.c"
 #include "SFArtist.c"
 #include "SFBase.c"
@@ -33,10 +35,12 @@
 #include "SFJoiningTypeLookup.c"
 #include "SFList.c"
 #include "SFLocator.c"
+#include "SFLookupAnalysis.c"
 #include "SFOpenType.c"
 #include "SFPattern.c"
 #include "SFPatternBuilder.c"
 #include "SFScheme.c"
+#include "SFShapeCache.c"
 #include "SFShapingEngine.c"
 #include "SFShapingKnowledge.c"
 #include "SFSimpleEngine.c"
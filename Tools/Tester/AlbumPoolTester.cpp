@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstddef>
+
+extern "C" {
+#include <Source/SFAlbum.h>
+#include <Source/SFAlbumPool.h>
+}
+
+#include "AlbumPoolTester.h"
+
+using namespace SheenFigure::Tester;
+
+struct LockCounter {
+    int locks;
+    int unlocks;
+};
+
+static void SFLockCounterLock(void *object)
+{
+    LockCounter *counter = (LockCounter *)object;
+    assert(counter->locks == counter->unlocks);
+
+    counter->locks++;
+}
+
+static void SFLockCounterUnlock(void *object)
+{
+    LockCounter *counter = (LockCounter *)object;
+    assert(counter->locks == counter->unlocks + 1);
+
+    counter->unlocks++;
+}
+
+static void SFAlbumGrow(SFAlbumRef album, SFUInteger codeunitCount)
+{
+    SFAlbumReset(album, NULL, codeunitCount);
+    SFAlbumReserveCapacity(album, codeunitCount);
+}
+
+AlbumPoolTester::AlbumPoolTester()
+{
+}
+
+void AlbumPoolTester::testTakeAndGiveBack()
+{
+    SFAlbumPoolRef pool = SFAlbumPoolCreate(NULL, NULL, 4);
+
+    /* Test that an empty pool creates a new album. */
+    SFAlbumRef album = SFAlbumPoolTake(pool, 16);
+    assert(album != NULL);
+
+    /* Test that the album given back is reused. */
+    SFAlbumPoolGiveBack(pool, album);
+    assert(SFAlbumPoolTake(pool, 16) == album);
+
+    /* Test that the pool hands out distinct albums. */
+    SFAlbumRef other = SFAlbumPoolTake(pool, 16);
+    assert(other != album);
+
+    SFAlbumPoolGiveBack(pool, album);
+    SFAlbumPoolGiveBack(pool, other);
+    SFAlbumPoolRelease(pool);
+}
+
+void AlbumPoolTester::testCapacityClasses()
+{
+    SFAlbumPoolRef pool = SFAlbumPoolCreate(NULL, NULL, 4);
+
+    SFAlbumRef small = SFAlbumPoolTake(pool, 16);
+    SFAlbumRef large = SFAlbumPoolTake(pool, 10000);
+    SFAlbumGrow(small, 16);
+    SFAlbumGrow(large, 10000);
+
+    SFAlbumPoolGiveBack(pool, small);
+    SFAlbumPoolGiveBack(pool, large);
+
+    /* Test that the albums are handed out according to their capacity. */
+    assert(SFAlbumPoolTake(pool, 10000) == large);
+    assert(SFAlbumPoolTake(pool, 32) == small);
+
+    /* Test that a medium text does not evict either of them. */
+    SFAlbumRef medium = SFAlbumPoolTake(pool, 1000);
+    assert(medium != small && medium != large);
+
+    SFAlbumPoolGiveBack(pool, small);
+    SFAlbumPoolGiveBack(pool, medium);
+    SFAlbumPoolGiveBack(pool, large);
+    SFAlbumPoolRelease(pool);
+}
+
+void AlbumPoolTester::testPreGrownAlbums()
+{
+    SFAlbumPoolRef pool = SFAlbumPoolCreate(NULL, NULL, 4);
+
+    /* Test that a new album is grown for the expected text. */
+    SFAlbumRef album = SFAlbumPoolTake(pool, 1000);
+    SFUInteger memoryUsage = SFAlbumGetMemoryUsage(album);
+    assert(memoryUsage > 0);
+
+    SFAlbumGrow(album, 1000);
+    assert(SFAlbumGetAllocationCount(album) == 0);
+    assert(SFAlbumGetMemoryUsage(album) == memoryUsage);
+
+    /* Test that it is not grown beyond the expected text to the limit of its class. */
+    SFAlbumGrow(album, 4096);
+    assert(SFAlbumGetAllocationCount(album) > 0);
+    assert(SFAlbumGetMemoryUsage(album) > memoryUsage);
+
+    /* Test that the album is handed back to the class it was grown for. */
+    SFAlbumPoolGiveBack(pool, album);
+    assert(SFAlbumPoolTake(pool, 300) == album);
+
+    /* Test that growing the index map alone does not move an album to a larger class. */
+    SFAlbumRef small = SFAlbumPoolTake(pool, 16);
+    SFAlbumReset(small, NULL, 10000);
+    SFAlbumPoolGiveBack(pool, small);
+
+    SFAlbumRef large = SFAlbumPoolTake(pool, 10000);
+    assert(large != small);
+    assert(SFAlbumPoolTake(pool, 16) == small);
+
+    SFAlbumPoolGiveBack(pool, small);
+    SFAlbumPoolGiveBack(pool, large);
+    SFAlbumPoolGiveBack(pool, album);
+    SFAlbumPoolRelease(pool);
+}
+
+void AlbumPoolTester::testClassLimit()
+{
+    SFAlbumPoolRef pool = SFAlbumPoolCreate(NULL, NULL, 1);
+
+    SFAlbumRef first = SFAlbumPoolTake(pool, 16);
+    SFAlbumRef second = SFAlbumPoolTake(pool, 16);
+
+    /* Test that the albums beyond the limit are released. */
+    SFAlbumPoolGiveBack(pool, first);
+    SFAlbumPoolGiveBack(pool, second);
+
+    assert(SFAlbumPoolTake(pool, 16) == first);
+
+    SFAlbumPoolGiveBack(pool, first);
+    SFAlbumPoolRelease(pool);
+}
+
+void AlbumPoolTester::testLocking()
+{
+    LockCounter counter = { 0, 0 };
+    SFAlbumPoolProtocol protocol;
+    protocol.lock = SFLockCounterLock;
+    protocol.unlock = SFLockCounterUnlock;
+
+    SFAlbumPoolRef pool = SFAlbumPoolCreate(&protocol, &counter, 2);
+
+    /* Test that each access is surrounded by a lock. */
+    SFAlbumRef album = SFAlbumPoolTake(pool, 16);
+    assert(counter.locks == 1 && counter.unlocks == 1);
+
+    SFAlbumPoolGiveBack(pool, album);
+    assert(counter.locks == 2 && counter.unlocks == 2);
+
+    SFAlbumPoolRelease(pool);
+}
+
+void AlbumPoolTester::test()
+{
+    testTakeAndGiveBack();
+    testCapacityClasses();
+    testPreGrownAlbums();
+    testClassLimit();
+    testLocking();
+}
@@ -21,6 +21,8 @@
 
 extern "C" {
 #include <SBCodepointSequence.h>
+#include <SFAllocator.h>
+#include <SFArtist.h>
 #include <Source/SFAlbum.h>
 }
 
@@ -43,6 +45,35 @@ static void SFAlbumReserveGlyphsInitialized(SFAlbumRef album, SFUInteger index,
     }
 }
 
+static void *SFCountingAllocate(void *object, SFUInteger size)
+{
+    (*(SFUInteger *)object)++;
+    return malloc(size);
+}
+
+static void *SFCountingReallocate(void *object, void *pointer, SFUInteger size)
+{
+    (*(SFUInteger *)object)++;
+    return realloc(pointer, size);
+}
+
+static void SFCountingDeallocate(void *object, void *pointer)
+{
+    free(pointer);
+}
+
+static void SFAlbumShapeDummyText(SFAlbumRef album, SFUInteger glyphCount)
+{
+    SFAlbumReset(album, NULL, glyphCount);
+    SFAlbumBeginFilling(album);
+    SFAlbumReserveGlyphsInitialized(album, 0, glyphCount);
+    SFAlbumReserveGlyphsInitialized(album, glyphCount / 2, 2);
+    SFAlbumEndFilling(album);
+    SFAlbumBeginArranging(album);
+    SFAlbumEndArranging(album);
+    SFAlbumWrapUp(album);
+}
+
 AlbumTester::AlbumTester()
 {
 }
@@ -187,6 +218,37 @@ void AlbumTester::testAddGlyph()
         const SFUInteger *actualMap = SFAlbumGetCodeunitToGlyphMapPtr(&album);
         const SFInteger expectedMap[] = { 0, 1, 1, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4 };
         assert(memcmp(actualMap, expectedMap, sizeof(expectedMap)) == 0);
+
+        /* Test the compact output map. */
+        const SFUInt32 *actualMap32 = SFAlbumGetCodeunitToGlyphMap32Ptr(&album);
+        const SFUInt32 expectedMap32[] = { 0, 1, 1, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4 };
+        assert(memcmp(actualMap32, expectedMap32, sizeof(expectedMap32)) == 0);
+    }
+
+    /* Test by wrapping up placeholders without arranging. */
+    {
+        SFAlbumReset(&album, NULL, 3);
+
+        SFAlbumBeginFilling(&album);
+        SFAlbumAddGlyph(&album, 100, SFGlyphTraitNone, 0);
+        SFAlbumAddGlyph(&album, 0, SFGlyphTraitPlaceholder, 1);
+        SFAlbumAddGlyph(&album, 300, SFGlyphTraitNone, 2);
+        SFAlbumEndFilling(&album);
+
+        SFAlbumWrapUp(&album);
+
+        /* Test the glyph count. */
+        assert(SFAlbumGetGlyphCount(&album) == 2);
+
+        /* Test the output glyphs. */
+        const SFGlyphID *actualGlyphs = SFAlbumGetGlyphIDsPtr(&album);
+        const SFGlyphID expectedGlyphs[] = { 100, 300 };
+        assert(memcmp(actualGlyphs, expectedGlyphs, sizeof(expectedGlyphs)) == 0);
+
+        /* Test the output map. */
+        const SFUInt32 *actualMap = SFAlbumGetCodeunitToGlyphMap32Ptr(&album);
+        const SFUInt32 expectedMap[] = { 0, 0, 1 };
+        assert(memcmp(actualMap, expectedMap, sizeof(expectedMap)) == 0);
     }
 
     SFAlbumFinalize(&album);
@@ -235,6 +297,440 @@ void AlbumTester::testReserveGlyphs()
     assert(glyphs[19] == 200);
     assert(glyphs[24] == 500);
 
+    /* Test by reserving glyphs back and forth so that the gap is moved in both directions. */
+    {
+        const SFUInteger indexes[] = { 0, 1, 0, 3, 2, 7, 4, 12, 5, 16, 9, 0 };
+        const SFUInteger reserveCount = sizeof(indexes) / sizeof(indexes[0]);
+        SFGlyphID expected[64];
+        SFUInteger glyphCount = 0;
+
+        SFAlbumReset(&album, NULL, 3);
+        SFAlbumBeginFilling(&album);
+
+        for (SFUInteger i = 0; i < reserveCount; i++) {
+            SFUInteger index = indexes[i];
+
+            SFAlbumReserveGlyphsInitialized(&album, index, 2);
+            SFAlbumSetGlyph(&album, index, (SFGlyphID)(i * 2 + 1));
+            SFAlbumSetGlyph(&album, index + 1, (SFGlyphID)(i * 2 + 2));
+
+            memmove(&expected[index + 2], &expected[index], (glyphCount - index) * sizeof(SFGlyphID));
+            expected[index] = (SFGlyphID)(i * 2 + 1);
+            expected[index + 1] = (SFGlyphID)(i * 2 + 2);
+            glyphCount += 2;
+
+            for (SFUInteger j = 0; j < glyphCount; j++) {
+                assert(SFAlbumGetGlyph(&album, j) == expected[j]);
+            }
+        }
+
+        SFAlbumEndFilling(&album);
+        SFAlbumWrapUp(&album);
+
+        assert(SFAlbumGetGlyphCount(&album) == glyphCount);
+        assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), expected, sizeof(SFGlyphID) * glyphCount) == 0);
+    }
+
+    SFAlbumFinalize(&album);
+}
+
+void AlbumTester::testExportGlyphRecords()
+{
+    SFAlbum album;
+    SFAlbumInitialize(&album);
+    SFAlbumReset(&album, NULL, 4);
+
+    SFAlbumBeginFilling(&album);
+    SFAlbumAddGlyph(&album, 10, SFGlyphTraitBase, 0);
+    SFAlbumAddGlyph(&album, 20, SFGlyphTraitPlaceholder, 1);
+    SFAlbumAddGlyph(&album, 30, SFGlyphTraitMark, 1);
+    SFAlbumAddGlyph(&album, 40, SFGlyphTraitBase, 3);
+    SFAlbumEndFilling(&album);
+
+    /* Test by exporting the records of an album which is not positioned. */
+    {
+        SFUInteger glyphCount = album.glyphCount;
+        SFAdvance advances[4] = { -1, -1, -1, -1 };
+        SFGlyphRecordLayout layout = { };
+        layout.advances = advances;
+        layout.advanceStride = sizeof(SFAdvance);
+
+        SFAlbumExportGlyphRecords(&album, &layout, 0, glyphCount);
+        for (SFUInteger i = 0; i < glyphCount; i++) {
+            assert(advances[i] == 0);
+        }
+    }
+
+    SFAlbumBeginArranging(&album);
+    for (SFUInteger i = 0; i < 4; i++) {
+        SFAlbumSetX(&album, i, (SFInt32)i);
+        SFAlbumSetY(&album, i, -(SFInt32)i);
+        SFAlbumSetAdvance(&album, i, (SFAdvance)(i * 100));
+    }
+    SFAlbumEndArranging(&album);
+    SFAlbumWrapUp(&album);
+
+    const SFGlyphID expectedGlyphs[] = { 10, 30, 40 };
+    const SFInt32 expectedX[] = { 0, 2, 3 };
+    const SFAdvance expectedAdvances[] = { 0, 200, 300 };
+    const SFUInt32 expectedClusters[] = { 0, 1, 3 };
+
+    /* Test by exporting into separate arrays. */
+    {
+        SFGlyphID glyphs[3];
+        SFPoint offsets[3];
+        SFAdvance advances[3];
+        SFUInt32 clusters[3];
+
+        SFGlyphRecordLayout layout;
+        layout.glyphIDs = glyphs;
+        layout.glyphIDStride = sizeof(SFGlyphID);
+        layout.offsets = offsets;
+        layout.offsetStride = sizeof(SFPoint);
+        layout.advances = advances;
+        layout.advanceStride = sizeof(SFAdvance);
+        layout.clusters = clusters;
+        layout.clusterStride = sizeof(SFUInt32);
+
+        SFAlbumExportGlyphRecords(&album, &layout, 0, 3);
+
+        for (SFUInteger i = 0; i < 3; i++) {
+            assert(glyphs[i] == expectedGlyphs[i]);
+            assert(offsets[i].x == expectedX[i]);
+            assert(offsets[i].y == -expectedX[i]);
+            assert(advances[i] == expectedAdvances[i]);
+            assert(clusters[i] == expectedClusters[i]);
+        }
+    }
+
+    /* Test by exporting a sub range into interleaved records. */
+    {
+        struct Record {
+            SFGlyphID glyph;
+            SFPoint offset;
+            SFAdvance advance;
+            SFUInt32 cluster;
+        } records[2];
+
+        SFGlyphRecordLayout layout;
+        layout.glyphIDs = &records[0].glyph;
+        layout.glyphIDStride = sizeof(Record);
+        layout.offsets = &records[0].offset;
+        layout.offsetStride = sizeof(Record);
+        layout.advances = NULL;
+        layout.advanceStride = 0;
+        layout.clusters = &records[0].cluster;
+        layout.clusterStride = sizeof(Record);
+
+        records[0].advance = -1;
+        records[1].advance = -1;
+
+        SFAlbumExportGlyphRecords(&album, &layout, 1, 2);
+
+        for (SFUInteger i = 0; i < 2; i++) {
+            assert(records[i].glyph == expectedGlyphs[i + 1]);
+            assert(records[i].offset.x == expectedX[i + 1]);
+            assert(records[i].advance == -1);
+            assert(records[i].cluster == expectedClusters[i + 1]);
+        }
+    }
+
+    SFAlbumFinalize(&album);
+}
+
+void AlbumTester::testSerialization()
+{
+    SFAlbum album;
+    SFAlbumInitialize(&album);
+    SFAlbumReset(&album, NULL, 4);
+
+    SFAlbumBeginFilling(&album);
+    SFAlbumAddGlyph(&album, 10, SFGlyphTraitBase, 0);
+    SFAlbumAddGlyph(&album, 20, SFGlyphTraitPlaceholder, 1);
+    SFAlbumAddGlyph(&album, 30, SFGlyphTraitMark, 1);
+    SFAlbumAddGlyph(&album, 40, SFGlyphTraitBase, 3);
+    SFAlbumMarkUnsafeToBreak(&album, 1, 2);
+    SFAlbumEndFilling(&album);
+    SFAlbumBeginArranging(&album);
+    for (SFUInteger i = 0; i < 4; i++) {
+        SFAlbumSetX(&album, i, (SFInt32)i);
+        SFAlbumSetY(&album, i, -(SFInt32)i);
+        SFAlbumSetAdvance(&album, i, (SFAdvance)(i * 100));
+    }
+    SFAlbumEndArranging(&album);
+    SFAlbumWrapUp(&album);
+
+    SFShapeKey key = { 0x1234, 0x5678 };
+    SFUInteger size = SFAlbumSerialize(&album, &key, NULL, 0);
+    assert(size % 4 == 0);
+
+    SFUInt32 buffer[64];
+    assert(size <= sizeof(buffer));
+    assert(SFAlbumSerialize(&album, &key, buffer, sizeof(buffer)) == size);
+
+    /* Test that the loaded album has the same results. */
+    {
+        SFAlbumRef loaded = SFAlbumCreateFromBuffer(buffer, size, &key);
+        assert(loaded != NULL);
+        assert(SFAlbumGetCodeunitCount(loaded) == 4);
+        assert(SFAlbumGetGlyphCount(loaded) == 3);
+        assert(memcmp(SFAlbumGetGlyphIDsPtr(loaded), SFAlbumGetGlyphIDsPtr(&album), sizeof(SFGlyphID) * 3) == 0);
+        assert(memcmp(SFAlbumGetGlyphOffsetsPtr(loaded), SFAlbumGetGlyphOffsetsPtr(&album), sizeof(SFPoint) * 3) == 0);
+        assert(memcmp(SFAlbumGetGlyphAdvancesPtr(loaded), SFAlbumGetGlyphAdvancesPtr(&album), sizeof(SFAdvance) * 3) == 0);
+        assert(memcmp(SFAlbumGetCodeunitToGlyphMap32Ptr(loaded), SFAlbumGetCodeunitToGlyphMap32Ptr(&album), sizeof(SFUInt32) * 4) == 0);
+        assert(memcmp(SFAlbumGetCodeunitToGlyphMapPtr(loaded), SFAlbumGetCodeunitToGlyphMapPtr(&album), sizeof(SFUInteger) * 4) == 0);
+        assert(SFAlbumIsUnsafeToBreak(loaded, 0) == SFFalse);
+        assert(SFAlbumIsUnsafeToBreak(loaded, 1) == SFTrue);
+        assert(SFAlbumIsUnsafeToBreak(loaded, 2) == SFFalse);
+        SFAlbumRelease(loaded);
+    }
+
+    /* Test that a mismatching key is rejected while a missing one is accepted. */
+    {
+        SFShapeKey other = { 0x1234, 0x5679 };
+        assert(SFAlbumCreateFromBuffer(buffer, size, &other) == NULL);
+
+        /* Test that the whole 64 bits of the text hash are compared. */
+        other.textHash = key.textHash | ((SFUInt64)1 << 40);
+        assert(SFAlbumCreateFromBuffer(buffer, size, &other) == NULL);
+
+        SFAlbumRef loaded = SFAlbumCreateFromBuffer(buffer, size, NULL);
+        assert(loaded != NULL);
+        SFAlbumRelease(loaded);
+    }
+
+    /* Test that truncated and corrupted buffers are rejected. */
+    {
+        assert(SFAlbumCreateFromBuffer(buffer, size - 4, NULL) == NULL);
+        assert(SFAlbumCreateFromBuffer(buffer, 4, NULL) == NULL);
+
+        /* The map of four code units and the clusters of three glyphs follow the eight header fields. */
+        SFUInt32 *indexMap = buffer + 8;
+        SFUInt32 *clusters = indexMap + 4;
+
+        /* Test that a map entry beyond the glyphs is rejected. */
+        SFUInt32 entry = indexMap[1];
+        indexMap[1] = 3;
+        assert(SFAlbumCreateFromBuffer(buffer, size, NULL) == NULL);
+        indexMap[1] = entry;
+
+        /* Test that a cluster beyond the code units is rejected. */
+        SFUInt32 cluster = clusters[2];
+        clusters[2] = 4;
+        assert(SFAlbumCreateFromBuffer(buffer, size, NULL) == NULL);
+        clusters[2] = cluster;
+
+        SFAlbumRef loaded = SFAlbumCreateFromBuffer(buffer, size, NULL);
+        assert(loaded != NULL);
+        SFAlbumRelease(loaded);
+
+        buffer[1] += 1;
+        assert(SFAlbumCreateFromBuffer(buffer, size, NULL) == NULL);
+    }
+
+    /* Test that the shape key follows the input of an artist. */
+    {
+        SFCodepoint first[] = { 'a', 'b' };
+        SFCodepoint second[] = { 'a', 'c' };
+        SFShapeKey firstKey;
+        SFShapeKey secondKey;
+        SFShapeKey repeatKey;
+
+        SFArtistRef artist = SFArtistCreate();
+        SFArtistSetString(artist, SFStringEncodingUTF32, first, 2);
+        SFArtistGetShapeKey(artist, &firstKey);
+        SFArtistSetString(artist, SFStringEncodingUTF32, second, 2);
+        SFArtistGetShapeKey(artist, &secondKey);
+        SFArtistSetString(artist, SFStringEncodingUTF32, first, 2);
+        SFArtistGetShapeKey(artist, &repeatKey);
+
+        assert(firstKey.patternHash == secondKey.patternHash);
+        assert(firstKey.textHash != secondKey.textHash);
+        assert(firstKey.textHash == repeatKey.textHash);
+        assert((firstKey.textHash >> 32) != (secondKey.textHash >> 32));
+
+        /* Test that the code units are not confused between the string and its context. */
+        SFCodepoint joined[] = { 'a', 'b', 'c' };
+        SFShapeKey rangeKey;
+        SFShapeKey shiftedKey;
+
+        SFArtistSetStringRange(artist, SFStringEncodingUTF32, joined, 3, 0, 2);
+        SFArtistGetShapeKey(artist, &rangeKey);
+        SFArtistSetStringRange(artist, SFStringEncodingUTF32, joined, 3, 0, 1);
+        SFArtistGetShapeKey(artist, &shiftedKey);
+        assert(rangeKey.textHash != shiftedKey.textHash);
+
+        SFArtistRelease(artist);
+    }
+
+    SFAlbumFinalize(&album);
+}
+
+static void SFAlbumShapeCountingText(SFAlbumRef album, SFUInteger glyphCount, SFGlyphID firstGlyph)
+{
+    SFAlbumReset(album, NULL, glyphCount);
+    SFAlbumBeginFilling(album);
+    for (SFUInteger i = 0; i < glyphCount; i++) {
+        SFAlbumAddGlyph(album, (SFGlyphID)(firstGlyph + i), SFGlyphTraitBase, i);
+    }
+    SFAlbumEndFilling(album);
+    SFAlbumBeginArranging(album);
+    for (SFUInteger i = 0; i < glyphCount; i++) {
+        SFAlbumSetX(album, i, 0);
+        SFAlbumSetY(album, i, 0);
+        SFAlbumSetAdvance(album, i, (SFAdvance)(firstGlyph + i));
+    }
+    SFAlbumEndArranging(album);
+    SFAlbumWrapUp(album);
+}
+
+void AlbumTester::testCreateCopy()
+{
+    SFAlbumRef album = SFAlbumCreate();
+    SFAlbumShapeCountingText(album, 100, 1);
+
+    /* Test that a copy refers to the same glyph stream. */
+    SFAlbumRef copy = SFAlbumCreateCopy(album);
+    assert(SFAlbumGetGlyphCount(copy) == 100);
+    assert(SFAlbumGetCodeunitCount(copy) == 100);
+    assert(SFAlbumGetGlyphIDsPtr(copy) == SFAlbumGetGlyphIDsPtr(album));
+    assert(SFAlbumGetGlyphAdvancesPtr(copy) == SFAlbumGetGlyphAdvancesPtr(album));
+    assert(SFAlbumGetCodeunitToGlyphMap32Ptr(copy) == SFAlbumGetCodeunitToGlyphMap32Ptr(album));
+
+    /* Test that reshaping the copy leaves the original intact. */
+    SFAlbumShapeCountingText(copy, 80, 500);
+    assert(SFAlbumGetGlyphIDsPtr(copy) != SFAlbumGetGlyphIDsPtr(album));
+    assert(SFAlbumGetGlyphIDsPtr(copy)[0] == 500);
+    assert(SFAlbumGetGlyphCount(album) == 100);
+    for (SFUInteger i = 0; i < 100; i++) {
+        assert(SFAlbumGetGlyphIDsPtr(album)[i] == i + 1);
+        assert(SFAlbumGetGlyphAdvancesPtr(album)[i] == (SFAdvance)(i + 1));
+        assert(SFAlbumGetCodeunitToGlyphMap32Ptr(album)[i] == i);
+    }
+    SFAlbumRelease(copy);
+
+    /* Test that the original takes its storage back once the copy is gone. */
+    SFAlbumShapeCountingText(album, 100, 1);
+    assert(SFAlbumGetAllocationCount(album) == 0);
+
+    SFAlbumRelease(album);
+
+    /* Test that short texts are copied from inline storage. */
+    album = SFAlbumCreate();
+    SFAlbumShapeCountingText(album, 4, 1);
+    copy = SFAlbumCreateCopy(album);
+    assert(album->_share == NULL);
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(copy), SFAlbumGetGlyphIDsPtr(album), sizeof(SFGlyphID) * 4) == 0);
+    SFAlbumRelease(copy);
+
+    SFAlbumRelease(album);
+}
+
+void AlbumTester::testAllocationCount()
+{
+    SFAllocatorProtocol protocol;
+    protocol.allocate = SFCountingAllocate;
+    protocol.reallocate = SFCountingReallocate;
+    protocol.deallocate = SFCountingDeallocate;
+
+    SFUInteger allocatorCount = 0;
+    SFAllocatorSetProtocol(&protocol, &allocatorCount);
+
+    SFAlbum album;
+    SFAlbumInitialize(&album);
+
+    /* Test that the first shaping call goes through the allocator. */
+    SFAlbumShapeDummyText(&album, 64);
+    assert(SFAlbumGetAllocationCount(&album) > 0);
+    assert(allocatorCount >= SFAlbumGetAllocationCount(&album));
+
+    /* Test that the storage is reused by the subsequent calls. */
+    {
+        SFUInteger previousCount = allocatorCount;
+
+        SFAlbumShapeDummyText(&album, 64);
+        assert(SFAlbumGetAllocationCount(&album) == 0);
+
+        SFAlbumShapeDummyText(&album, 32);
+        assert(SFAlbumGetAllocationCount(&album) == 0);
+
+        assert(allocatorCount == previousCount);
+    }
+
+    /* Test that the results of a short text are kept in the inline storage of the album. */
+    {
+        SFAlbum shortAlbum;
+        SFAlbumInitialize(&shortAlbum);
+
+        SFAlbumShapeDummyText(&shortAlbum, 16);
+        assert(SFAlbumGetGlyphIDsPtr(&shortAlbum) == shortAlbum._inline.glyphs);
+        assert(SFAlbumGetGlyphAdvancesPtr(&shortAlbum) == shortAlbum._inline.advances);
+
+        /* Test that the lists allocated on first use are kept for the next text. */
+        SFUInteger previousCount = allocatorCount;
+
+        SFAlbumShapeDummyText(&shortAlbum, 16);
+        assert(SFAlbumGetAllocationCount(&shortAlbum) == 0);
+        assert(allocatorCount == previousCount);
+
+        SFAlbumFinalize(&shortAlbum);
+    }
+
+    SFAlbumFinalize(&album);
+    SFAllocatorSetProtocol(NULL, NULL);
+}
+
+void AlbumTester::testMemoryUsage()
+{
+    SFAlbum album;
+    SFAlbumInitialize(&album);
+
+    /* Test that a short text uses the heap only for the lists without inline buffers. */
+    SFAlbumShapeDummyText(&album, 16);
+    SFUInteger shortUsage = SFAlbumGetMemoryUsage(&album);
+    assert(shortUsage > 0);
+    assert(SFAlbumGetPeakMemoryUsage(&album) == shortUsage);
+    assert(SFAlbumGetGlyphIDsPtr(&album) == album._inline.glyphs);
+
+    /* Test that a long text grows the memory. */
+    SFAlbumShapeDummyText(&album, 1024);
+    SFUInteger longUsage = SFAlbumGetMemoryUsage(&album);
+    assert(longUsage > shortUsage);
+    assert(SFAlbumGetPeakMemoryUsage(&album) >= longUsage);
+
+    /* Test that the memory is retained without a limit. */
+    SFAlbumShapeDummyText(&album, 16);
+    assert(SFAlbumGetMemoryUsage(&album) == longUsage);
+
+    SFAlbumSetRetainedCapacityLimit(&album, 4096);
+
+    /* Test that the memory is shrunk to what the new text needs if it does not fit in the limit. */
+    SFAlbumShapeDummyText(&album, 512);
+    SFUInteger shrunkUsage = SFAlbumGetMemoryUsage(&album);
+    assert(shrunkUsage < longUsage);
+    assert(shrunkUsage > 4096);
+
+    /* Test that the memory is shrunk to the limit if the new text needs more than half of it. */
+    SFAlbumShapeDummyText(&album, 64);
+    assert(SFAlbumGetMemoryUsage(&album) > 0);
+    assert(SFAlbumGetMemoryUsage(&album) <= 4096);
+
+    /* Test that the memory within the limit is retained for a shorter text. */
+    SFUInteger limitedUsage = SFAlbumGetMemoryUsage(&album);
+    SFAlbumShapeDummyText(&album, 16);
+    assert(SFAlbumGetMemoryUsage(&album) == limitedUsage);
+    assert(SFAlbumGetPeakMemoryUsage(&album) >= longUsage);
+
+    /* Test that the lists return to their inline buffers without any limit. */
+    SFAlbumSetRetainedCapacityLimit(&album, 0);
+    SFAlbumShapeDummyText(&album, 16);
+    assert(SFAlbumGetMemoryUsage(&album) <= shortUsage);
+    assert(SFAlbumGetGlyphIDsPtr(&album) == album._inline.glyphs);
+
+    /* Test that the lists without inline buffers are released for an empty text. */
+    SFAlbumReset(&album, NULL, 0);
+    assert(SFAlbumGetMemoryUsage(&album) == 0);
+
     SFAlbumFinalize(&album);
 }
 
@@ -442,6 +938,13 @@ void AlbumTester::testFeatureMask()
     assert(SFAlbumGetFeatureMask(&album, 4) == mask5);
 
     SFAlbumEndFilling(&album);
+
+    /* Test that wrapping up clears the feature masks, leaving the glyphs with the first font. */
+    SFAlbumWrapUp(&album);
+    for (SFUInteger i = 0; i < 5; i++) {
+        assert(SFAlbumGetFontIndex(&album, i) == 0);
+    }
+
     SFAlbumFinalize(&album);
 }
 
@@ -642,6 +1145,11 @@ void AlbumTester::test()
     testReset();
     testAddGlyph();
     testReserveGlyphs();
+    testExportGlyphRecords();
+    testSerialization();
+    testCreateCopy();
+    testAllocationCount();
+    testMemoryUsage();
     testSetGlyph();
     testGetGlyph();
     testSetAssociation();
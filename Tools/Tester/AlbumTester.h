@@ -28,6 +28,11 @@ public:
     void testReset();
     void testAddGlyph();
     void testReserveGlyphs();
+    void testExportGlyphRecords();
+    void testSerialization();
+    void testCreateCopy();
+    void testAllocationCount();
+    void testMemoryUsage();
     void testSetGlyph();
     void testGetGlyph();
     void testSetAssociation();
@@ -0,0 +1,1223 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <SFAllocator.h>
+#include <Source/SFAlbum.h>
+#include <Source/SFArabicEngine.h>
+#include <Source/SFArtist.h>
+#include <Source/SFFont.h>
+#include <Source/SFPattern.h>
+#include <Source/SFPatternBuilder.h>
+#include <Source/SFShapeCache.h>
+}
+
+#include "OpenType/Builder.h"
+#include "OpenType/Common.h"
+#include "OpenType/GDEF.h"
+#include "OpenType/GSUB.h"
+#include "OpenType/Writer.h"
+#include "ArtistTester.h"
+
+using namespace std;
+using namespace SheenFigure::Tester;
+using namespace SheenFigure::Tester::OpenType;
+
+static const Glyph BehLetter = 0x0628;
+static const Glyph FathaMark = 0x064E;
+static const Glyph IsolatedBeh = 1;
+static const Glyph InitialBeh = 2;
+static const Glyph MedialBeh = 3;
+static const Glyph FinalBeh = 4;
+static const Glyph AcuteMark = 0x0301;
+
+struct MarkFontTables {
+    Writer gsub;
+    Writer gdef;
+};
+
+static void loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    Writer *writer = reinterpret_cast<Writer *>(object);
+
+    if (tag == SFTagMake('G', 'S', 'U', 'B')) {
+        if (buffer) {
+            memcpy(buffer, writer->data(), writer->size());
+        }
+        if (length) {
+            *length = (SFUInteger)writer->size();
+        }
+    } else if (length) {
+        *length = 0;
+    }
+}
+
+static void loadMarkFontTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    MarkFontTables *tables = reinterpret_cast<MarkFontTables *>(object);
+
+    if (tag == SFTagMake('G', 'D', 'E', 'F')) {
+        if (buffer) {
+            memcpy(buffer, tables->gdef.data(), tables->gdef.size());
+        }
+        if (length) {
+            *length = (SFUInteger)tables->gdef.size();
+        }
+    } else {
+        loadTable(&tables->gsub, tag, buffer, length);
+    }
+}
+
+static SFGlyphID getGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)codepoint;
+}
+
+static SFGlyphID getASCIIGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)(codepoint < 0x80 ? codepoint : 0);
+}
+
+static SFGlyphID getArabicGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)(codepoint >= 0x0600 && codepoint <= 0x06FF ? codepoint : 0);
+}
+
+static SFAdvance getAdvance(void *object, SFFontLayout fontLayout, SFGlyphID glyphID)
+{
+    return glyphID * 10;
+}
+
+static void initializeLookup(LookupTable &lookup, LookupSubtable &subtable, LookupFlag lookupFlag)
+{
+    lookup.lookupType = subtable.lookupType();
+    lookup.lookupFlag = lookupFlag;
+    lookup.subTableCount = 1;
+    lookup.subtables = &subtable;
+    lookup.markFilteringSet = 0;
+}
+
+static void writeTable(Writer &writer, const vector<LookupSubtable *> &subtables,
+    LookupFlag lookupFlag = (LookupFlag)0)
+{
+    vector<LookupTable> lookups(subtables.size());
+    for (size_t i = 0; i < subtables.size(); i++) {
+        initializeLookup(lookups[i], *subtables[i], lookupFlag);
+    }
+
+    LookupListTable lookupList;
+    lookupList.lookupCount = (UInt16)lookups.size();
+    lookupList.lookupTables = lookups.data();
+
+    ScriptListTable scriptList;
+    scriptList.scriptCount = 0;
+    scriptList.scriptRecord = NULL;
+
+    FeatureListTable featureList;
+    featureList.featureCount = 0;
+    featureList.featureRecord = NULL;
+
+    GSUB gsub;
+    gsub.version = 0x00010000;
+    gsub.scriptList = &scriptList;
+    gsub.featureList = &featureList;
+    gsub.lookupList = &lookupList;
+
+    writer.write(&gsub);
+}
+
+static void writeLatinTable(Writer &writer, Builder &builder)
+{
+    /* Create the ligatures, and a chain context substituting 'a' between 'x' and 'b'. */
+    writeTable(writer, {
+        &builder.createLigatureSubst({
+            {{ 'f', 'i' }, 500},
+            {{ 'f', 'f', 'i' }, 501}
+        }),
+        &builder.createChainContext({
+            rule_chain_context { { 'x' }, { 'a' }, { 'b' }, { {0, 2} } }
+        }),
+        &builder.createSingleSubst({ 'a' }, 500)
+    });
+}
+
+static void writeCascadeTable(Writer &writer, Builder &builder)
+{
+    /* Turn each 'a' after an 'x' into an 'x', and ligate an 'x' with a following 'b'. */
+    writeTable(writer, {
+        &builder.createChainContext({
+            rule_chain_context { { 'x' }, { 'a' }, { }, { {0, 2} } }
+        }),
+        &builder.createLigatureSubst({
+            {{ 'x', 'b' }, 700}
+        }),
+        &builder.createSingleSubst({ {'a', 'x'} })
+    });
+}
+
+static void writeMarkTables(MarkFontTables &tables, Builder &builder)
+{
+    /* Substitute 'a' between 'x' and 'b' skipping the marks, with a ligature which never forms. */
+    writeTable(tables.gsub, {
+        &builder.createChainContext({
+            rule_chain_context { { 'x' }, { 'a' }, { 'b' }, { {0, 2} } }
+        }),
+        &builder.createLigatureSubst({
+            {{ 'q', 'q' }, 600}
+        }),
+        &builder.createSingleSubst({ 'a' }, 500)
+    }, LookupFlag::IgnoreMarks);
+
+    /* Classify the acute as a mark. */
+    GDEF gdef;
+    gdef.version = 0x00010000;
+    gdef.glyphClassDef = &builder.createClassDef(AcuteMark, 1, { 3 });
+    gdef.attachList = NULL;
+    gdef.ligCaretList = NULL;
+    gdef.markAttachClassDef = NULL;
+    gdef.markGlyphSetsDef = NULL;
+
+    tables.gdef.write(&gdef);
+}
+
+static void writeSpaceTable(Writer &writer, Builder &builder)
+{
+    /* Create a ligature of the space with 'z', so that the words affect each other. */
+    writeTable(writer, {
+        &builder.createLigatureSubst({
+            {{ ' ', 'z' }, 600}
+        }),
+        &builder.createLigatureSubst({
+            {{ 'f', 'i' }, 500}
+        })
+    });
+}
+
+static void writeArabicTable(Writer &writer, Builder &builder)
+{
+    /* Substitute each joining form of beh with a glyph of its own. */
+    writeTable(writer, {
+        &builder.createSingleSubst({ {BehLetter, IsolatedBeh} }),
+        &builder.createSingleSubst({ {BehLetter, InitialBeh} }),
+        &builder.createSingleSubst({ {BehLetter, MedialBeh} }),
+        &builder.createSingleSubst({ {BehLetter, FinalBeh} })
+    });
+}
+
+static SFFontRef createFont(Writer &writer, SFFontProtocolGetGlyphIDForCodepointFunc glyphIDFunc = &getGlyphID)
+{
+    SFFontProtocol protocol = {
+        .finalize = NULL,
+        .loadTable = &loadTable,
+        .getGlyphIDForCodepoint = glyphIDFunc,
+        .getAdvanceForGlyph = &getAdvance,
+    };
+
+    return SFFontCreateWithProtocol(&protocol, &writer);
+}
+
+static SFPatternRef createPattern(SFFontRef font)
+{
+    SFPatternRef pattern = SFPatternCreate();
+
+    SFPatternBuilder builder;
+    SFPatternBuilderInitialize(&builder, pattern);
+    SFPatternBuilderSetFont(&builder, font);
+    SFPatternBuilderSetScript(&builder, SFTagMake('l', 'a', 't', 'n'), SFTextDirectionLeftToRight);
+    SFPatternBuilderSetLanguage(&builder, SFTagMake('d', 'f', 'l', 't'));
+    SFPatternBuilderBeginFeatures(&builder, SFFeatureKindSubstitution);
+    SFPatternBuilderAddFeature(&builder, SFTagMake('l', 'i', 'g', 'a'), 0);
+    SFPatternBuilderAddLookup(&builder, 0);
+    SFPatternBuilderAddLookup(&builder, 1);
+    SFPatternBuilderMakeFeatureUnit(&builder);
+    SFPatternBuilderEndFeatures(&builder);
+    SFPatternBuilderBuild(&builder);
+    SFPatternBuilderFinalize(&builder);
+
+    return pattern;
+}
+
+static SFPatternRef createArabicPattern(SFFontRef font)
+{
+    SFPatternRef pattern = SFPatternCreate();
+
+    /* Apply each form with the mask which the arabic engine puts for it. */
+    SFTag featureTags[] = {
+        SFTagMake('i', 's', 'o', 'l'), SFTagMake('i', 'n', 'i', 't'),
+        SFTagMake('m', 'e', 'd', 'i'), SFTagMake('f', 'i', 'n', 'a')
+    };
+    SFUInt16 featureMasks[] = { 1 << 0, 1 << 1, 1 << 2, 1 << 3 };
+
+    SFPatternBuilder builder;
+    SFPatternBuilderInitialize(&builder, pattern);
+    SFPatternBuilderSetFont(&builder, font);
+    SFPatternBuilderSetScript(&builder, SFTagMake('a', 'r', 'a', 'b'), SFTextDirectionRightToLeft);
+    SFPatternBuilderSetLanguage(&builder, SFTagMake('d', 'f', 'l', 't'));
+    SFPatternBuilderBeginFeatures(&builder, SFFeatureKindSubstitution);
+    for (SFUInt16 index = 0; index < 4; index++) {
+        SFPatternBuilderAddFeature(&builder, featureTags[index], featureMasks[index]);
+        SFPatternBuilderAddLookup(&builder, index);
+        SFPatternBuilderMakeFeatureUnit(&builder);
+    }
+    SFPatternBuilderEndFeatures(&builder);
+    SFPatternBuilderBuild(&builder);
+    SFPatternBuilderFinalize(&builder);
+
+    return pattern;
+}
+
+static void assertSameAlbums(SFAlbumRef album1, SFAlbumRef album2)
+{
+    SFUInteger glyphCount = SFAlbumGetGlyphCount(album1);
+    SFUInteger codeunitCount = SFAlbumGetCodeunitCount(album1);
+
+    assert(SFAlbumGetGlyphCount(album2) == glyphCount);
+    assert(SFAlbumGetCodeunitCount(album2) == codeunitCount);
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(album1), SFAlbumGetGlyphIDsPtr(album2), sizeof(SFGlyphID) * glyphCount) == 0);
+    assert(memcmp(SFAlbumGetCodeunitToGlyphMap32Ptr(album1), SFAlbumGetCodeunitToGlyphMap32Ptr(album2), sizeof(SFUInt32) * codeunitCount) == 0);
+
+    /* The glyphs are positioned only if both albums were shaped completely. */
+    if (SFAlbumGetGlyphAdvancesPtr(album1)) {
+        assert(memcmp(SFAlbumGetGlyphOffsetsPtr(album1), SFAlbumGetGlyphOffsetsPtr(album2), sizeof(SFPoint) * glyphCount) == 0);
+        assert(memcmp(SFAlbumGetGlyphAdvancesPtr(album1), SFAlbumGetGlyphAdvancesPtr(album2), sizeof(SFAdvance) * glyphCount) == 0);
+    } else {
+        assert(SFAlbumGetGlyphAdvancesPtr(album2) == NULL);
+    }
+
+    for (SFUInteger index = 0; index < glyphCount; index++) {
+        assert(SFAlbumIsUnsafeToBreak(album1, index) == SFAlbumIsUnsafeToBreak(album2, index));
+    }
+}
+
+static void shapeText(SFArtistRef artist, SFAlbumRef album, const string &text)
+{
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)text.data(), text.length());
+    SFArtistFillAlbum(artist, album);
+}
+
+static void shapeRange(SFArtistRef artist, SFAlbumRef album, const string &text, SFUInteger index, SFUInteger length)
+{
+    SFArtistSetStringRange(artist, SFStringEncodingUTF8, (void *)text.data(), text.length(), index, length);
+    SFArtistFillAlbum(artist, album);
+}
+
+static void assertGlyphs(SFAlbumRef album, const vector<SFGlyphID> &glyphs)
+{
+    assert(SFAlbumGetGlyphCount(album) == glyphs.size());
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(album), glyphs.data(), sizeof(SFGlyphID) * glyphs.size()) == 0);
+}
+
+/**
+ * Asserts that a range has been shaped with the same glyphs as its code units get in the whole text.
+ */
+static void assertSameRange(SFAlbumRef whole, SFAlbumRef range, SFUInteger index, SFUInteger length)
+{
+    const SFGlyphID *glyphIDs = SFAlbumGetGlyphIDsPtr(range);
+    const SFAdvance *advances = SFAlbumGetGlyphAdvancesPtr(range);
+    SFUInteger glyphCount = SFAlbumGetGlyphCount(range);
+    SFUInteger rangeIndex = 0;
+
+    assert(SFAlbumGetCodeunitCount(range) == length);
+
+    for (SFUInteger wholeIndex = 0; wholeIndex < SFAlbumGetGlyphCount(whole); wholeIndex++) {
+        SFUInteger association = SFAlbumGetAssociation(whole, wholeIndex);
+
+        if (association >= index && association < index + length) {
+            assert(rangeIndex < glyphCount);
+            assert(glyphIDs[rangeIndex] == SFAlbumGetGlyphIDsPtr(whole)[wholeIndex]);
+            assert(advances[rangeIndex] == SFAlbumGetGlyphAdvancesPtr(whole)[wholeIndex]);
+            assert(SFAlbumGetAssociation(range, rangeIndex) == association - index);
+            rangeIndex += 1;
+        }
+    }
+
+    assert(rangeIndex == glyphCount);
+}
+
+/**
+ * Runs the tasks one after another in reverse order, counting them.
+ */
+static void runTasksInReverse(void *object, SFArtistTaskFunc function, void **tasks, SFUInteger taskCount)
+{
+    SFUInteger *counter = (SFUInteger *)object;
+
+    for (SFUInteger index = taskCount; index > 0; index--) {
+        function(tasks[index - 1]);
+    }
+
+    *counter += taskCount;
+}
+
+static void fillConcurrently(SFArtistRef artist, SFAlbumRef album, const string &text, SFUInteger chunkLength, SFUInteger &taskCount)
+{
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)text.data(), text.length());
+    SFArtistFillAlbumConcurrently(artist, album, chunkLength, &runTasksInReverse, &taskCount);
+}
+
+static void *countingAllocate(void *object, SFUInteger size)
+{
+    (*(SFUInteger *)object)++;
+    return malloc(size);
+}
+
+static void *countingReallocate(void *object, void *pointer, SFUInteger size)
+{
+    (*(SFUInteger *)object)++;
+    return realloc(pointer, size);
+}
+
+static void countingDeallocate(void *object, void *pointer)
+{
+    free(pointer);
+}
+
+ArtistTester::ArtistTester()
+{
+}
+
+void ArtistTester::testIncrementalUpdate()
+{
+    Builder builder;
+    Writer writer;
+    writeLatinTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+    SFPatternRef pattern = createPattern(font);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef updated = SFAlbumCreate();
+    SFAlbumRef shaped = SFAlbumCreate();
+
+    /* Test that the pattern knows the longest context of its lookups. */
+    assert(SFPatternGetContextLength(pattern) == 3);
+
+    SFArtistSetPattern(artist, pattern);
+
+    const string text = "xab ffi fixab xfib";
+    const char *insertions[] = { "", "i", "fi", "xa" };
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+
+    /* Test that every small edit updates the album in the same way as shaping the edited text. */
+    for (SFTextMode textMode : textModes) {
+        SFArtistSetTextMode(artist, textMode);
+
+        for (size_t index = 0; index <= text.length(); index++) {
+            for (size_t removal = 0; removal <= 2 && index + removal <= text.length(); removal++) {
+                for (const char *insertion : insertions) {
+                    string edited = text;
+                    edited.replace(index, removal, insertion);
+
+                    shapeText(artist, updated, text);
+
+                    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)edited.data(), edited.length());
+                    SFArtistUpdateAlbum(artist, updated, index, removal, strlen(insertion));
+
+                    shapeText(artist, shaped, edited);
+                    assertSameAlbums(shaped, updated);
+                }
+            }
+        }
+    }
+
+    /* Test that updating an album leaves the results of its copy intact. */
+    SFArtistSetTextMode(artist, SFTextModeForward);
+    shapeText(artist, updated, text);
+    SFAlbumRef copy = SFAlbumCreateCopy(updated);
+
+    string edited = text;
+    edited.replace(4, 1, "xa");
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)edited.data(), edited.length());
+    SFArtistUpdateAlbum(artist, updated, 4, 1, 2);
+
+    shapeText(artist, shaped, edited);
+    assertSameAlbums(shaped, updated);
+    shapeText(artist, shaped, text);
+    assertSameAlbums(shaped, copy);
+
+    SFAlbumRelease(copy);
+    SFAlbumRelease(shaped);
+    SFAlbumRelease(updated);
+    SFArtistRelease(artist);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+
+    /* Test that a ligature straddling an edge of the window makes the whole text shaped again. */
+    {
+        Builder cascadeBuilder;
+        Writer cascadeWriter;
+        writeCascadeTable(cascadeWriter, cascadeBuilder);
+
+        SFFontRef cascadeFont = createFont(cascadeWriter);
+        SFPatternRef cascadePattern = createPattern(cascadeFont);
+        SFArtistRef cascadeArtist = SFArtistCreate();
+        SFAlbumRef cascadeUpdated = SFAlbumCreate();
+        SFAlbumRef cascadeShaped = SFAlbumCreate();
+
+        /* The edit carries over all 'a's, so the last one ligates with the 'b' past the window. */
+        const string oldText = "yaaab";
+        const string newText = "xaaab";
+
+        assert(SFPatternGetContextLength(cascadePattern) == 2);
+        SFArtistSetPattern(cascadeArtist, cascadePattern);
+
+        shapeText(cascadeArtist, cascadeShaped, newText);
+        assertGlyphs(cascadeShaped, { 'x', 'x', 'x', 700 });
+
+        shapeText(cascadeArtist, cascadeUpdated, oldText);
+        SFArtistSetString(cascadeArtist, SFStringEncodingUTF8, (void *)newText.data(), newText.length());
+        SFArtistUpdateAlbum(cascadeArtist, cascadeUpdated, 0, 1, 1);
+        assertSameAlbums(cascadeShaped, cascadeUpdated);
+
+        SFAlbumRelease(cascadeShaped);
+        SFAlbumRelease(cascadeUpdated);
+        SFArtistRelease(cascadeArtist);
+        SFPatternRelease(cascadePattern);
+        SFFontRelease(cascadeFont);
+    }
+}
+
+void ArtistTester::testUpdateFallback()
+{
+    Builder builder;
+    Writer writer;
+    writeLatinTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+    SFPatternRef pattern = createPattern(font);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef updated = SFAlbumCreate();
+    SFAlbumRef shaped = SFAlbumCreate();
+    const string text = "fixab";
+    const string edited = "ffixab";
+
+    SFArtistSetPattern(artist, pattern);
+
+    /* Test that an album which was never filled is filled with the whole text. */
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)edited.data(), edited.length());
+    SFArtistUpdateAlbum(artist, updated, 0, 0, 1);
+    shapeText(artist, shaped, edited);
+    assertSameAlbums(shaped, updated);
+
+    /* Test that an edit not fitting the text of the album shapes the whole text. */
+    shapeText(artist, updated, text);
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)edited.data(), edited.length());
+    SFArtistUpdateAlbum(artist, updated, 0, 0, 2);
+    assertSameAlbums(shaped, updated);
+
+    /* Test that an album shaped in another shaping mode is filled with the whole text. */
+    SFShapingMode shapingModes[] = { SFShapingModeComplete, SFShapingModeSubstitutionOnly };
+    for (SFShapingMode shapingMode : shapingModes) {
+        SFShapingMode otherMode = (shapingMode == SFShapingModeComplete
+                                   ? SFShapingModeSubstitutionOnly : SFShapingModeComplete);
+
+        SFArtistSetShapingMode(artist, otherMode);
+        shapeText(artist, updated, text);
+
+        SFArtistSetShapingMode(artist, shapingMode);
+        SFArtistSetString(artist, SFStringEncodingUTF8, (void *)edited.data(), edited.length());
+        SFArtistUpdateAlbum(artist, updated, 0, 0, 1);
+
+        shapeText(artist, shaped, edited);
+        assertSameAlbums(shaped, updated);
+    }
+
+    SFAlbumRelease(shaped);
+    SFAlbumRelease(updated);
+    SFArtistRelease(artist);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ArtistTester::testLookupContext()
+{
+    Builder builder;
+    Writer writer;
+    writeLatinTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+    SFPatternRef pattern = createPattern(font);
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 1, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+    SFAlbumRef whole = SFAlbumCreate();
+    const Glyph SubstitutedA = 'a' + 500;
+
+    SFArtistSetPattern(artist, pattern);
+    SFArtistSetShapeCache(artist, cache);
+
+    /* Test that a chain context matches its backtrack and lookahead in the context. */
+    shapeRange(artist, album, "xab", 1, 1);
+    assertGlyphs(album, { SubstitutedA });
+    assert(SFAlbumGetCodeunitCount(album) == 1);
+    assert(SFAlbumGetAssociation(album, 0) == 0);
+
+    shapeRange(artist, album, "xab", 0, 2);
+    assertGlyphs(album, { 'x', SubstitutedA });
+
+    /* Test that the same code units are not substituted without the context. */
+    shapeText(artist, album, "ab");
+    assertGlyphs(album, { 'a', 'b' });
+
+    /* Test that a ligature is not formed across the edges of a range. */
+    shapeRange(artist, album, "fi", 1, 1);
+    assertGlyphs(album, { 'i' });
+    shapeRange(artist, album, "fi", 0, 1);
+    assertGlyphs(album, { 'f' });
+
+    /* Test that the ranges take the glyphs of the whole text in either mode. */
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+    for (SFTextMode textMode : textModes) {
+        const string text = "xab xfi";
+        SFArtistSetTextMode(artist, textMode);
+        shapeText(artist, whole, text);
+
+        for (SFUInteger index = 0; index < text.length(); index++) {
+            for (SFUInteger length = 1; index + length <= text.length(); length++) {
+                /* The ligature is not split by the ranges. */
+                if (index == 6 || index + length == 6) {
+                    continue;
+                }
+
+                shapeRange(artist, album, text, index, length);
+                assertSameRange(whole, album, index, length);
+            }
+        }
+    }
+
+    /* Test that the words of a range are segmented in the same way as the whole range is shaped. */
+    SFArtistSetTextMode(artist, SFTextModeForward);
+    SFArtistSetSegmentationMode(artist, SFSegmentationModeWords);
+    shapeRange(artist, album, "xab xab", 1, 5);
+
+    SFArtistSetSegmentationMode(artist, SFSegmentationModeNone);
+    shapeRange(artist, whole, "xab xab", 1, 5);
+    assertSameAlbums(whole, album);
+    assertGlyphs(album, { SubstitutedA, 'b', ' ', 'x', SubstitutedA });
+
+    /* Test that only the results not depending on a context are cached. */
+    SFUInteger missCount = SFShapeCacheGetMissCount(cache);
+    shapeRange(artist, album, "xab", 1, 1);
+    shapeRange(artist, album, "ba", 0, 2);
+    assert(SFShapeCacheGetMissCount(cache) == missCount + 1);
+
+    /* Test that the context reaches past the marks which the lookups skip. */
+    {
+        Builder markBuilder;
+        MarkFontTables markTables;
+        writeMarkTables(markTables, markBuilder);
+
+        SFFontProtocol protocol = {
+            .finalize = NULL,
+            .loadTable = &loadMarkFontTable,
+            .getGlyphIDForCodepoint = &getGlyphID,
+            .getAdvanceForGlyph = &getAdvance,
+        };
+        SFFontRef markFont = SFFontCreateWithProtocol(&protocol, &markTables);
+        SFPatternRef markPattern = createPattern(markFont);
+
+        /* Three acutes between 'x' and 'a', each taking two bytes in UTF-8. */
+        const string text = "x\xCC\x81\xCC\x81\xCC\x81" "ab";
+
+        SFArtistSetPattern(artist, markPattern);
+
+        shapeText(artist, whole, text);
+        assertGlyphs(whole, { 'x', AcuteMark, AcuteMark, AcuteMark, SubstitutedA, 'b' });
+        shapeRange(artist, album, text, 7, 1);
+        assertGlyphs(album, { SubstitutedA });
+        shapeRange(artist, album, text, 0, 3);
+        assertSameRange(whole, album, 0, 3);
+
+        SFPatternRelease(markPattern);
+        SFFontRelease(markFont);
+    }
+
+    SFAlbumRelease(whole);
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ArtistTester::testJoiningContext()
+{
+    Builder builder;
+    Writer writer;
+    writeArabicTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+    SFPatternRef pattern = createArabicPattern(font);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+    SFAlbumRef whole = SFAlbumCreate();
+
+    /* Four behs with a fatha after the second one, each taking two bytes in UTF-8. */
+    const string text = "\xD8\xA8\xD8\xA8\xD9\x8E\xD8\xA8\xD8\xA8";
+
+    SFArtistSetPattern(artist, pattern);
+
+    /* Test that the forms are decided by the characters around the range. */
+    shapeText(artist, whole, text);
+    assertGlyphs(whole, { InitialBeh, MedialBeh, FathaMark, MedialBeh, FinalBeh });
+
+    shapeRange(artist, album, text, 2, 2);
+    assertGlyphs(album, { MedialBeh });
+    shapeRange(artist, album, text, 6, 4);
+    assertGlyphs(album, { MedialBeh, FinalBeh });
+    shapeText(artist, album, text.substr(2, 2));
+    assertGlyphs(album, { IsolatedBeh });
+
+    /* Test that the joined characters are unsafe to break apart in either mode. */
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+    for (SFTextMode textMode : textModes) {
+        SFArtistSetTextMode(artist, textMode);
+
+        shapeText(artist, album, text);
+        assert(SFAlbumIsUnsafeToBreak(album, 0) == SFFalse);
+        for (SFUInteger index = 1; index < SFAlbumGetGlyphCount(album); index++) {
+            assert(SFAlbumIsUnsafeToBreak(album, index) == SFTrue);
+        }
+
+        /* Two behs with a space between them, which joins neither of them. */
+        shapeText(artist, album, "\xD8\xA8 \xD8\xA8");
+        for (SFUInteger index = 0; index < SFAlbumGetGlyphCount(album); index++) {
+            assert(SFAlbumIsUnsafeToBreak(album, index) == SFFalse);
+        }
+    }
+    SFArtistSetTextMode(artist, SFTextModeForward);
+
+    /* Test that every range takes the forms of the whole text in either mode. */
+    for (SFTextMode textMode : textModes) {
+        SFArtistSetTextMode(artist, textMode);
+        shapeText(artist, whole, text);
+
+        for (SFUInteger index = 0; index < text.length(); index += 2) {
+            for (SFUInteger length = 2; index + length <= text.length(); length += 2) {
+                shapeRange(artist, album, text, index, length);
+                assertSameRange(whole, album, index, length);
+            }
+        }
+    }
+
+    /* Test that the forms are the same when the code points are read without decoded records. */
+    for (SFTextMode textMode : textModes) {
+        SFArabicEngine arabicEngine;
+        SFCodepoints codepoints;
+
+        SFArtistSetTextMode(artist, textMode);
+        shapeText(artist, whole, text);
+
+        SFArabicEngineInitialize(&arabicEngine, artist);
+        SFCodepointsInitialize(&codepoints, &artist->codepointSequence, textMode == SFTextModeBackward);
+        SFAlbumReset(album, &codepoints, text.length());
+        SFShapingEngineProcessAlbum((SFShapingEngineRef)&arabicEngine, album);
+        assertSameAlbums(whole, album);
+    }
+
+    SFAlbumRelease(whole);
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ArtistTester::testConcurrentFill()
+{
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+    const string text = "xab fi  ffi xab xfi ab fffi";
+
+    /* Test that the chunks are joined into the same album as the whole text is shaped into. */
+    {
+        Builder builder;
+        Writer writer;
+        writeLatinTable(writer, builder);
+
+        SFFontRef font = createFont(writer);
+        SFPatternRef pattern = createPattern(font);
+        SFArtistRef artist = SFArtistCreate();
+        SFAlbumRef album = SFAlbumCreate();
+        SFAlbumRef whole = SFAlbumCreate();
+
+        SFArtistSetPattern(artist, pattern);
+
+        for (SFTextMode textMode : textModes) {
+            SFArtistSetTextMode(artist, textMode);
+            shapeText(artist, whole, text);
+
+            for (SFUInteger chunkLength = 1; chunkLength <= text.length(); chunkLength++) {
+                SFUInteger taskCount = 0;
+                fillConcurrently(artist, album, text, chunkLength, taskCount);
+                assertSameAlbums(whole, album);
+
+                /* The last word starts at 23, so shorter chunks split the text. */
+                assert(chunkLength >= 23 || taskCount > 1);
+            }
+
+            /* Test that the chunks of a range keep the context of the range. */
+            shapeRange(artist, whole, text, 1, 18);
+            SFArtistFillAlbumConcurrently(artist, album, 4, NULL, NULL);
+            assertSameAlbums(whole, album);
+        }
+
+        SFAlbumRelease(whole);
+        SFAlbumRelease(album);
+        SFArtistRelease(artist);
+        SFPatternRelease(pattern);
+        SFFontRelease(font);
+    }
+
+    /* Test that the string is not split into chunks if a lookup involves the space. */
+    {
+        Builder builder;
+        Writer writer;
+        writeSpaceTable(writer, builder);
+
+        SFFontRef font = createFont(writer);
+        SFPatternRef pattern = createPattern(font);
+        SFArtistRef artist = SFArtistCreate();
+        SFAlbumRef album = SFAlbumCreate();
+        SFAlbumRef whole = SFAlbumCreate();
+        const string spacedText = "fi ab zfi a z";
+
+        SFArtistSetPattern(artist, pattern);
+
+        for (SFTextMode textMode : textModes) {
+            SFArtistSetTextMode(artist, textMode);
+
+            shapeText(artist, whole, text);
+            for (SFUInteger chunkLength = 1; chunkLength <= text.length(); chunkLength++) {
+                SFUInteger taskCount = 0;
+                fillConcurrently(artist, album, text, chunkLength, taskCount);
+                assertSameAlbums(whole, album);
+                assert(taskCount == 0);
+            }
+
+            shapeText(artist, whole, spacedText);
+            for (SFUInteger chunkLength = 1; chunkLength <= spacedText.length(); chunkLength++) {
+                SFUInteger taskCount = 0;
+                fillConcurrently(artist, album, spacedText, chunkLength, taskCount);
+                assertSameAlbums(whole, album);
+                assert(taskCount == 0);
+            }
+        }
+
+        SFAlbumRelease(whole);
+        SFAlbumRelease(album);
+        SFArtistRelease(artist);
+        SFPatternRelease(pattern);
+        SFFontRelease(font);
+    }
+}
+
+void ArtistTester::testBatchFill()
+{
+    Builder builder;
+    Writer writer;
+    writeLatinTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+    SFPatternRef pattern = createPattern(font);
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 1, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef single = SFAlbumCreate();
+
+    const vector<string> labels = { "xab", "fi", "", "ffi xab", "xab", "b a", "fi" };
+    vector<void *> buffers;
+    vector<SFUInteger> lengths;
+    vector<SFAlbumRef> albums;
+
+    for (const string &label : labels) {
+        buffers.push_back((void *)label.data());
+        lengths.push_back(label.length());
+        albums.push_back(SFAlbumCreate());
+    }
+
+    SFArtistSetPattern(artist, pattern);
+
+    /* Test that each album gets the same results as its string shaped on its own. */
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+    for (SFTextMode textMode : textModes) {
+        SFArtistSetTextMode(artist, textMode);
+        SFArtistFillAlbums(artist, SFStringEncodingUTF8, buffers.data(), lengths.data(), labels.size(), albums.data());
+
+        for (size_t index = 0; index < labels.size(); index++) {
+            shapeText(artist, single, labels[index]);
+            assertSameAlbums(single, albums[index]);
+        }
+    }
+
+    /* Test that the repeated strings are loaded from the cache. */
+    SFArtistSetTextMode(artist, SFTextModeForward);
+    SFArtistSetShapeCache(artist, cache);
+    SFArtistFillAlbums(artist, SFStringEncodingUTF8, buffers.data(), lengths.data(), labels.size(), albums.data());
+    assert(SFShapeCacheGetHitCount(cache) == 2);
+
+    for (size_t index = 0; index < labels.size(); index++) {
+        shapeText(artist, single, labels[index]);
+        assertSameAlbums(single, albums[index]);
+    }
+
+    /* Test that the source string of the artist is left untouched. */
+    const string text = "xab";
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)text.data(), text.length());
+    SFArtistFillAlbums(artist, SFStringEncodingUTF8, buffers.data(), lengths.data(), 2, albums.data());
+    SFArtistFillAlbum(artist, single);
+    assertGlyphs(single, { 'x', 'a' + 500, 'b' });
+
+    for (SFAlbumRef album : albums) {
+        SFAlbumRelease(album);
+    }
+    SFAlbumRelease(single);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ArtistTester::testPatternFanOut()
+{
+    Builder latinBuilder;
+    Writer latinWriter;
+    writeLatinTable(latinWriter, latinBuilder);
+
+    Builder spaceBuilder;
+    Writer spaceWriter;
+    writeSpaceTable(spaceWriter, spaceBuilder);
+
+    Builder arabicBuilder;
+    Writer arabicWriter;
+    writeArabicTable(arabicWriter, arabicBuilder);
+
+    SFFontRef latinFont = createFont(latinWriter);
+    SFFontRef spaceFont = createFont(spaceWriter);
+    SFFontRef arabicFont = createFont(arabicWriter);
+    vector<SFPatternRef> patterns = {
+        createPattern(latinFont), createArabicPattern(arabicFont), NULL, createPattern(spaceFont)
+    };
+    vector<SFAlbumRef> albums;
+    for (size_t index = 0; index < patterns.size(); index++) {
+        albums.push_back(SFAlbumCreate());
+    }
+
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef single = SFAlbumCreate();
+
+    /* Mixed text with brackets and a beh followed by a fatha, joined to two more behs. */
+    const string text = "xab (fi) \xD8\xA8\xD9\x8E\xD8\xA8\xD8\xA8 zfi";
+
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)text.data(), text.length());
+
+    /* Test that every pattern gets the same results as shaping with it on its own. */
+    SFTextDirection textDirections[] = { SFTextDirectionLeftToRight, SFTextDirectionRightToLeft };
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+    SFSegmentationMode segmentationModes[] = { SFSegmentationModeNone, SFSegmentationModeWords };
+
+    for (SFTextDirection textDirection : textDirections) {
+        for (SFTextMode textMode : textModes) {
+            for (SFSegmentationMode segmentationMode : segmentationModes) {
+                SFUInteger taskCount = 0;
+
+                SFArtistSetTextDirection(artist, textDirection);
+                SFArtistSetTextMode(artist, textMode);
+                SFArtistSetSegmentationMode(artist, segmentationMode);
+                SFArtistFillAlbumsWithPatterns(artist, patterns.data(), patterns.size(), albums.data(),
+                                               &runTasksInReverse, &taskCount);
+                assert(taskCount == patterns.size());
+
+                for (size_t index = 0; index < patterns.size(); index++) {
+                    SFArtistSetPattern(artist, patterns[index]);
+                    SFArtistFillAlbum(artist, single);
+                    assertSameAlbums(single, albums[index]);
+                }
+                SFArtistSetPattern(artist, NULL);
+            }
+        }
+    }
+
+    /* Test that the tasks run one after another without a function. */
+    SFArtistFillAlbumsWithPatterns(artist, patterns.data(), patterns.size(), albums.data(), NULL, NULL);
+    SFArtistSetPattern(artist, patterns[1]);
+    SFArtistFillAlbum(artist, single);
+    assertSameAlbums(single, albums[1]);
+
+    SFAlbumRelease(single);
+    SFArtistRelease(artist);
+    for (size_t index = 0; index < patterns.size(); index++) {
+        SFAlbumRelease(albums[index]);
+        SFPatternRelease(patterns[index]);
+    }
+    SFFontRelease(arabicFont);
+    SFFontRelease(spaceFont);
+    SFFontRelease(latinFont);
+}
+
+void ArtistTester::testFontFallback()
+{
+    Builder latinBuilder;
+    Writer latinWriter;
+    writeLatinTable(latinWriter, latinBuilder);
+
+    Builder arabicBuilder;
+    Writer arabicWriter;
+    writeArabicTable(arabicWriter, arabicBuilder);
+
+    SFFontRef primaryFont = createFont(latinWriter, &getASCIIGlyphID);
+    SFFontRef arabicFont = createFont(arabicWriter, &getArabicGlyphID);
+    SFFontRef lastFont = createFont(latinWriter);
+    SFPatternRef primaryPattern = createPattern(primaryFont);
+    vector<SFPatternRef> fallbacks = { createArabicPattern(arabicFont), NULL, createPattern(lastFont) };
+
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+    SFAlbumRef single = SFAlbumCreate();
+
+    /* Latin text with two behs and a snowman, which the primary font does not have. */
+    const string text = "xab \xD8\xA8\xD8\xA8 fi \xE2\x98\x83";
+    const Glyph Snowman = 0x2603;
+
+    SFArtistSetPattern(artist, primaryPattern);
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)text.data(), text.length());
+
+    /* Test that the album is filled as usual without any fallback. */
+    SFArtistFillAlbum(artist, single);
+    SFArtistFillAlbumWithFallbacks(artist, album, NULL, 0);
+    assertSameAlbums(single, album);
+    assertGlyphs(album, { 'x', 'a' + 500, 'b', ' ', 0, 0, ' ', 500, ' ', 0 });
+
+    /* Test that each missing cluster is taken from the first fallback having its glyphs. */
+    SFArtistFillAlbumWithFallbacks(artist, album, fallbacks.data(), fallbacks.size());
+    assertGlyphs(album, { 'x', 'a' + 500, 'b', ' ', InitialBeh, FinalBeh, ' ', 500, ' ', Snowman });
+
+    vector<SFUInteger> fontIndexes = { 0, 0, 0, 0, 1, 1, 0, 0, 0, 3 };
+    for (SFUInteger index = 0; index < fontIndexes.size(); index++) {
+        assert(SFAlbumGetFontIndex(album, index) == fontIndexes[index]);
+    }
+
+    const SFUInt32 *map = SFAlbumGetCodeunitToGlyphMap32Ptr(album);
+    assert(map[4] == 4 && map[6] == 5 && map[12] == 9 && map[14] == 9);
+    assert(SFAlbumGetAssociation(album, 9) == 12);
+
+    /* Test that a cluster missing in all fallbacks keeps its glyph from the primary font. */
+    SFArtistFillAlbumWithFallbacks(artist, album, fallbacks.data(), 1);
+    assertGlyphs(album, { 'x', 'a' + 500, 'b', ' ', InitialBeh, FinalBeh, ' ', 500, ' ', 0 });
+    assert(SFAlbumGetFontIndex(album, 9) == 0);
+
+    /* Test that the clusters are found in backward mode as well. */
+    SFArtistSetTextMode(artist, SFTextModeBackward);
+    SFArtistFillAlbumWithFallbacks(artist, album, fallbacks.data(), fallbacks.size());
+    assert(SFAlbumGetGlyphCount(album) == 11);
+
+    for (SFUInteger index = 0; index < SFAlbumGetGlyphCount(album); index++) {
+        SFUInteger association = SFAlbumGetAssociation(album, index);
+        SFUInteger fontIndex = (association >= 12 ? 3 : association >= 4 && association < 8 ? 1 : 0);
+
+        assert(SFAlbumGetGlyphIDsPtr(album)[index] != 0);
+        assert(SFAlbumGetFontIndex(album, index) == fontIndex);
+    }
+
+    SFAlbumRelease(single);
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    for (SFPatternRef pattern : fallbacks) {
+        SFPatternRelease(pattern);
+    }
+    SFPatternRelease(primaryPattern);
+    SFFontRelease(lastFont);
+    SFFontRelease(arabicFont);
+    SFFontRelease(primaryFont);
+}
+
+void ArtistTester::testDecodingStorage()
+{
+    Builder builder;
+    Writer writer;
+    writeLatinTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+    SFPatternRef pattern = createPattern(font);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+    string text;
+
+    for (int index = 0; index < 50; index++) {
+        text += "xab fi ";
+    }
+
+    SFArtistSetPattern(artist, pattern);
+
+    /* Test that the records of a long text are decoded into the storage of the album. */
+    shapeText(artist, album, text);
+    SFUInteger memoryUsage = SFAlbumGetMemoryUsage(album);
+    assert(memoryUsage >= sizeof(SFCodepointRecord) * text.length());
+
+    SFAllocatorProtocol protocol;
+    protocol.allocate = countingAllocate;
+    protocol.reallocate = countingReallocate;
+    protocol.deallocate = countingDeallocate;
+
+    SFUInteger allocatorCount = 0;
+    SFAllocatorSetProtocol(&protocol, &allocatorCount);
+
+    /* Test that shaping the text again reuses the storage without touching the allocator. */
+    SFUInteger allocationCount = SFAllocatorGetAllocationCount();
+    shapeText(artist, album, text);
+    assert(SFAlbumGetAllocationCount(album) == 0);
+    assert(SFAlbumGetMemoryUsage(album) == memoryUsage);
+    assert(SFAllocatorGetAllocationCount() == allocationCount);
+    assert(allocatorCount == 0);
+
+    SFAllocatorSetProtocol(NULL, NULL);
+
+    /* Test that the records are shrunk and released along with the rest of the storage. */
+    SFAlbumSetRetainedCapacityLimit(album, 0);
+    shapeText(artist, album, "xab");
+    assert(SFAlbumGetMemoryUsage(album) < sizeof(SFCodepointRecord) * text.length());
+
+    shapeText(artist, album, "");
+    assert(SFAlbumGetMemoryUsage(album) == 0);
+
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ArtistTester::testWarmAllocations()
+{
+    Builder builder;
+    Writer writer;
+    writeLatinTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+
+    /* Test that building a pattern is counted. */
+    SFUInteger allocationCount = SFAllocatorGetAllocationCount();
+    SFPatternRef pattern = createPattern(font);
+    assert(SFAllocatorGetAllocationCount() > allocationCount);
+
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 1, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+    string text;
+
+    for (int index = 0; index < 20; index++) {
+        text += "xab fi ";
+    }
+
+    SFArtistSetPattern(artist, pattern);
+
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+    for (SFTextMode textMode : textModes) {
+        SFArtistSetTextMode(artist, textMode);
+
+        /* Test that the scratch memory of the artist is reused by a warm fill. */
+        shapeText(artist, album, text);
+        allocationCount = SFAllocatorGetAllocationCount();
+        shapeText(artist, album, text);
+        assert(SFAllocatorGetAllocationCount() == allocationCount);
+
+        /* Test that the tasks of a warm concurrent fill are reused. */
+        SFUInteger taskCount = 0;
+        fillConcurrently(artist, album, text, 16, taskCount);
+        allocationCount = SFAllocatorGetAllocationCount();
+        fillConcurrently(artist, album, text, 16, taskCount);
+        assert(SFAllocatorGetAllocationCount() == allocationCount);
+        assert(taskCount > 0);
+    }
+
+    /* Test that storing an entry in the cache is counted but loading it is not. */
+    SFArtistSetTextMode(artist, SFTextModeForward);
+    SFArtistSetShapeCache(artist, cache);
+    allocationCount = SFAllocatorGetAllocationCount();
+    shapeText(artist, album, text);
+    assert(SFAllocatorGetAllocationCount() > allocationCount);
+
+    allocationCount = SFAllocatorGetAllocationCount();
+    shapeText(artist, album, text);
+    assert(SFAllocatorGetAllocationCount() == allocationCount);
+    assert(SFShapeCacheGetHitCount(cache) == 1);
+
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ArtistTester::testMeasuredAlbum()
+{
+    Builder builder;
+    Writer writer;
+    writeLatinTable(writer, builder);
+
+    SFFontRef font = createFont(writer);
+    SFPatternRef pattern = createPattern(font);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+    const string text = "xab fi";
+
+    SFArtistSetPattern(artist, pattern);
+
+    /* Test that the measured advance is the sum of the advances of the filled album. */
+    shapeText(artist, album, text);
+    SFInteger totalAdvance = 0;
+    for (SFUInteger index = 0; index < SFAlbumGetGlyphCount(album); index++) {
+        totalAdvance += SFAlbumGetGlyphAdvancesPtr(album)[index];
+    }
+    assert(SFArtistMeasure(artist, album) == totalAdvance);
+
+    /* Test that the partial results of a measured album are not handed out. */
+    assert(SFAlbumGetCodeunitToGlyphMap32Ptr(album) == NULL);
+    assert(SFAlbumGetCodeunitToGlyphMapPtr(album) == NULL);
+    assert(SFAlbumGetGlyphAdvancesPtr(album) == NULL);
+    assert(SFAlbumCreateCopy(album) == NULL);
+    assert(SFAlbumSerialize(album, NULL, NULL, 0) == 0);
+
+    /* Test that the album gets complete results once filled again. */
+    shapeText(artist, album, text);
+    assert(SFAlbumGetCodeunitToGlyphMap32Ptr(album) != NULL);
+    assert(SFAlbumSerialize(album, NULL, NULL, 0) > 0);
+
+    SFAlbumRef copy = SFAlbumCreateCopy(album);
+    assertSameAlbums(album, copy);
+    SFAlbumRelease(copy);
+
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ArtistTester::test()
+{
+    testIncrementalUpdate();
+    testUpdateFallback();
+    testLookupContext();
+    testJoiningContext();
+    testConcurrentFill();
+    testBatchFill();
+    testPatternFanOut();
+    testFontFallback();
+    testDecodingStorage();
+    testWarmAllocations();
+    testMeasuredAlbum();
+}
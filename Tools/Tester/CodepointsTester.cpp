@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <Source/SFCodepoints.h>
+}
+
+#include "CodepointsTester.h"
+
+using namespace std;
+using namespace SheenFigure::Tester;
+
+static SFJoiningType getLetterJoiningType(SFCodepoint codepoint)
+{
+    /* ASCII is never classified, so claim its letters to catch any call. */
+    if (codepoint == 0x0628 || (codepoint >= 'a' && codepoint <= 'z')) {
+        return SFJoiningTypeD;
+    }
+
+    return SFJoiningTypeU;
+}
+
+/**
+ * Asserts that the decoder reads the same code points as the code point sequence does.
+ */
+static void assertDecoding(SBStringEncoding encoding, const void *buffer, SFUInteger length)
+{
+    SBCodepointSequence sequence = { encoding, (void *)buffer, length };
+    vector<SFCodepointRecord> records(length + 1);
+    SFUInteger recordCount = SFCodepointsDecode(&sequence, SFFalse, NULL, records.data());
+    SFUInteger recordIndex = 0;
+    SFUInteger index = 0;
+    SFUInteger start = 0;
+    SBCodepoint codepoint;
+
+    while ((codepoint = SBCodepointSequenceGetCodepointAt(&sequence, &index)) != SBCodepointInvalid) {
+        assert(recordIndex < recordCount);
+        assert(records[recordIndex].codepoint == codepoint);
+        assert(records[recordIndex].index == start);
+        assert(records[recordIndex].isMirrored == SFFalse);
+        assert(records[recordIndex].joiningType == SFJoiningTypeNil);
+
+        recordIndex += 1;
+        start = index;
+    }
+
+    assert(recordIndex == recordCount);
+}
+
+CodepointsTester::CodepointsTester()
+{
+}
+
+void CodepointsTester::testDecodeUTF8()
+{
+    /* Test the runs of ASCII of every length around the word size. */
+    for (size_t length = 0; length <= 9; length++) {
+        vector<uint8_t> units(length, 'a');
+        assertDecoding(SBStringEncodingUTF8, units.data(), units.size());
+
+        /* Put a multibyte code point at each position of the run. */
+        for (size_t index = 0; index <= length; index++) {
+            vector<uint8_t> mixed(units);
+            mixed.insert(mixed.begin() + index, { 0xD8, 0xA8 });
+            assertDecoding(SBStringEncodingUTF8, mixed.data(), mixed.size());
+        }
+    }
+
+    /* Test the code points of all lengths along with the malformed and truncated sequences. */
+    const uint8_t units[] = {
+        'x', 0xC3, 0xA9, 'y', 0xE2, 0x98, 0x83, 0xF0, 0x9F, 0x98, 0x80, 'a', 'b', 'c', 'd',
+        0x80, 'e', 0xC3, 'f', 0xFF, 'g', 'h', 'i', 'j', 0xE2, 0x98
+    };
+    assertDecoding(SBStringEncodingUTF8, units, sizeof(units));
+}
+
+void CodepointsTester::testDecodeUTF16()
+{
+    /* Test the units below, inside and above the surrogates, including the unpaired ones. */
+    const uint16_t units[] = {
+        'a', 0x00E9, 0x0628, 0xD7FF, 0xD83D, 0xDE00, 0xE000, 0xFFFD, 0xDE00, 'b', 0xD83D, 'c', 0xD83D
+    };
+    assertDecoding(SBStringEncodingUTF16, units, sizeof(units) / sizeof(uint16_t));
+}
+
+void CodepointsTester::testDecodeUTF32()
+{
+    /* Test the valid code points along with the surrogates and the units out of range. */
+    const uint32_t units[] = {
+        'a', 0x00E9, 0xD7FF, 0xD800, 0xDFFF, 0xE000, 0x1F600, 0x10FFFF, 0x110000, 0xFFFFFFFF, 'b'
+    };
+    assertDecoding(SBStringEncodingUTF32, units, sizeof(units) / sizeof(uint32_t));
+}
+
+void CodepointsTester::testMirrors()
+{
+    const uint8_t units[] = { '(', 'a', 'b', ']', 0xC2, 0xAB, '<' };
+    SBCodepointSequence sequence = { SBStringEncodingUTF8, (void *)units, sizeof(units) };
+    SFCodepointRecord records[sizeof(units)];
+    SFUInteger recordCount = SFCodepointsDecode(&sequence, SFTrue, NULL, records);
+
+    /* Test that the mirrors are marked in the ASCII runs as well as outside of them. */
+    assert(recordCount == 6);
+    assert(records[0].isMirrored);
+    assert(!records[1].isMirrored);
+    assert(records[4].codepoint == 0x00AB);
+
+    for (SFUInteger index = 0; index < recordCount; index++) {
+        assert(records[index].isMirrored == (SFCodepointsGetMirror(records[index].codepoint) != 0));
+    }
+
+    /* Test that the mirrors of ASCII are known without looking them up. */
+    vector<uint8_t> ascii;
+    for (uint8_t unit = 1; unit < 0x80; unit++) {
+        ascii.push_back(unit);
+    }
+
+    sequence = { SBStringEncodingUTF8, ascii.data(), ascii.size() };
+    vector<SFCodepointRecord> asciiRecords(ascii.size());
+    recordCount = SFCodepointsDecode(&sequence, SFTrue, NULL, asciiRecords.data());
+    assert(recordCount == ascii.size());
+
+    for (SFUInteger index = 0; index < recordCount; index++) {
+        SFCodepoint codepoint = asciiRecords[index].codepoint;
+        assert(asciiRecords[index].isMirrored == (SFCodepointsGetMirror(codepoint) != 0));
+    }
+}
+
+void CodepointsTester::testRecords()
+{
+    const uint8_t units[] = { 'a', 0xD8, 0xA8, 'b', 0xE2, 0x98, 0x83, 'c' };
+    SBCodepointSequence sequence = { SBStringEncodingUTF8, (void *)units, sizeof(units) };
+    SFCodepointRecord records[sizeof(units)];
+    SFUInteger recordCount = SFCodepointsDecode(&sequence, SFFalse, NULL, records);
+
+    /* Test that the records are read in the same way as the sequence in both directions. */
+    for (int backward = 0; backward <= 1; backward++) {
+        SFCodepoints direct;
+        SFCodepoints recorded;
+
+        SFCodepointsInitialize(&direct, &sequence, (SFBoolean)backward);
+        SFCodepointsInitialize(&recorded, &sequence, (SFBoolean)backward);
+        SFCodepointsSetRecords(&recorded, records, recordCount);
+
+        SFCodepointsReset(&direct);
+        SFCodepointsReset(&recorded);
+        assert(SFCodepointsGetRecord(&direct) == NULL);
+
+        SFCodepoint codepoint;
+        do {
+            codepoint = SFCodepointsNext(&direct);
+            assert(SFCodepointsNext(&recorded) == codepoint);
+
+            if (codepoint != SFCodepointInvalid) {
+                assert(recorded.index == direct.index);
+                assert(SFCodepointsGetRecord(&recorded)->codepoint == codepoint);
+            } else {
+                assert(SFCodepointsGetRecord(&recorded) == NULL);
+            }
+        } while (codepoint != SFCodepointInvalid);
+    }
+}
+
+void CodepointsTester::testJoiningTypes()
+{
+    const uint16_t units[] = { 'a', 0x0628, '-', 0xD83D, 0xDE00, 'b' };
+    SBCodepointSequence sequence = { SBStringEncodingUTF16, (void *)units, sizeof(units) / sizeof(uint16_t) };
+    SFCodepointRecord records[sizeof(units) / sizeof(uint16_t)];
+    SFUInteger recordCount;
+
+    /* Test that the joining types are left unresolved without a classifier. */
+    recordCount = SFCodepointsDecode(&sequence, SFFalse, NULL, records);
+    assert(recordCount == 5);
+
+    for (SFUInteger index = 0; index < recordCount; index++) {
+        assert(records[index].joiningType == SFJoiningTypeNil);
+    }
+
+    /* Test that the classifier is consulted for non-ASCII code points only. */
+    recordCount = SFCodepointsDecode(&sequence, SFFalse, &getLetterJoiningType, records);
+    assert(recordCount == 5);
+    assert(records[0].joiningType == SFJoiningTypeU);
+    assert(records[1].joiningType == SFJoiningTypeD);
+    assert(records[2].joiningType == SFJoiningTypeU);
+    assert(records[3].joiningType == SFJoiningTypeU);
+    assert(records[4].joiningType == SFJoiningTypeU);
+
+    /* Test that the ASCII runs of UTF-8 are not classified either. */
+    const uint8_t bytes[] = { 'a', 'b', 'c', 'd', 0xD8, 0xA8, 'e' };
+    SBCodepointSequence utf8 = { SBStringEncodingUTF8, (void *)bytes, sizeof(bytes) };
+    SFCodepointRecord utf8Records[sizeof(bytes)];
+
+    recordCount = SFCodepointsDecode(&utf8, SFFalse, &getLetterJoiningType, utf8Records);
+    assert(recordCount == 6);
+
+    for (SFUInteger index = 0; index < recordCount; index++) {
+        SFJoiningType expected = (utf8Records[index].codepoint < 0x80 ? SFJoiningTypeU : SFJoiningTypeD);
+        assert(utf8Records[index].joiningType == expected);
+    }
+
+    /* Test that a record keeps its properties within a few bytes. */
+    assert(sizeof(SFCodepointRecord) <= 12);
+}
+
+void CodepointsTester::test()
+{
+    testDecodeUTF8();
+    testDecodeUTF16();
+    testDecodeUTF32();
+    testMirrors();
+    testRecords();
+    testJoiningTypes();
+}
@@ -206,6 +206,73 @@ void ListTester::testRemoveRange()
     SFListFinalize(&list);
 }
 
+void ListTester::testMoveRange()
+{
+    SF_LIST(SFInteger) list;
+    SFListInitialize(&list, sizeof(SFInteger));
+    SFListReserveRange(&list, 0, 10);
+
+    for (SFUInteger i = 0; i < 10; i++) {
+        SFListSetVal(&list, i, (SFInteger)i * 100);
+    }
+
+    /* Test by moving items towards the end of the list. */
+    SFListMoveRange(&list, 2, 5, 3);
+    assert(list.count == 10);
+    assert(list.items[1] == 100);
+    assert(list.items[5] == 200);
+    assert(list.items[6] == 300);
+    assert(list.items[7] == 400);
+    assert(list.items[8] == 800);
+
+    /* Test by moving overlapping items towards the start of the list. */
+    SFListMoveRange(&list, 5, 3, 3);
+    assert(list.count == 10);
+    assert(list.items[3] == 200);
+    assert(list.items[4] == 300);
+    assert(list.items[5] == 400);
+    assert(list.items[9] == 900);
+
+    SFListFinalize(&list);
+}
+
+void ListTester::testInlineStorage()
+{
+    SFInteger buffer[8];
+    SF_LIST(SFInteger) list;
+    SFListInitializeInline(&list, sizeof(SFInteger), buffer, 8);
+
+    assert(list.items == buffer);
+    assert(list.count == 0);
+    assert(list.capacity == 8);
+
+    /* Test by filling the inline buffer. */
+    SFListReserveRange(&list, 0, 8);
+    for (SFUInteger i = 0; i < 8; i++) {
+        SFListSetVal(&list, i, (SFInteger)i * 100);
+    }
+    assert(list.items == buffer);
+
+    /* Test by growing beyond the inline buffer. */
+    SFListAdd(&list, 800);
+    assert(list.items != buffer);
+    assert(list.capacity >= 9);
+    for (SFUInteger i = 0; i < 9; i++) {
+        assert(list.items[i] == (SFInteger)i * 100);
+    }
+
+    /* Test by shrinking back into the inline buffer. */
+    SFListRemoveRange(&list, 4, 5);
+    SFListTrimExcess(&list);
+    assert(list.items == buffer);
+    assert(list.capacity == 8);
+    for (SFUInteger i = 0; i < 4; i++) {
+        assert(list.items[i] == (SFInteger)i * 100);
+    }
+
+    SFListFinalize(&list);
+}
+
 void ListTester::testClear()
 {
     SF_LIST(SFInteger) list;
@@ -347,6 +414,8 @@ void ListTester::test()
     testAdd();
     testInsert();
     testRemoveAt();
+    testMoveRange();
+    testInlineStorage();
     testClear();
     testTrimExcess();
     testIndexOfItem();
@@ -31,6 +31,8 @@ public:
     void testInsert();
     void testRemoveAt();
     void testRemoveRange();
+    void testMoveRange();
+    void testInlineStorage();
     void testClear();
     void testTrimExcess();
     void testIndexOfItem();
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <functional>
+
+extern "C" {
+#include <Source/SFBase.h>
+#include <Source/SFFont.h>
+#include <Source/SFLookupAnalysis.h>
+#include <Source/SFPattern.h>
+#include <Source/SFPatternBuilder.h>
+}
+
+#include "OpenType/Builder.h"
+#include "OpenType/Common.h"
+#include "OpenType/GSUB.h"
+#include "OpenType/Writer.h"
+#include "LookupAnalysisTester.h"
+
+using namespace std;
+using namespace SheenFigure::Tester;
+using namespace SheenFigure::Tester::OpenType;
+
+static const Glyph SpaceGlyph = ' ';
+
+static void initializeLookup(LookupTable &lookup, LookupSubtable &subtable)
+{
+    lookup.lookupType = subtable.lookupType();
+    lookup.lookupFlag = (LookupFlag)0;
+    lookup.subTableCount = 1;
+    lookup.subtables = &subtable;
+    lookup.markFilteringSet = 0;
+}
+
+static bool involvesSpace(LookupSubtable &subtable, SFFeatureKind featureKind)
+{
+    LookupTable lookup;
+    initializeLookup(lookup, subtable);
+
+    Writer writer;
+    writer.write(&lookup);
+
+    return SFLookupInvolvesGlyph((SFData)writer.data(), featureKind, SpaceGlyph);
+}
+
+static void loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    Writer *writer = reinterpret_cast<Writer *>(object);
+
+    if (tag == SFTagMake('G', 'S', 'U', 'B')) {
+        if (buffer) {
+            memcpy(buffer, writer->data(), writer->size());
+        }
+        if (length) {
+            *length = (SFUInteger)writer->size();
+        }
+    } else if (length) {
+        *length = 0;
+    }
+}
+
+static SFGlyphID getGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)codepoint;
+}
+
+static bool isSpaceSeparable(LookupSubtable &subtable)
+{
+    /* Write a table having the given subtable as its only lookup. */
+    LookupTable lookup;
+    initializeLookup(lookup, subtable);
+
+    LookupListTable lookupList;
+    lookupList.lookupCount = 1;
+    lookupList.lookupTables = &lookup;
+
+    ScriptListTable scriptList;
+    scriptList.scriptCount = 0;
+    scriptList.scriptRecord = NULL;
+
+    FeatureListTable featureList;
+    featureList.featureCount = 0;
+    featureList.featureRecord = NULL;
+
+    GSUB gsub;
+    gsub.version = 0x00010000;
+    gsub.scriptList = &scriptList;
+    gsub.featureList = &featureList;
+    gsub.lookupList = &lookupList;
+
+    Writer writer;
+    writer.write(&gsub);
+
+    SFFontProtocol protocol = {
+        .finalize = NULL,
+        .loadTable = &loadTable,
+        .getGlyphIDForCodepoint = &getGlyphID,
+        .getAdvanceForGlyph = NULL,
+    };
+    SFFontRef font = SFFontCreateWithProtocol(&protocol, &writer);
+
+    /* Build a pattern applying the lookup. */
+    SFPatternRef pattern = SFPatternCreate();
+    SFPatternBuilder builder;
+    SFPatternBuilderInitialize(&builder, pattern);
+    SFPatternBuilderSetFont(&builder, font);
+    SFPatternBuilderSetScript(&builder, SFTagMake('l', 'a', 't', 'n'), SFTextDirectionLeftToRight);
+    SFPatternBuilderSetLanguage(&builder, SFTagMake('d', 'f', 'l', 't'));
+    SFPatternBuilderBeginFeatures(&builder, SFFeatureKindSubstitution);
+    SFPatternBuilderAddFeature(&builder, SFTagMake('l', 'i', 'g', 'a'), 0);
+    SFPatternBuilderAddLookup(&builder, 0);
+    SFPatternBuilderMakeFeatureUnit(&builder);
+    SFPatternBuilderEndFeatures(&builder);
+    SFPatternBuilderBuild(&builder);
+    SFPatternBuilderFinalize(&builder);
+
+    bool separable = SFPatternIsSpaceSeparable(pattern);
+
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+
+    return separable;
+}
+
+LookupAnalysisTester::LookupAnalysisTester()
+{
+}
+
+void LookupAnalysisTester::testSubstitutionLookups()
+{
+    Builder builder;
+
+    /* Test the coverage of simple substitutions. */
+    assert(!involvesSpace(builder.createSingleSubst({ 'a' }, 1), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createSingleSubst({ 'a', SpaceGlyph }, 1), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createMultipleSubst({ {SpaceGlyph, { 1, 2 }} }), SFFeatureKindSubstitution));
+
+    /* Test the components of ligatures. */
+    assert(!involvesSpace(builder.createLigatureSubst({ {{ 'f', 'i' }, 1} }), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createLigatureSubst({ {{ 'f', SpaceGlyph }, 1} }), SFFeatureKindSubstitution));
+
+    /* Test the glyphs and coverages of contexts. */
+    assert(!involvesSpace(builder.createContext({
+                              rule_context { { 'a', 'b' }, { {0, 1} } }
+                          }), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createContext({
+                             rule_context { { 'a', SpaceGlyph }, { {0, 1} } }
+                         }), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createContext({ { 'a' }, { SpaceGlyph } }, { {0, 1} }),
+                         SFFeatureKindSubstitution));
+
+    /* Test the classes of contexts, including the default class once a rule refers to it. */
+    assert(!involvesSpace(builder.createContext({ 'a' }, builder.createClassDef('a', 2, { 1, 2 }), {
+                              rule_context { { 1, 2 }, { {0, 1} } }
+                          }), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createContext({ 'a' }, builder.createClassDef('a', 2, { 1, 2 }), {
+                             rule_context { { 1, 0 }, { {0, 1} } }
+                         }), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createContext({ 'a' }, builder.createClassDef(SpaceGlyph, 1, { 1 }), {
+                             rule_context { { 1, 1 }, { {0, 1} } }
+                         }), SFFeatureKindSubstitution));
+
+    /* Test the backtrack and lookahead glyphs of chained contexts. */
+    assert(!involvesSpace(builder.createChainContext({
+                              rule_chain_context { { 'x' }, { 'a' }, { 'y' }, { {0, 1} } }
+                          }), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createChainContext({
+                             rule_chain_context { { SpaceGlyph }, { 'a' }, { 'y' }, { {0, 1} } }
+                         }), SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createChainContext({ }, { { 'a' } }, { { SpaceGlyph } }, { {0, 1} }),
+                         SFFeatureKindSubstitution));
+
+    /* Test the default class of chained contexts. */
+    {
+        reference_wrapper<ClassDefTable> classDefs[] = {
+            builder.createClassDef('x', 1, { 1 }),
+            builder.createClassDef('a', 1, { 1 }),
+            builder.createClassDef('y', 1, { 1 }),
+        };
+
+        assert(!involvesSpace(builder.createChainContext({ 'a' }, classDefs, {
+                                  rule_chain_context { { 1 }, { 1 }, { 1 }, { {0, 1} } }
+                              }), SFFeatureKindSubstitution));
+        assert(involvesSpace(builder.createChainContext({ 'a' }, classDefs, {
+                                 rule_chain_context { { 1 }, { 1 }, { 0 }, { {0, 1} } }
+                             }), SFFeatureKindSubstitution));
+    }
+
+    /* Test that the extensions are looked through. */
+    assert(!involvesSpace(builder.createExtension(LookupType::sSingle, builder.createSingleSubst({ 'a' }, 1)),
+                          SFFeatureKindSubstitution));
+    assert(involvesSpace(builder.createExtension(LookupType::sSingle, builder.createSingleSubst({ SpaceGlyph }, 1)),
+                         SFFeatureKindSubstitution));
+}
+
+void LookupAnalysisTester::testPositioningLookups()
+{
+    Builder builder;
+    ValueRecord &kerning = builder.createValueRecord({ 0, 0, -50, 0 });
+    ValueRecord &empty = builder.createValueRecord({ 0, 0, 0, 0 });
+
+    /* Test the coverage of single adjustments. */
+    assert(!involvesSpace(builder.createSinglePos({ 'a' }, kerning), SFFeatureKindPositioning));
+    assert(involvesSpace(builder.createSinglePos({ SpaceGlyph }, kerning), SFFeatureKindPositioning));
+
+    /* Test both glyphs of pairs. */
+    assert(!involvesSpace(builder.createPairPos({
+                              pair_rule { 'A', 'V', kerning, empty }
+                          }), SFFeatureKindPositioning));
+    assert(involvesSpace(builder.createPairPos({
+                             pair_rule { 'A', SpaceGlyph, kerning, empty }
+                         }), SFFeatureKindPositioning));
+    assert(involvesSpace(builder.createPairPos({
+                             pair_rule { SpaceGlyph, 'A', kerning, empty }
+                         }), SFFeatureKindPositioning));
+
+    /* Test the second class of pairs, including the default class once a pair adjusts it. */
+    {
+        reference_wrapper<ClassDefTable> classDefs[] = {
+            builder.createClassDef('A', 1, { 1 }),
+            builder.createClassDef('V', 1, { 1 }),
+        };
+
+        assert(!involvesSpace(builder.createPairPos({ 'A' }, classDefs, {
+                                  pair_rule { 1, 1, kerning, empty }
+                              }), SFFeatureKindPositioning));
+    }
+    {
+        reference_wrapper<ClassDefTable> classDefs[] = {
+            builder.createClassDef('A', 1, { 1 }),
+            builder.createClassDef(SpaceGlyph, 1, { 1 }),
+        };
+
+        assert(involvesSpace(builder.createPairPos({ 'A' }, classDefs, {
+                                 pair_rule { 1, 1, kerning, empty }
+                             }), SFFeatureKindPositioning));
+    }
+    {
+        reference_wrapper<ClassDefTable> classDefs[] = {
+            builder.createClassDef('A', 1, { 1 }),
+            builder.createClassDef('V', 1, { 1 }),
+        };
+
+        assert(involvesSpace(builder.createPairPos({ 'A' }, classDefs, {
+                                 pair_rule { 1, 0, kerning, empty }
+                             }), SFFeatureKindPositioning));
+    }
+
+    /* Test both coverages of attachments. */
+    assert(involvesSpace(builder.createMarkToBasePos(1, {
+                             {'m', {0, builder.createAnchor(0, 0)}}
+                         }, {
+                             {SpaceGlyph, { builder.createAnchor(0, 0) }}
+                         }), SFFeatureKindPositioning));
+}
+
+void LookupAnalysisTester::testSpaceSeparability()
+{
+    Builder builder;
+
+    /* Test that a pattern is separable only if none of its lookups involves the space. */
+    assert(isSpaceSeparable(builder.createLigatureSubst({ {{ 'f', 'i' }, 1} })));
+    assert(!isSpaceSeparable(builder.createLigatureSubst({ {{ 'f', SpaceGlyph }, 1} })));
+}
+
+void LookupAnalysisTester::test()
+{
+    testSubstitutionLookups();
+    testPositioningLookups();
+    testSpaceSeparability();
+}
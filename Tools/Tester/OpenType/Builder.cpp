@@ -876,7 +876,9 @@ PairAdjustmentPosSubtable &Builder::createPairPos(
     subtable.format2.class1Record = createArray<Class1Record>(subtable.format2.class1Count);
 
     map<UInt16, size_t> emptyRules;
-    ValueRecord &emptyRecord = createValueRecord({ 0, 0, 0, 0 });
+    /* Each value record is preset with its own format, so the empty ones cannot be shared. */
+    ValueRecord &emptyValue1 = createValueRecord({ 0, 0, 0, 0 });
+    ValueRecord &emptyValue2 = createValueRecord({ 0, 0, 0, 0 });
 
     for (UInt16 class1 = 0; class1 < subtable.format2.class1Count; class1++) {
         const map<UInt16, size_t> *classRules = nullptr;
@@ -896,8 +898,8 @@ PairAdjustmentPosSubtable &Builder::createPairPos(
 
             auto class2Entry = classRules->find(class2);
             if (class2Entry == classRules->end()) {
-                class2Record.value1 = &emptyRecord;
-                class2Record.value2 = &emptyRecord;
+                class2Record.value1 = &emptyValue1;
+                class2Record.value2 = &emptyValue2;
             } else {
                 const pair_rule &currentRule = rules[class2Entry->second];
 
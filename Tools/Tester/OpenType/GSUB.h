@@ -170,7 +170,9 @@ struct LigatureSetTable : public Table {
         writer.enter();
 
         writer.write(ligatureCount);
-        writer.defer(ligature);
+        for (int i = 0; i < ligatureCount; i++) {
+            writer.defer(&ligature[i]);
+        }
 
         writer.exit();
     }
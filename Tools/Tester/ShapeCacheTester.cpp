@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2016 Muhammad Tayyab Akram
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+extern "C" {
+#include <Source/SFAlbum.h>
+#include <Source/SFArtist.h>
+#include <Source/SFFont.h>
+#include <Source/SFPattern.h>
+#include <Source/SFPatternBuilder.h>
+#include <Source/SFShapeCache.h>
+}
+
+#include "ShapeCacheTester.h"
+
+using namespace SheenFigure::Tester;
+
+struct ShardLockCounter {
+    int locks[2];
+    int unlocks[2];
+};
+
+static void SFShardLockCounterLock(void *object, SFUInteger shard)
+{
+    ShardLockCounter *counter = (ShardLockCounter *)object;
+    assert(shard < 2);
+    assert(counter->locks[shard] == counter->unlocks[shard]);
+
+    counter->locks[shard]++;
+}
+
+static void SFShardLockCounterUnlock(void *object, SFUInteger shard)
+{
+    ShardLockCounter *counter = (ShardLockCounter *)object;
+    assert(shard < 2);
+    assert(counter->locks[shard] == counter->unlocks[shard] + 1);
+
+    counter->unlocks[shard]++;
+}
+
+static void loadTable(void *object, SFTag tag, SFUInt8 *buffer, SFUInteger *length)
+{
+    if (length) {
+        *length = 0;
+    }
+}
+
+static SFGlyphID getGlyphID(void *object, SFCodepoint codepoint)
+{
+    return (SFGlyphID)codepoint;
+}
+
+static SFAdvance getAdvance(void *object, SFFontLayout fontLayout, SFGlyphID glyphID)
+{
+    return glyphID * 10;
+}
+
+static SFPatternRef createPattern(SFFontRef font)
+{
+    SFPatternRef pattern = SFPatternCreate();
+
+    SFPatternBuilder builder;
+    SFPatternBuilderInitialize(&builder, pattern);
+    SFPatternBuilderSetFont(&builder, font);
+    SFPatternBuilderSetScript(&builder, SFTagMake('l', 'a', 't', 'n'), SFTextDirectionLeftToRight);
+    SFPatternBuilderSetLanguage(&builder, SFTagMake('d', 'f', 'l', 't'));
+    SFPatternBuilderBuild(&builder);
+    SFPatternBuilderFinalize(&builder);
+
+    return pattern;
+}
+
+static SFFontRef createFont()
+{
+    SFFontProtocol protocol = {
+        .finalize = NULL,
+        .loadTable = &loadTable,
+        .getGlyphIDForCodepoint = &getGlyphID,
+        .getAdvanceForGlyph = &getAdvance,
+    };
+
+    return SFFontCreateWithProtocol(&protocol, NULL);
+}
+
+static void shapeWord(SFArtistRef artist, SFAlbumRef album, const char *word)
+{
+    SFArtistSetString(artist, SFStringEncodingUTF8, (void *)word, strlen(word));
+    SFArtistFillAlbum(artist, album);
+}
+
+static void assertSameAlbums(SFAlbumRef album1, SFAlbumRef album2)
+{
+    SFUInteger glyphCount = SFAlbumGetGlyphCount(album1);
+    SFUInteger codeunitCount = SFAlbumGetCodeunitCount(album1);
+
+    assert(SFAlbumGetGlyphCount(album2) == glyphCount);
+    assert(SFAlbumGetCodeunitCount(album2) == codeunitCount);
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(album1), SFAlbumGetGlyphIDsPtr(album2), sizeof(SFGlyphID) * glyphCount) == 0);
+    assert(memcmp(SFAlbumGetGlyphOffsetsPtr(album1), SFAlbumGetGlyphOffsetsPtr(album2), sizeof(SFPoint) * glyphCount) == 0);
+    assert(memcmp(SFAlbumGetGlyphAdvancesPtr(album1), SFAlbumGetGlyphAdvancesPtr(album2), sizeof(SFAdvance) * glyphCount) == 0);
+    assert(memcmp(SFAlbumGetCodeunitToGlyphMap32Ptr(album1), SFAlbumGetCodeunitToGlyphMap32Ptr(album2), sizeof(SFUInt32) * codeunitCount) == 0);
+}
+
+ShapeCacheTester::ShapeCacheTester()
+{
+}
+
+void ShapeCacheTester::testHitAndMiss()
+{
+    SFFontRef font = createFont();
+    SFPatternRef pattern = createPattern(font);
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 1, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef shaped = SFAlbumCreate();
+    SFAlbumRef cached = SFAlbumCreate();
+
+    SFArtistSetPattern(artist, pattern);
+    SFArtistSetShapeCache(artist, cache);
+
+    /* Test that the first shaping misses the cache. */
+    shapeWord(artist, shaped, "word");
+    assert(SFShapeCacheGetHitCount(cache) == 0);
+    assert(SFShapeCacheGetMissCount(cache) == 1);
+    assert(SFShapeCacheGetMemoryUsage(cache) > 0);
+
+    /* Test that the same word hits the cache with identical results. */
+    shapeWord(artist, cached, "word");
+    assert(SFShapeCacheGetHitCount(cache) == 1);
+    assert(SFShapeCacheGetMissCount(cache) == 1);
+
+    SFUInteger glyphCount = SFAlbumGetGlyphCount(shaped);
+    assert(SFAlbumGetGlyphCount(cached) == glyphCount);
+    assert(SFAlbumGetCodeunitCount(cached) == SFAlbumGetCodeunitCount(shaped));
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(cached), SFAlbumGetGlyphIDsPtr(shaped), sizeof(SFGlyphID) * glyphCount) == 0);
+    assert(memcmp(SFAlbumGetGlyphOffsetsPtr(cached), SFAlbumGetGlyphOffsetsPtr(shaped), sizeof(SFPoint) * glyphCount) == 0);
+    assert(memcmp(SFAlbumGetGlyphAdvancesPtr(cached), SFAlbumGetGlyphAdvancesPtr(shaped), sizeof(SFAdvance) * glyphCount) == 0);
+    assert(memcmp(SFAlbumGetCodeunitToGlyphMap32Ptr(cached), SFAlbumGetCodeunitToGlyphMap32Ptr(shaped), sizeof(SFUInt32) * 4) == 0);
+
+    /* Test that a different word, direction or mode misses the cache. */
+    shapeWord(artist, cached, "ward");
+    assert(SFShapeCacheGetMissCount(cache) == 2);
+
+    SFArtistSetTextDirection(artist, SFTextDirectionRightToLeft);
+    shapeWord(artist, cached, "word");
+    assert(SFShapeCacheGetMissCount(cache) == 3);
+
+    SFArtistSetShapingMode(artist, SFShapingModeSubstitutionOnly);
+    shapeWord(artist, cached, "word");
+    assert(SFShapeCacheGetMissCount(cache) == 4);
+    assert(SFAlbumGetGlyphAdvancesPtr(cached) == NULL);
+
+    /* Test that the results of substitution only mode are cached as they are. */
+    shapeWord(artist, cached, "word");
+    assert(SFShapeCacheGetHitCount(cache) == 2);
+    assert(SFAlbumGetGlyphAdvancesPtr(cached) == NULL);
+
+    /* Test that measurement bypasses the cache. */
+    assert(SFArtistMeasure(artist, cached) == ('w' + 'o' + 'r' + 'd') * 10);
+    assert(SFShapeCacheGetHitCount(cache) == 2);
+    assert(SFShapeCacheGetMissCount(cache) == 4);
+
+    /* Test that clearing discards all results. */
+    SFShapeCacheClear(cache);
+    assert(SFShapeCacheGetMemoryUsage(cache) == 0);
+
+    SFAlbumRelease(cached);
+    SFAlbumRelease(shaped);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ShapeCacheTester::testEviction()
+{
+    SFFontRef font = createFont();
+    SFPatternRef pattern = createPattern(font);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+
+    SFArtistSetPattern(artist, pattern);
+
+    /* Find out the size of a single entry. */
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 1, 1024 * 1024);
+    SFArtistSetShapeCache(artist, cache);
+    shapeWord(artist, album, "aa");
+    SFUInteger entrySize = SFShapeCacheGetMemoryUsage(cache);
+    SFShapeCacheRelease(cache);
+
+    /* Test that a cache with the budget of two entries keeps the recently used ones. */
+    cache = SFShapeCacheCreate(NULL, NULL, 1, entrySize * 2);
+    SFArtistSetShapeCache(artist, cache);
+    SFShapeCacheRelease(cache);
+
+    shapeWord(artist, album, "aa");
+    shapeWord(artist, album, "bb");
+    shapeWord(artist, album, "aa");
+    shapeWord(artist, album, "cc");
+    assert(SFShapeCacheGetMemoryUsage(cache) <= entrySize * 2);
+    assert(SFShapeCacheGetMissCount(cache) == 3);
+
+    shapeWord(artist, album, "aa");
+    assert(SFShapeCacheGetHitCount(cache) == 2);
+
+    shapeWord(artist, album, "bb");
+    assert(SFShapeCacheGetMissCount(cache) == 4);
+
+    /* Test that the results larger than the budget are not cached. */
+    shapeWord(artist, album, "a much longer text");
+    shapeWord(artist, album, "a much longer text");
+    assert(SFShapeCacheGetMissCount(cache) == 6);
+
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ShapeCacheTester::testLocking()
+{
+    ShardLockCounter counter = { { 0, 0 }, { 0, 0 } };
+    SFShapeCacheProtocol protocol;
+    protocol.lock = SFShardLockCounterLock;
+    protocol.unlock = SFShardLockCounterUnlock;
+
+    SFFontRef font = createFont();
+    SFPatternRef pattern = createPattern(font);
+    SFShapeCacheRef cache = SFShapeCacheCreate(&protocol, &counter, 2, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+
+    SFArtistSetPattern(artist, pattern);
+    SFArtistSetShapeCache(artist, cache);
+
+    /* Test that a miss locks its shard for the lookup and for the storage. */
+    shapeWord(artist, album, "word");
+    assert(counter.locks[0] + counter.locks[1] == 2);
+
+    /* Test that a hit locks its shard once. */
+    shapeWord(artist, album, "word");
+    assert(counter.locks[0] + counter.locks[1] == 3);
+    assert(counter.locks[0] == counter.unlocks[0] && counter.locks[1] == counter.unlocks[1]);
+
+    /* Test that the counters are read under the lock of each shard. */
+    assert(SFShapeCacheGetHitCount(cache) == 1);
+    assert(counter.locks[0] + counter.locks[1] == 5);
+
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ShapeCacheTester::testSegmentation()
+{
+    SFFontRef font = createFont();
+    SFPatternRef pattern = createPattern(font);
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 1, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef whole = SFAlbumCreate();
+    SFAlbumRef segmented = SFAlbumCreate();
+    const char *text = " ab cd  ab cd";
+
+    /* Test that a pattern without lookups can be segmented. */
+    assert(SFPatternIsSpaceSeparable(pattern));
+
+    SFArtistSetPattern(artist, pattern);
+
+    /* Test that the segments are stitched in the same way as the whole text is shaped. */
+    SFTextMode textModes[] = { SFTextModeForward, SFTextModeBackward };
+    for (SFTextMode textMode : textModes) {
+        SFArtistSetTextMode(artist, textMode);
+
+        SFArtistSetSegmentationMode(artist, SFSegmentationModeNone);
+        shapeWord(artist, whole, text);
+
+        SFArtistSetSegmentationMode(artist, SFSegmentationModeWords);
+        shapeWord(artist, segmented, text);
+
+        assertSameAlbums(whole, segmented);
+    }
+
+    /* Test that the words are shaped through the cache. */
+    SFArtistSetTextMode(artist, SFTextModeForward);
+    SFArtistSetSegmentationMode(artist, SFSegmentationModeNone);
+    shapeWord(artist, whole, text);
+
+    SFArtistSetSegmentationMode(artist, SFSegmentationModeWords);
+    SFArtistSetShapeCache(artist, cache);
+    shapeWord(artist, segmented, text);
+    assert(SFShapeCacheGetMissCount(cache) == 4);
+    assert(SFShapeCacheGetHitCount(cache) == 1);
+
+    shapeWord(artist, segmented, text);
+    assert(SFShapeCacheGetHitCount(cache) == 6);
+    assertSameAlbums(whole, segmented);
+
+    SFAlbumRelease(segmented);
+    SFAlbumRelease(whole);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ShapeCacheTester::testPurgePattern()
+{
+    SFFontRef font = createFont();
+    SFPatternRef pattern1 = createPattern(font);
+    SFPatternRef pattern2 = createPattern(font);
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 2, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef album = SFAlbumCreate();
+
+    SFArtistSetShapeCache(artist, cache);
+
+    SFArtistSetPattern(artist, pattern1);
+    shapeWord(artist, album, "aa");
+    shapeWord(artist, album, "bb");
+    SFUInteger memoryUsage = SFShapeCacheGetMemoryUsage(cache);
+
+    SFArtistSetPattern(artist, pattern2);
+    shapeWord(artist, album, "aa");
+    assert(SFShapeCacheGetMissCount(cache) == 3);
+
+    /* Test that purging a pattern discards only its own results. */
+    SFShapeCachePurgePattern(cache, pattern2);
+    assert(SFShapeCacheGetMemoryUsage(cache) == memoryUsage);
+
+    shapeWord(artist, album, "aa");
+    assert(SFShapeCacheGetMissCount(cache) == 4);
+
+    SFArtistSetPattern(artist, pattern1);
+    shapeWord(artist, album, "aa");
+    shapeWord(artist, album, "bb");
+    assert(SFShapeCacheGetHitCount(cache) == 2);
+
+    /* Test that purging every pattern empties the cache. */
+    SFShapeCachePurgePattern(cache, pattern1);
+    SFShapeCachePurgePattern(cache, pattern2);
+    assert(SFShapeCacheGetMemoryUsage(cache) == 0);
+
+    SFAlbumRelease(album);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(pattern2);
+    SFPatternRelease(pattern1);
+    SFFontRelease(font);
+}
+
+void ShapeCacheTester::testReleasedPattern()
+{
+    SFFontRef font = createFont();
+    SFPatternRef pattern = createPattern(font);
+    SFShapeCacheRef cache = SFShapeCacheCreate(NULL, NULL, 1, 1024 * 1024);
+    SFArtistRef artist = SFArtistCreate();
+    SFAlbumRef shaped = SFAlbumCreate();
+    SFAlbumRef loaded = SFAlbumCreate();
+    const char *word = "aa";
+
+    SFArtistSetPattern(artist, pattern);
+    shapeWord(artist, shaped, word);
+
+    /* Keep the results against a pattern which is not retained by anything else. */
+    SFPatternRef released = createPattern(font);
+    SFShapeCacheKey key;
+
+    SFShapeCacheKeyInitialize(&key, released, SFStringEncodingUTF8, word, strlen(word),
+                              SFTextDirectionLeftToRight, SFTextModeForward, SFShapingModeComplete);
+    SFShapeCacheStoreAlbum(cache, &key, shaped);
+    assert(SFShapeCacheLoadAlbum(cache, &key, loaded));
+
+    /* Release it without purging, so that the new pattern may be created at its address. */
+    SFPatternRelease(released);
+    SFPatternRef created = createPattern(font);
+
+    /* Test that the results of the released pattern are not returned for the new one. */
+    SFShapeCacheKeyInitialize(&key, created, SFStringEncodingUTF8, word, strlen(word),
+                              SFTextDirectionLeftToRight, SFTextModeForward, SFShapingModeComplete);
+    assert(!SFShapeCacheLoadAlbum(cache, &key, loaded));
+
+    SFAlbumRelease(loaded);
+    SFAlbumRelease(shaped);
+    SFArtistRelease(artist);
+    SFShapeCacheRelease(cache);
+    SFPatternRelease(created);
+    SFPatternRelease(pattern);
+    SFFontRelease(font);
+}
+
+void ShapeCacheTester::test()
+{
+    testHitAndMiss();
+    testEviction();
+    testLocking();
+    testSegmentation();
+    testPurgePattern();
+    testReleasedPattern();
+}
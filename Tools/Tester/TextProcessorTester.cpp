@@ -28,7 +28,9 @@ extern "C" {
 }
 
 #include "OpenType/Base.h"
+#include "OpenType/Builder.h"
 #include "OpenType/Common.h"
+#include "OpenType/GPOS.h"
 #include "OpenType/GSUB.h"
 #include "OpenType/Writer.h"
 #include "TextProcessorTester.h"
@@ -146,7 +148,8 @@ static void writeTable(Writer &writer,
 static void processSubtable(SFAlbumRef album,
     const SFCodepoint *input, SFUInteger length, SFBoolean positioning,
     LookupSubtable &subtable, LookupSubtable **referrals, SFUInteger count,
-    SFBoolean isRTL = SFFalse)
+    SFBoolean isRTL = SFFalse, SFShapingMode shapingMode = SFShapingModeComplete,
+    SFBoolean fromGlyphs = SFFalse)
 {
     /* Write the table for the given lookup. */
     Writer writer;
@@ -190,14 +193,22 @@ static void processSubtable(SFAlbumRef album,
     sequence.stringBuffer = (void *)input;
     sequence.stringLength = length;
 
-    /* Reset the album for given codepoints. */
+    /* Map the codepoints to glyphs in the same way as the font does. */
+    vector<SFGlyphID> glyphIDs(input, input + length);
+    SFGlyphInput glyphInput = { glyphIDs.data(), NULL, length };
+
+    /* Reset the album for given codepoints or their glyphs. */
     SFCodepoints codepoints;
-    SFCodepointsInitialize(&codepoints, &sequence, SFFalse);
-    SFAlbumReset(album, &codepoints, length);
+    if (fromGlyphs) {
+        SFAlbumResetForGlyphs(album, &glyphInput, length);
+    } else {
+        SFCodepointsInitialize(&codepoints, &sequence, SFFalse);
+        SFAlbumReset(album, &codepoints, length);
+    }
 
     /* Process the album. */
     SFTextProcessor processor;
-    SFTextProcessorInitialize(&processor, pattern, album, direction, SFTextModeForward, SFFalse);
+    SFTextProcessorInitialize(&processor, pattern, album, direction, SFTextModeForward, shapingMode, SFFalse);
     SFTextProcessorDiscoverGlyphs(&processor);
     SFTextProcessorSubstituteGlyphs(&processor);
     SFTextProcessorPositionGlyphs(&processor);
@@ -224,6 +235,24 @@ void TextProcessorTester::testSubstitution(LookupSubtable &subtable,
 
     assert(SFAlbumGetGlyphCount(&album) == glyphs.size());
     assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), glyphs.data(), sizeof(SFGlyphID) * glyphs.size()) == 0);
+
+    /* Test that substitution only mode produces the same glyphs without positioning them. */
+    processSubtable(&album, &codepoints[0], codepoints.size(), SFFalse, subtable,
+                    (LookupSubtable **)referrals.data(), referrals.size(), SFFalse, SFShapingModeSubstitutionOnly);
+
+    assert(SFAlbumGetGlyphCount(&album) == glyphs.size());
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), glyphs.data(), sizeof(SFGlyphID) * glyphs.size()) == 0);
+    assert(SFAlbumGetGlyphOffsetsPtr(&album) == NULL);
+    assert(SFAlbumGetGlyphAdvancesPtr(&album) == NULL);
+
+    /* Test that shaping from pre-mapped glyphs produces the same glyphs. */
+    processSubtable(&album, &codepoints[0], codepoints.size(), SFFalse, subtable,
+                    (LookupSubtable **)referrals.data(), referrals.size(), SFFalse, SFShapingModeComplete, SFTrue);
+
+    assert(SFAlbumGetGlyphCount(&album) == glyphs.size());
+    assert(memcmp(SFAlbumGetGlyphIDsPtr(&album), glyphs.data(), sizeof(SFGlyphID) * glyphs.size()) == 0);
+
+    SFAlbumFinalize(&album);
 }
 
 void TextProcessorTester::testPositioning(LookupSubtable &subtable,
@@ -243,6 +272,81 @@ void TextProcessorTester::testPositioning(LookupSubtable &subtable,
     assert(SFAlbumGetGlyphCount(&album) == offsets.size());
     assert(memcmp(SFAlbumGetGlyphOffsetsPtr(&album), offsets.data(), sizeof(SFPoint) * offsets.size()) == 0);
     assert(memcmp(SFAlbumGetGlyphAdvancesPtr(&album), advances.data(), sizeof(SFInt32) * advances.size()) == 0);
+
+    /* Test that measurement produces the same total advance. */
+    SFInteger totalAdvance = 0;
+    for (size_t i = 0; i < advances.size(); i++) {
+        totalAdvance += advances[i];
+    }
+
+    processSubtable(&album, &codepoints[0], codepoints.size(), SFTrue, subtable,
+                    (LookupSubtable **)referrals.data(), referrals.size(), isRTL, SFShapingModeMeasure);
+    assert(SFAlbumGetTotalAdvance(&album) == totalAdvance);
+
+    SFAlbumFinalize(&album);
+}
+
+void TextProcessorTester::testUnsafeToBreak(LookupSubtable &subtable, bool positioning,
+    const vector<uint32_t> codepoints,
+    const vector<bool> flags,
+    const vector<LookupSubtable *> referrals)
+{
+    SFAlbum album;
+    SFAlbumInitialize(&album);
+    processSubtable(&album, &codepoints[0], codepoints.size(), positioning ? SFTrue : SFFalse, subtable,
+                    (LookupSubtable **)referrals.data(), referrals.size());
+
+    assert(SFAlbumGetGlyphCount(&album) == flags.size());
+    for (size_t i = 0; i < flags.size(); i++) {
+        assert((SFAlbumIsUnsafeToBreak(&album, i) == SFTrue) == flags[i]);
+    }
+
+    SFAlbumFinalize(&album);
+}
+
+void TextProcessorTester::testBreakSafety()
+{
+    Builder builder;
+
+    vector<LookupSubtable *> simpleReferral = {
+        &builder.createSingleSubst({ 1, 2, 3 }, 10)
+    };
+
+    /* Test that a ligature leaves its neighbours safe to break. */
+    testUnsafeToBreak(builder.createLigatureSubst({ {{ 1, 2 }, 100} }), false,
+                      { 3, 1, 2, 4 }, { false, false, false });
+    /* Test that a context covers all of its input glyphs. */
+    testUnsafeToBreak(builder.createContext({ { 1 }, { 2 }, { 3 } }, { {0, 1} }), false,
+                      { 4, 1, 2, 3, 4 }, { false, false, true, true, false }, simpleReferral);
+    /* Test that a chain context covers its backtrack and lookahead glyphs as well. */
+    testUnsafeToBreak(builder.createChainContext({
+                          rule_chain_context { { 21 }, { 1 }, { 31 }, { {0, 1} } }
+                      }), false,
+                      { 20, 21, 1, 31, 30 }, { false, false, true, true, false }, simpleReferral);
+    /* Test that an unmatched chain context leaves all glyphs safe to break. */
+    testUnsafeToBreak(builder.createChainContext({
+                          rule_chain_context { { 21 }, { 1 }, { 31 }, { {0, 1} } }
+                      }), false,
+                      { 20, 21, 1, 30 }, { false, false, false, false }, simpleReferral);
+
+    ValueRecord &positive = builder.createValueRecord({ 100, 200, 300, 400 });
+
+    /* Test that a kerning pair covers its second glyph. */
+    testUnsafeToBreak(builder.createPairPos({
+                          pair_rule { 1, 2, positive, positive }
+                      }), true,
+                      { 3, 1, 2, 3 }, { false, false, true, false });
+    /* Test that an unmatched pair leaves both glyphs safe to break. */
+    testUnsafeToBreak(builder.createPairPos({
+                          pair_rule { 1, 2, positive, positive }
+                      }), true,
+                      { 1, 3 }, { false, false });
+    /* Test that a cursive connection covers its second glyph. */
+    testUnsafeToBreak(builder.createCursivePos({
+                          {1, {nullptr, &builder.createAnchor(100, 200)}},
+                          {2, {&builder.createAnchor(300, 400), nullptr}}
+                      }), true,
+                      { 1, 2, 3 }, { false, true, false });
 }
 
 void TextProcessorTester::test()
@@ -260,4 +364,5 @@ void TextProcessorTester::test()
     testContextSubtable();
     testChainContextSubtable();
     testExtensionSubtable();
+    testBreakSafety();
 }
@@ -47,6 +47,8 @@ public:
     void testChainContextSubtable();
     void testExtensionSubtable();
 
+    void testBreakSafety();
+
     void test();
 
 private:
@@ -60,6 +62,10 @@ private:
                          const std::vector<int32_t> advances,
                          const std::vector<OpenType::LookupSubtable *> referrals = { },
                          bool isRTL = false);
+    void testUnsafeToBreak(OpenType::LookupSubtable &subtable, bool positioning,
+                           const std::vector<uint32_t> codepoints,
+                           const std::vector<bool> flags,
+                           const std::vector<OpenType::LookupSubtable *> referrals = { });
 };
 
 }
@@ -19,14 +19,19 @@
 #include <Parser/ArabicShaping.h>
 #include <Parser/UnicodeData.h>
 
+#include "AlbumPoolTester.h"
 #include "AlbumTester.h"
+#include "ArtistTester.h"
+#include "CodepointsTester.h"
 #include "FontTester.h"
 #include "GeneralCategoryLookupTester.h"
 #include "JoiningTypeLookupTester.h"
 #include "ListTester.h"
 #include "LocatorTester.h"
+#include "LookupAnalysisTester.h"
 #include "PatternTester.h"
 #include "SchemeTester.h"
+#include "ShapeCacheTester.h"
 #include "TextProcessorTester.h"
 
 using namespace std;
@@ -43,20 +48,30 @@ int main(int argc, const char * argv[])
     GeneralCategoryLookupTester generalCategoryLookupTester(unicodeData);
     ListTester listTester;
     AlbumTester albumTester;
+    AlbumPoolTester albumPoolTester;
+    ArtistTester artistTester;
+    CodepointsTester codepointsTester;
     LocatorTester locatorTester;
+    LookupAnalysisTester lookupAnalysisTester;
     FontTester fontTester;
     PatternTester patternTester;
     SchemeTester schemeTester;
+    ShapeCacheTester shapeCacheTester;
     TextProcessorTester textProcessorTester;
 
     albumTester.test();
+    albumPoolTester.test();
+    artistTester.test();
+    codepointsTester.test();
     fontTester.test();
     generalCategoryLookupTester.test();
     joiningTypeLookuptester.test();
     listTester.test();
     locatorTester.test();
+    lookupAnalysisTester.test();
     patternTester.test();
     schemeTester.test();
+    shapeCacheTester.test();
     textProcessorTester.test();
 
     return 0;